@@ -0,0 +1,107 @@
+#!/bin/bash
+#
+# Benchmark of the FusionSeq pipeline on synthetic data.
+#
+# Usage: bench.sh [scale] [outputDir] [binDir]
+#
+# scale multiplies the size of the synthetic data set (default 1: 2000 genes,
+# 1M read pairs, 5000 candidates). Every stage runs with FUSIONSEQ_METRICS set,
+# so the results are in <outputDir>/metrics.tsv (one line per program run);
+# <outputDir>/bench.tsv has the wall time and the exit status of each stage.
+# Stages that need external resources (gfServer, bowtie, annotation files)
+# run only with BENCH_ALL=1 and use the configuration in FUSIONSEQ_CONFPATH.
+# binDir is the directory of the built programs (default: src next to this
+# script), e.g. the src directory of a separate build tree.
+
+SCALE=${1:-1}
+OUTDIR=${2:-bench_out}
+SRCDIR=$(cd "$(dirname "$0")/.." && pwd)
+BINDIR=$(cd "${3:-$SRCDIR/src}" && pwd) || exit 1
+PATH=$BINDIR:$BINDIR/test:$PATH
+
+NUM_GENES=$((2000 * SCALE))
+NUM_ISOFORMS=3
+NUM_PAIRS=$((1000000 * SCALE))
+CHIMERIC_FRACTION=0.01
+NUM_CANDIDATES=$((5000 * SCALE))
+READS_PER_CANDIDATE=20
+READ_LENGTH=50
+
+mkdir -p $OUTDIR || exit 1
+OUTDIR=$(cd $OUTDIR && pwd)
+cd $OUTDIR
+rm -f metrics.tsv bench.tsv
+export FUSIONSEQ_METRICS=$OUTDIR/metrics.tsv
+
+# configuration: the user's one (if any) with the annotation and the genome replaced by the synthetic ones
+if [ -n "$FUSIONSEQ_CONFPATH" ] && [ -f "$FUSIONSEQ_CONFPATH" ]; then
+    grep -v -E '^(ANNOTATION_DIR|TRANSCRIPT_COMPOSITE_MODEL_FILENAME|BLAT_DATA_DIR|BLAT_TWO_BIT_DATA_FILENAME|TMP_DIR)=' $FUSIONSEQ_CONFPATH > bench.fusionseqrc
+else
+    grep -v -E '^(ANNOTATION_DIR|TRANSCRIPT_COMPOSITE_MODEL_FILENAME|BLAT_DATA_DIR|BLAT_TWO_BIT_DATA_FILENAME|TMP_DIR)=' $SRCDIR/default.fusionseqrc > bench.fusionseqrc
+fi
+cat >> bench.fusionseqrc <<EOF
+ANNOTATION_DIR="$OUTDIR"
+TRANSCRIPT_COMPOSITE_MODEL_FILENAME="bench.interval"
+BLAT_DATA_DIR="$OUTDIR"
+BLAT_TWO_BIT_DATA_FILENAME="bench.2bit"
+TMP_DIR="$OUTDIR"
+EOF
+# the other annotation files (kgXref, blacklist, ...) are linked from the original ANNOTATION_DIR
+if [ "$BENCH_ALL" = "1" ] && [ -n "$FUSIONSEQ_CONFPATH" ]; then
+    ANNOTATION_DIR=$(sed -n 's/^ANNOTATION_DIR="\{0,1\}\([^"]*\)"\{0,1\}.*/\1/p' $FUSIONSEQ_CONFPATH | head -1)
+    if [ -d "$ANNOTATION_DIR" ]; then
+        for f in $ANNOTATION_DIR/*; do
+            ln -sf $f $OUTDIR/
+        done
+    fi
+fi
+export FUSIONSEQ_CONFPATH=$OUTDIR/bench.fusionseqrc
+
+printf "stage\tstatus\tseconds\tcommand\n" > bench.tsv
+
+# run <stage> <command>: times the command and records its exit status
+run() {
+    local stage=$1
+    shift
+    local start=$(date +%s.%N)
+    bash -c "$*" 2>> bench.log
+    local status=$?
+    local end=$(date +%s.%N)
+    awk -v stage="$stage" -v status=$status -v start=$start -v end=$end -v cmd="$*" 'BEGIN { printf "%s\t%d\t%.3f\t%s\n", stage, status, end - start, cmd }' >> bench.tsv
+    echo "$stage: status $status" >&2
+}
+
+run mrfSimulation "mrfSimulation $NUM_GENES $NUM_ISOFORMS $NUM_PAIRS $CHIMERIC_FRACTION $READ_LENGTH bench"
+run gfrSimulation "gfrSimulation bench.interval bench.fa $NUM_CANDIDATES $READS_PER_CANDIDATE $READ_LENGTH sim"
+if which faToTwoBit > /dev/null 2>&1; then
+    run faToTwoBit "faToTwoBit bench.fa bench.2bit"
+fi
+
+run geneFusions "geneFusions bench 2 < bench.mrf > bench.gfr"
+run gfrProximityFilter "gfrProximityFilter 10000 < sim.gfr > sim.proximity.gfr"
+run gfrAbnormalInsertSizeFilter "gfrAbnormalInsertSizeFilter 0.01 < sim.gfr > sim.insertSize.gfr"
+run gfrPCRFilter "gfrPCRFilter 4 4 < sim.gfr > sim.pcr.gfr"
+run gfrSequenceComplexityFilter "gfrSequenceComplexityFilter 2 < sim.gfr > sim.complexity.gfr"
+run gfrRandomPairingFilter "gfrRandomPairingFilter 5 < sim.gfr > sim.randomPairing.gfr"
+run gfrClassify "gfrClassify < sim.gfr > sim.classify.gfr"
+run gfrCountPairTypes "gfrCountPairTypes < sim.gfr > sim.pairTypes.txt"
+if [ -f bench.2bit ]; then
+    run gfr2bpJunctions "gfr2bpJunctions sim.gfr $((READ_LENGTH - 6)) 50"
+fi
+run bowtie2bp "bowtie2bp < sim.bowtie > sim.bp"
+
+if [ "$BENCH_ALL" = "1" ]; then
+    run gfrAddInfo "gfrAddInfo < sim.gfr > sim.addInfo.gfr"
+    run gfrBlackListFilter "gfrBlackListFilter < sim.gfr > sim.blackList.gfr"
+    run gfrLargeScaleHomologyFilter "gfrLargeScaleHomologyFilter < sim.gfr > sim.largeScale.gfr"
+    run gfrRibosomalFilter "gfrRibosomalFilter < sim.gfr > sim.ribosomal.gfr"
+    run gfrMitochondrialFilter "gfrMitochondrialFilter < sim.gfr > sim.mitochondrial.gfr"
+    run gfrGenomeSequenceUnknownFilter "gfrGenomeSequenceUnknownFilter < sim.gfr > sim.unknown.gfr"
+    run gfrRepeatMaskerFilter "gfrRepeatMaskerFilter 2 < sim.gfr > sim.repeat.gfr"
+    run gfrPseudogenesFilter "gfrPseudogenesFilter 2 < sim.gfr > sim.pseudogene.gfr"
+    run gfrSmallScaleHomologyFilter "gfrSmallScaleHomologyFilter < sim.gfr > sim.smallScale.gfr"
+fi
+
+echo ----------------------------------------------------------------------
+echo Results: $OUTDIR/bench.tsv $OUTDIR/metrics.tsv
+echo ----------------------------------------------------------------------
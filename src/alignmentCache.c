@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include <bios/log.h>
+#include <bios/format.h>
+
+#include "conf.h"
+#include "kvStore.h"
+#include "alignmentCache.h"
+
+
+
+#define ALIGNMENT_CACHE_VERSION 2 // part of the keys: changed when the cached values of the same inputs change
+
+
+
+struct _alignmentCache {
+  KvStore *store;
+  char *name;
+  Stringa context;
+  int numHits;
+  int numMisses;
+};
+
+
+
+AlignmentCache* alignmentCache_open (char *referenceFile, char *aligner)
+{
+  AlignmentCache *cache;
+  KvStore *store;
+  Stringa fileName;
+  struct stat info;
+  char *cacheDir,*pos;
+
+  cacheDir = getenv ("FUSIONSEQ_CACHE_DIR");
+  if (cacheDir == NULL || cacheDir[0] == '\0') {
+    cacheDir = conf_get ()->cacheDir;
+  }
+  if (cacheDir == NULL || cacheDir[0] == '\0') {
+    return NULL;
+  }
+  pos = strrchr (referenceFile,'/');
+  fileName = stringCreate (100);
+  stringPrintf (fileName,"%s/%s.alignments.cache",cacheDir,pos != NULL ? pos + 1 : referenceFile);
+  store = kvStore_open (string (fileName));
+  if (store == NULL) {
+    warn ("Unable to open the alignment cache %s, running without it",string (fileName));
+    stringDestroy (fileName);
+    return NULL;
+  }
+  stringDestroy (fileName);
+  AllocVar (cache);
+  cache->store = store;
+  cache->name = hlr_strdup (pos != NULL ? pos + 1 : referenceFile);
+  cache->context = stringCreate (100);
+  if (stat (referenceFile,&info) == 0) {
+    stringPrintf (cache->context,"%d\t%s:%lld:%lld\t%s",ALIGNMENT_CACHE_VERSION,referenceFile,(long long)info.st_size,(long long)info.st_mtime,aligner);
+  }
+  else {
+    stringPrintf (cache->context,"%d\t%s\t%s",ALIGNMENT_CACHE_VERSION,referenceFile,aligner);
+  }
+  return cache;
+}
+
+
+
+static char* alignmentCache_getKey (AlignmentCache *cache, char *read, char *params)
+{
+  static Stringa buffer = NULL;
+
+  stringCreateClear (buffer,200);
+  stringPrintf (buffer,"%s\t%s\t%s",string (cache->context),params != NULL ? params : "",read);
+  return kvStore_hash (string (buffer),stringLen (buffer));
+}
+
+
+
+char* alignmentCache_get (AlignmentCache *cache, char *read, char *params)
+{
+  char *value;
+
+  if (cache == NULL) {
+    return NULL;
+  }
+  value = kvStore_get (cache->store,alignmentCache_getKey (cache,read,params));
+  if (value == NULL) {
+    cache->numMisses++;
+  }
+  else {
+    cache->numHits++;
+  }
+  return value;
+}
+
+
+
+void alignmentCache_put (AlignmentCache *cache, char *read, char *params, char *value)
+{
+  if (cache == NULL) {
+    return;
+  }
+  kvStore_put (cache->store,alignmentCache_getKey (cache,read,params),value);
+}
+
+
+
+void alignmentCache_close (AlignmentCache *cache)
+{
+  if (cache == NULL) {
+    return;
+  }
+  warn ("%s_alignmentCacheHits: %d",cache->name,cache->numHits);
+  warn ("%s_alignmentCacheMisses: %d",cache->name,cache->numMisses);
+  kvStore_close (cache->store);
+  stringDestroy (cache->context);
+  hlr_free (cache->name);
+  freeMem (cache);
+}
@@ -0,0 +1,33 @@
+#ifndef DEF_ALIGNMENT_CACHE_H
+#define DEF_ALIGNMENT_CACHE_H
+
+
+
+/**
+   @file alignmentCache.h
+   @brief Content-addressed cache of read alignments, shared by the homology filters.
+   @details The result of aligning a read against a reference is stored in a key-value store (see kvStore.h) on local disk, one per reference: CACHE_DIR/referenceName.alignments.cache. The key is the hash of the reference (path, size and modification time), the alignment parameters and the read sequence, so that the same read found in several candidates, in a re-run or in another filter using the same reference is aligned only once.
+   The value is a short string defined by the caller (e.g. the aligned span or the list of hits); it cannot contain tabs or newlines.
+   The cache is enabled by the environment variable FUSIONSEQ_CACHE_DIR or by CACHE_DIR in .fusionseqrc.
+ */
+
+
+
+typedef struct _alignmentCache AlignmentCache;
+
+
+
+/** open the cache of the alignments against a reference.
+    @return NULL if the cache is disabled or cannot be opened; the other functions accept NULL and do nothing.
+    @pre conf_init() has been called. */
+extern AlignmentCache* alignmentCache_open (char* referenceFile /**< [in] path of the reference */, char* aligner /**< [in] name and fixed parameters of the aligner */);
+/** look up the alignment of a read. @return the cached value, NULL if not found. The value is valid until the next call. */
+extern char* alignmentCache_get (AlignmentCache* cache, char* read, char* params /**< [in] parameters that vary per call, e.g. the minimum score, or NULL */);
+/** store the alignment of a read. */
+extern void alignmentCache_put (AlignmentCache* cache, char* read, char* params, char* value);
+/** close the cache. @remark it reports the number of hits and misses. */
+extern void alignmentCache_close (AlignmentCache* cache);
+
+
+
+#endif
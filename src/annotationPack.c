@@ -0,0 +1,277 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <bios/log.h>
+#include <bios/format.h>
+
+#include "conf.h"
+#include "annotationPack.h"
+
+
+
+#define ANNOTATION_PACK_MAGIC "FSANPAK1"
+
+
+
+/**
+   Header of a pack, followed by the sections, the names and the data of each section, each padded to 8 bytes.
+*/
+typedef struct {
+  char magic[8];
+  uint32_t numSections;
+  uint32_t namesSize;
+  uint64_t dataSize;
+} PackHeader;
+
+
+
+typedef struct {
+  uint32_t name; // offset in the names of the real path of the file
+  uint32_t reserved;
+  int64_t fileModificationTime;
+  uint64_t fileSize;
+  uint64_t offset; // from the start of the data
+  uint64_t size;
+} PackSection;
+
+
+
+typedef struct {
+  char *realPath;
+  struct stat info;
+  AnnotationPackSection *section;
+} SectionToWrite;
+
+
+
+static unsigned char *packData = NULL;
+static size_t packSize = 0;
+static int isAttached = 0;
+static PackHeader *header = NULL;
+static PackSection *sections = NULL; // sorted by name
+static char *names = NULL;
+static unsigned char *data = NULL;
+
+
+
+static size_t annotationPack_pad (size_t size)
+{
+  return (size + 7) & ~(size_t)7;
+}
+
+
+
+static size_t annotationPack_getSize (PackHeader *currHeader)
+{
+  return annotationPack_pad (sizeof (PackHeader)) +
+    annotationPack_pad ((size_t)currHeader->numSections * sizeof (PackSection)) +
+    annotationPack_pad (currHeader->namesSize) +
+    currHeader->dataSize;
+}
+
+
+
+static int sortSectionsByRealPath (SectionToWrite *a, SectionToWrite *b)
+{
+  return strcmp (a->realPath,b->realPath);
+}
+
+
+
+static void annotationPack_writeBytes (FILE *fp, void *bytes, size_t size, char *packFile)
+{
+  static char zeros[8];
+
+  if (fwrite (bytes,1,size,fp) != size || fwrite (zeros,1,annotationPack_pad (size) - size,fp) != annotationPack_pad (size) - size) {
+    die ("Unable to write the annotation pack: %s",packFile);
+  }
+}
+
+
+
+static void annotationPack_writeName (FILE *fp, char *name, char *packFile)
+{
+  if (fwrite (name,1,strlen (name) + 1,fp) != strlen (name) + 1) {
+    die ("Unable to write the annotation pack: %s",packFile);
+  }
+}
+
+
+
+void annotationPack_write (char *packFile, Array inSections)
+{
+  Array toWrite;
+  SectionToWrite *currToWrite;
+  PackHeader currHeader;
+  PackSection currSection;
+  Stringa tmpFileName;
+  FILE *fp;
+  uint32_t nameOffset;
+  uint64_t dataOffset;
+  int i;
+
+  toWrite = arrayCreate (arrayMax (inSections),SectionToWrite);
+  for (i = 0; i < arrayMax (inSections); i++) {
+    currToWrite = arrayp (toWrite,i,SectionToWrite);
+    currToWrite->section = arrp (inSections,i,AnnotationPackSection);
+    if ((currToWrite->realPath = realpath (currToWrite->section->fileName,NULL)) == NULL || stat (currToWrite->realPath,&currToWrite->info) != 0) {
+      die ("Unable to find file: %s",currToWrite->section->fileName);
+    }
+  }
+  arraySort (toWrite,(ARRAYORDERF)sortSectionsByRealPath);
+  memset (&currHeader,0,sizeof (currHeader));
+  memcpy (currHeader.magic,ANNOTATION_PACK_MAGIC,sizeof (currHeader.magic));
+  currHeader.numSections = arrayMax (toWrite);
+  for (i = 0; i < arrayMax (toWrite); i++) {
+    currToWrite = arrp (toWrite,i,SectionToWrite);
+    if (i > 0 && strEqual (currToWrite->realPath,arrp (toWrite,i - 1,SectionToWrite)->realPath)) {
+      die ("File added twice to the annotation pack: %s",currToWrite->realPath);
+    }
+    currHeader.namesSize += strlen (currToWrite->realPath) + 1;
+    currHeader.dataSize += annotationPack_pad (currToWrite->section->size);
+  }
+  // the pack appears under its name only when it is complete
+  tmpFileName = stringCreate (100);
+  stringPrintf (tmpFileName,"%s.tmp",packFile);
+  if ((fp = fopen (string (tmpFileName),"wb")) == NULL) {
+    die ("Unable to open file: %s",string (tmpFileName));
+  }
+  annotationPack_writeBytes (fp,&currHeader,sizeof (currHeader),packFile);
+  nameOffset = 0;
+  dataOffset = 0;
+  for (i = 0; i < arrayMax (toWrite); i++) {
+    currToWrite = arrp (toWrite,i,SectionToWrite);
+    memset (&currSection,0,sizeof (currSection));
+    currSection.name = nameOffset;
+    currSection.fileModificationTime = currToWrite->info.st_mtime;
+    currSection.fileSize = currToWrite->info.st_size;
+    currSection.offset = dataOffset;
+    currSection.size = currToWrite->section->size;
+    if (fwrite (&currSection,sizeof (currSection),1,fp) != 1) {
+      die ("Unable to write the annotation pack: %s",packFile);
+    }
+    nameOffset += strlen (currToWrite->realPath) + 1;
+    dataOffset += annotationPack_pad (currToWrite->section->size);
+  }
+  for (i = 0; i < arrayMax (toWrite); i++) {
+    annotationPack_writeName (fp,arrp (toWrite,i,SectionToWrite)->realPath,packFile);
+  }
+  // padding of the names
+  for (i = 0; i < annotationPack_pad (currHeader.namesSize) - currHeader.namesSize; i++) {
+    fputc ('\0',fp);
+  }
+  for (i = 0; i < arrayMax (toWrite); i++) {
+    currToWrite = arrp (toWrite,i,SectionToWrite);
+    annotationPack_writeBytes (fp,currToWrite->section->data,currToWrite->section->size,packFile);
+    free (currToWrite->realPath);
+  }
+  if (fclose (fp) != 0 || rename (string (tmpFileName),packFile) != 0) {
+    die ("Unable to write the annotation pack: %s",packFile);
+  }
+  stringDestroy (tmpFileName);
+  arrayDestroy (toWrite);
+}
+
+
+
+static void annotationPack_attach (void)
+{
+  Conf *conf;
+  Stringa buffer;
+  char *packFile;
+  struct stat info;
+  int fd;
+
+  isAttached = 1;
+  conf = conf_get ();
+  if (conf->annotationPackFilename == NULL) {
+    return;
+  }
+  // not conf_getPath(): its buffer can hold the fileName of annotationPack_getSection()
+  buffer = stringCreate (100);
+  stringPrintf (buffer,"%s/%s",conf->annotationDir,conf->annotationPackFilename);
+  packFile = string (buffer);
+  if ((fd = open (packFile,O_RDONLY)) < 0 || fstat (fd,&info) != 0) {
+    die ("Unable to open the annotation pack: %s",packFile);
+  }
+  packSize = info.st_size;
+  if (packSize < sizeof (PackHeader)) {
+    die ("Not a valid annotation pack: %s",packFile);
+  }
+  packData = (unsigned char*)mmap (NULL,packSize,PROT_READ,MAP_SHARED,fd,0);
+  close (fd);
+  if (packData == MAP_FAILED) {
+    die ("Unable to map the annotation pack: %s",packFile);
+  }
+  header = (PackHeader*)packData;
+  if (memcmp (header->magic,ANNOTATION_PACK_MAGIC,sizeof (header->magic)) != 0 || annotationPack_getSize (header) != packSize) {
+    die ("Not a valid annotation pack: %s",packFile);
+  }
+  sections = (PackSection*)(packData + annotationPack_pad (sizeof (PackHeader)));
+  names = (char*)sections + annotationPack_pad ((size_t)header->numSections * sizeof (PackSection));
+  data = (unsigned char*)names + annotationPack_pad (header->namesSize);
+  stringDestroy (buffer);
+}
+
+
+
+void* annotationPack_getSection (char *fileName, size_t *size)
+{
+  PackSection *currSection;
+  struct stat info;
+  char *realPath;
+  uint32_t low,high,middle;
+  int diff;
+
+  if (!isAttached) {
+    annotationPack_attach ();
+  }
+  if (packData == NULL || (realPath = realpath (fileName,NULL)) == NULL) {
+    return NULL;
+  }
+  currSection = NULL;
+  low = 0;
+  high = header->numSections;
+  while (low < high) {
+    middle = low + (high - low) / 2;
+    diff = strcmp (names + sections[middle].name,realPath);
+    if (diff == 0) {
+      currSection = sections + middle;
+      break;
+    }
+    if (diff < 0) {
+      low = middle + 1;
+    }
+    else {
+      high = middle;
+    }
+  }
+  if (currSection != NULL && (stat (realPath,&info) != 0 || info.st_mtime != currSection->fileModificationTime || (uint64_t)info.st_size != currSection->fileSize)) {
+    warn ("Annotation pack out of date, reading the file: %s",realPath);
+    currSection = NULL;
+  }
+  free (realPath);
+  if (currSection == NULL) {
+    return NULL;
+  }
+  *size = currSection->size;
+  return data + currSection->offset;
+}
+
+
+
+void annotationPack_detach (void)
+{
+  if (packData != NULL) {
+    munmap (packData,packSize);
+  }
+  packData = NULL;
+  packSize = 0;
+  isAttached = 0;
+}
@@ -0,0 +1,38 @@
+#ifndef DEF_ANNOTATION_PACK_H
+#define DEF_ANNOTATION_PACK_H
+
+#include <stddef.h>
+#include <bios/format.h>
+
+
+
+/**
+   @file annotationPack.h
+   @brief Read-only pack of the compiled annotation tables, mapped in memory (mmap) and shared by all the processes of a node.
+   @details The pack is written once by interval2annotationPack and named by ANNOTATION_PACK_FILENAME in ANNOTATION_DIR. Each section holds the compiled form of one annotation file (e.g. the interval index of the composite model, RepeatMasker or the pseudogenes) and is keyed by the real path of that file, with its size and modification time. The loaders of the tables (e.g. intervalIndex_open()) look up their file in the pack first: the pages of the pack are mapped read-only from the page cache, so the tables of N samples running on the same node are in memory once instead of N times.
+   A section is ignored if its file has changed since the pack was written, and the file is then read as without a pack.
+ */
+
+
+
+/**
+   Section to be written by annotationPack_write().
+*/
+typedef struct {
+  char* fileName; //!< annotation file of the section, stamped with its real path, size and modification time
+  void* data;
+  size_t size;
+} AnnotationPackSection;
+
+
+
+/** write a pack with the sections. @remark the integers are in the byte order of this machine. */
+extern void annotationPack_write (char* packFile, Array sections /**< [in] Array of AnnotationPackSection */);
+/** @return the section of fileName in the pack of the configuration, attached at the first call, or NULL if there is no pack, fileName is not in the pack or it has changed since. @remark the data is read-only and remains mapped until annotationPack_detach(). */
+extern void* annotationPack_getSection (char* fileName, size_t* size /**< [out] size of the section */);
+/** unmap the pack. */
+extern void annotationPack_detach (void);
+
+
+
+#endif
@@ -3,6 +3,7 @@
 #include <bios/linestream.h>
 
 #include "bp.h"
+#include "metrics.h"
 
 
 
@@ -12,6 +13,7 @@ static LineStream lsBp = NULL;
 
 void bp_init (const char* fileName)
 {
+  metrics_init (NULL);
   lsBp = ls_createFromFile (fileName);
 }
 
@@ -38,6 +40,8 @@ Array bp_getBreakPoints (void)
     if (line[0] == '\0') {
       continue;
     }
+    metrics_addEntriesIn (1);
+    metrics_addBytesRead (strlen (line) + 1);
     tokens = textStrtok (line,",");
     currBP = arrayp (breakPoints,arrayMax (breakPoints),BreakPoint);
     currBP->tileCoordinate1 = hlr_strdup (textItem (tokens,0));
@@ -71,5 +75,7 @@ char* bp_writeBreakPoint (BreakPoint *currBP)
     currBPR = arrp (currBP->breakPointReads,i,BreakPointRead);
     stringAppendf (buffer,"%d:%s%s",currBPR->offset,currBPR->read, i < arrayMax (currBP->breakPointReads) - 1 ? "|" : "");
   }
+  metrics_addEntriesOut (1);
+  metrics_addBytesWritten (stringLen (buffer) + 1);
   return string (buffer);
 }
@@ -0,0 +1,186 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <ctype.h>
+
+#include <bios/confp.h>
+#include <bios/log.h>
+#include <bios/format.h>
+
+#include "conf.h"
+
+
+
+#define CONF_TYPE_STRING 1
+#define CONF_TYPE_INT 2
+#define CONF_TYPE_DOUBLE 3
+
+
+
+typedef struct {
+  char *key;
+  int type;
+  size_t offset;
+} ConfKey;
+
+
+
+static ConfKey confKeys[] = {
+  {"TMP_DIR",CONF_TYPE_STRING,offsetof (Conf,tmpDir)},
+  {"ANNOTATION_DIR",CONF_TYPE_STRING,offsetof (Conf,annotationDir)},
+  {"ANNOTATION_PACK_FILENAME",CONF_TYPE_STRING,offsetof (Conf,annotationPackFilename)},
+  {"TRANSCRIPT_COMPOSITE_MODEL_FILENAME",CONF_TYPE_STRING,offsetof (Conf,transcriptCompositeModelFilename)},
+  {"KNOWN_GENE_XREF_FILENAME",CONF_TYPE_STRING,offsetof (Conf,knownGeneXrefFilename)},
+  {"KNOWN_GENE_TREE_FAM_FILENAME",CONF_TYPE_STRING,offsetof (Conf,knownGeneTreeFamFilename)},
+  {"BLACKLIST_FILENAME",CONF_TYPE_STRING,offsetof (Conf,blacklistFilename)},
+  {"BLAT_TWO_BIT_TO_FA",CONF_TYPE_STRING,offsetof (Conf,blatTwoBitToFa)},
+  {"BLAT_DATA_DIR",CONF_TYPE_STRING,offsetof (Conf,blatDataDir)},
+  {"BLAT_TWO_BIT_DATA_FILENAME",CONF_TYPE_STRING,offsetof (Conf,blatTwoBitDataFilename)},
+  {"BLAT_BLAT",CONF_TYPE_STRING,offsetof (Conf,blatBlat)},
+  {"BLAT_GFSERVER",CONF_TYPE_STRING,offsetof (Conf,blatGfServer)},
+  {"BLAT_GFCLIENT",CONF_TYPE_STRING,offsetof (Conf,blatGfClient)},
+  {"BLAT_GFSERVER_HOST",CONF_TYPE_STRING,offsetof (Conf,blatGfServerHost)},
+  {"BLAT_GFSERVER_PORT",CONF_TYPE_INT,offsetof (Conf,blatGfServerPort)},
+  {"BLAT_GFSERVER_MAX_CLIENTS",CONF_TYPE_INT,offsetof (Conf,blatGfServerMaxClients)},
+  {"BLAT_GFSERVER_IDLE_TIMEOUT",CONF_TYPE_INT,offsetof (Conf,blatGfServerIdleTimeout)},
+  {"BOWTIE_INDEXES",CONF_TYPE_STRING,offsetof (Conf,bowtieIndexes)},
+  {"BOWTIE_GENOME",CONF_TYPE_STRING,offsetof (Conf,bowtieGenome)},
+  {"BOWTIE_COMPOSITE",CONF_TYPE_STRING,offsetof (Conf,bowtieComposite)},
+  {"RIBOSOMAL_DIR",CONF_TYPE_STRING,offsetof (Conf,ribosomalDir)},
+  {"RIBOSOMAL_FILENAME",CONF_TYPE_STRING,offsetof (Conf,ribosomalFilename)},
+  {"MITOCHONDRIAL_DIR",CONF_TYPE_STRING,offsetof (Conf,mitochondrialDir)},
+  {"MITOCHONDRIAL_FILENAME",CONF_TYPE_STRING,offsetof (Conf,mitochondrialFilename)},
+  {"GENOMEUNKNOWN_DIR",CONF_TYPE_STRING,offsetof (Conf,genomeUnknownDir)},
+  {"GENOMEUNKNOWN_FILENAME",CONF_TYPE_STRING,offsetof (Conf,genomeUnknownFilename)},
+  {"PSEUDOGENE_DIR",CONF_TYPE_STRING,offsetof (Conf,pseudogeneDir)},
+  {"PSEUDOGENE_FILENAME",CONF_TYPE_STRING,offsetof (Conf,pseudogeneFilename)},
+  {"REPEATMASKER_DIR",CONF_TYPE_STRING,offsetof (Conf,repeatMaskerDir)},
+  {"REPEATMASKER_FILENAME",CONF_TYPE_STRING,offsetof (Conf,repeatMaskerFilename)},
+  {"REPEATMASKER_COVERAGE_FILENAME",CONF_TYPE_STRING,offsetof (Conf,repeatMaskerCoverageFilename)},
+  {"CACHE_DIR",CONF_TYPE_STRING,offsetof (Conf,cacheDir)},
+  {"CONTAMINANT_ALIGNER",CONF_TYPE_STRING,offsetof (Conf,contaminantAligner)},
+  {"CONTAMINANT_THREADS",CONF_TYPE_INT,offsetof (Conf,contaminantThreads)},
+  {"MAX_NUMBER_OF_JUNCTIONS_PER_FILE",CONF_TYPE_INT,offsetof (Conf,maxNumberOfJunctionsPerFile)},
+  {"MAX_FRACTION_HOMOLOGOUS",CONF_TYPE_DOUBLE,offsetof (Conf,maxFractionHomologous)},
+  {"MAX_OVERLAP_ALLOWED",CONF_TYPE_DOUBLE,offsetof (Conf,maxOverlapAllowed)},
+  {"MAX_FRACTION_SPLICES",CONF_TYPE_DOUBLE,offsetof (Conf,maxFractionSplices)},
+  {NULL,0,0}
+};
+
+
+
+static config *confp = NULL;
+static Conf conf;
+
+
+
+static char* conf_lookup (char *key)
+{
+  char *value;
+
+  value = confp_get (confp,key);
+  if (value == NULL && strEqual (key,"MAX_NUMBER_OF_JUNCTIONS_PER_FILE")) {
+    value = confp_get (confp,"MAX_NUMBER_OF_JUNCTION_PER_FILE"); // name used by older configuration files
+  }
+  return value;
+}
+
+
+
+static void conf_parse (char *programName)
+{
+  ConfKey *currKey;
+  char *value,*end;
+  void *field;
+
+  for (currKey = confKeys; currKey->key != NULL; currKey++) {
+    field = (char*)&conf + currKey->offset;
+    value = conf_lookup (currKey->key);
+    if (currKey->type == CONF_TYPE_STRING) {
+      *(char**)field = value;
+      continue;
+    }
+    if (value == NULL) {
+      continue;
+    }
+    if (currKey->type == CONF_TYPE_INT) {
+      *(int*)field = (int)strtol (value,&end,10);
+    }
+    else {
+      *(double*)field = strtod (value,&end);
+    }
+    while (isspace (*end)) {
+      end++;
+    }
+    if (end == value || *end != '\0') {
+      die ("%s:\tInvalid numerical value for %s in the configuration file %s: %s",programName,currKey->key,getenv ("FUSIONSEQ_CONFPATH"),value);
+    }
+  }
+}
+
+
+
+Conf* conf_init (char *programName, ...)
+{
+  va_list args;
+  char *key;
+
+  if ((confp = confp_open (getenv ("FUSIONSEQ_CONFPATH"))) == NULL) {
+    die ("%s:\tCannot find .fusionseqrc: %s",programName,getenv ("FUSIONSEQ_CONFPATH"));
+  }
+  conf_parse (programName);
+  va_start (args,programName);
+  while ((key = va_arg (args,char*)) != NULL) {
+    if (conf_lookup (key) == NULL) {
+      die ("%s:\tCannot find %s in the configuration file: %s",programName,key,getenv ("FUSIONSEQ_CONFPATH"));
+    }
+  }
+  va_end (args);
+  return &conf;
+}
+
+
+
+Conf* conf_initOptional (char *programName)
+{
+  if (getenv ("FUSIONSEQ_CONFPATH") != NULL && (confp = confp_open (getenv ("FUSIONSEQ_CONFPATH"))) != NULL) {
+    conf_parse (programName);
+  }
+  return &conf;
+}
+
+
+
+Conf* conf_get (void)
+{
+  return &conf;
+}
+
+
+
+char* conf_getString (char *key)
+{
+  return confp != NULL ? conf_lookup (key) : NULL;
+}
+
+
+
+char* conf_getPath (char *directory, char *fileName)
+{
+  static Stringa buffer = NULL;
+
+  stringCreateClear (buffer,100);
+  stringPrintf (buffer,"%s/%s",directory,fileName);
+  return string (buffer);
+}
+
+
+
+void conf_deInit (void)
+{
+  if (confp != NULL) {
+    confp_close (confp);
+    confp = NULL;
+  }
+}
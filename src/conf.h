@@ -0,0 +1,75 @@
+#ifndef DEF_CONF_H
+#define DEF_CONF_H
+
+
+
+/**
+   @file conf.h
+   @brief Typed snapshot of the configuration file .fusionseqrc.
+   @details The configuration file (FUSIONSEQ_CONFPATH) is parsed once by conf_init(): the values are stored in a Conf struct, numerical values are converted and validated, and the keys required by the program are checked up front. Hot loops read the fields of the struct instead of calling confp_get() and converting the string each time.
+ */
+
+
+
+typedef struct {
+  char *tmpDir; /**< TMP_DIR */
+  char *annotationDir; /**< ANNOTATION_DIR */
+  char *annotationPackFilename; /**< ANNOTATION_PACK_FILENAME */
+  char *transcriptCompositeModelFilename; /**< TRANSCRIPT_COMPOSITE_MODEL_FILENAME */
+  char *knownGeneXrefFilename; /**< KNOWN_GENE_XREF_FILENAME */
+  char *knownGeneTreeFamFilename; /**< KNOWN_GENE_TREE_FAM_FILENAME */
+  char *blacklistFilename; /**< BLACKLIST_FILENAME */
+  char *blatTwoBitToFa; /**< BLAT_TWO_BIT_TO_FA */
+  char *blatDataDir; /**< BLAT_DATA_DIR */
+  char *blatTwoBitDataFilename; /**< BLAT_TWO_BIT_DATA_FILENAME */
+  char *blatBlat; /**< BLAT_BLAT */
+  char *blatGfServer; /**< BLAT_GFSERVER */
+  char *blatGfClient; /**< BLAT_GFCLIENT */
+  char *blatGfServerHost; /**< BLAT_GFSERVER_HOST */
+  int blatGfServerPort; /**< BLAT_GFSERVER_PORT */
+  int blatGfServerMaxClients; /**< BLAT_GFSERVER_MAX_CLIENTS */
+  int blatGfServerIdleTimeout; /**< BLAT_GFSERVER_IDLE_TIMEOUT */
+  char *bowtieIndexes; /**< BOWTIE_INDEXES */
+  char *bowtieGenome; /**< BOWTIE_GENOME */
+  char *bowtieComposite; /**< BOWTIE_COMPOSITE */
+  char *ribosomalDir; /**< RIBOSOMAL_DIR */
+  char *ribosomalFilename; /**< RIBOSOMAL_FILENAME */
+  char *mitochondrialDir; /**< MITOCHONDRIAL_DIR */
+  char *mitochondrialFilename; /**< MITOCHONDRIAL_FILENAME */
+  char *genomeUnknownDir; /**< GENOMEUNKNOWN_DIR */
+  char *genomeUnknownFilename; /**< GENOMEUNKNOWN_FILENAME */
+  char *pseudogeneDir; /**< PSEUDOGENE_DIR */
+  char *pseudogeneFilename; /**< PSEUDOGENE_FILENAME */
+  char *repeatMaskerDir; /**< REPEATMASKER_DIR */
+  char *repeatMaskerFilename; /**< REPEATMASKER_FILENAME */
+  char *repeatMaskerCoverageFilename; /**< REPEATMASKER_COVERAGE_FILENAME */
+  char *cacheDir; /**< CACHE_DIR */
+  char *contaminantAligner; /**< CONTAMINANT_ALIGNER */
+  int contaminantThreads; /**< CONTAMINANT_THREADS */
+  int maxNumberOfJunctionsPerFile; /**< MAX_NUMBER_OF_JUNCTIONS_PER_FILE */
+  double maxFractionHomologous; /**< MAX_FRACTION_HOMOLOGOUS */
+  double maxOverlapAllowed; /**< MAX_OVERLAP_ALLOWED */
+  double maxFractionSplices; /**< MAX_FRACTION_SPLICES */
+} Conf;
+
+
+
+/** parse the configuration file and check the required keys.
+    @return a pointer to the typed configuration.
+    @remark the optional arguments are the names of the required keys, terminated by NULL. The program dies if the file or one of the required keys is missing, or if a numerical value is not valid. */
+extern Conf* conf_init (char* programName /**< [in] name of the program, used in the error messages */, ...);
+/** parse the configuration file if there is one, for the tools that work without it (e.g. to use the annotation pack when it is configured).
+    @return a pointer to the typed configuration, with all the fields unset if FUSIONSEQ_CONFPATH is not set or cannot be read. @remark the program dies if a numerical value is not valid. */
+extern Conf* conf_initOptional (char* programName);
+/** pointer to the typed configuration. @pre conf_init() or conf_initOptional() has been called. */
+extern Conf* conf_get (void);
+/** value of any key of the configuration file, e.g. the ones only used by the visualization tools. @return NULL if the key is not present. */
+extern char* conf_getString (char* key);
+/** combine a directory and a file name of the configuration into a path. @return the path in a static buffer, overwritten by the next call: copy it before calling a function that can open the annotation pack (the *_open() of the annotation tables). */
+extern char* conf_getPath (char* directory, char* fileName);
+/** de-initialization of the configuration. */
+extern void conf_deInit (void);
+
+
+
+#endif
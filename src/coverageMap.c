@@ -0,0 +1,282 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <bios/log.h>
+#include <bios/format.h>
+#include <bios/intervalFind.h>
+
+#include "coverageMap.h"
+
+
+
+#define COVERAGE_MAP_MAGIC "FSCOVMP1"
+
+
+
+/**
+   Header of a coverage map, followed by the chromosomes, the names and the bitmaps, each section padded to 8 bytes.
+*/
+typedef struct {
+  char magic[8];
+  uint32_t numChromosomes;
+  uint32_t namesSize;
+  uint64_t numWords;
+} MapHeader;
+
+
+
+typedef struct {
+  uint32_t name; // offset in the names
+  uint32_t size; // one past the last covered base
+  uint64_t firstWord;
+} MapChromosome;
+
+
+
+struct _coverageMap {
+  unsigned char *data;
+  size_t dataSize;
+  MapHeader *header;
+  MapChromosome *chromosomes; // sorted by name
+  char *names;
+  uint64_t *words;
+};
+
+
+
+static size_t coverageMap_pad (size_t size)
+{
+  return (size + 7) & ~(size_t)7;
+}
+
+
+
+static size_t coverageMap_getSize (MapHeader *header)
+{
+  return coverageMap_pad (sizeof (MapHeader)) +
+    coverageMap_pad ((size_t)header->numChromosomes * sizeof (MapChromosome)) +
+    coverageMap_pad (header->namesSize) +
+    (size_t)header->numWords * sizeof (uint64_t);
+}
+
+
+
+static void coverageMap_setSections (CoverageMap *map)
+{
+  unsigned char *pos;
+
+  map->header = (MapHeader*)map->data;
+  pos = map->data + coverageMap_pad (sizeof (MapHeader));
+  map->chromosomes = (MapChromosome*)pos;
+  pos += coverageMap_pad ((size_t)map->header->numChromosomes * sizeof (MapChromosome));
+  map->names = (char*)pos;
+  pos += coverageMap_pad (map->header->namesSize);
+  map->words = (uint64_t*)pos;
+}
+
+
+
+static int sortIntervalsByChromosome (Interval *a, Interval *b)
+{
+  return strcmp (a->chromosome,b->chromosome);
+}
+
+
+
+static void coverageMap_setBits (uint64_t *words, int start, int end)
+{
+  int i;
+
+  for (i = start; i < end; i++) {
+    words[i >> 6] |= (uint64_t)1 << (i & 63);
+  }
+}
+
+
+
+void coverageMap_compile (char *intervalFile, char *mapFile)
+{
+  CoverageMap map;
+  MapHeader header;
+  MapChromosome *currChromosome;
+  Interval *currInterval;
+  SubInterval *currSubInterval;
+  Array intervals;
+  Stringa tmpFileName;
+  FILE *fp;
+  int i,j;
+
+  intervals = intervalFind_parseFile (intervalFile,0);
+  arraySort (intervals,(ARRAYORDERF)sortIntervalsByChromosome);
+  memset (&header,0,sizeof (header));
+  memcpy (header.magic,COVERAGE_MAP_MAGIC,sizeof (header.magic));
+  for (i = 0; i < arrayMax (intervals); i++) {
+    currInterval = arrp (intervals,i,Interval);
+    if (i == 0 || !strEqual (currInterval->chromosome,arrp (intervals,i - 1,Interval)->chromosome)) {
+      header.numChromosomes++;
+      header.namesSize += strlen (currInterval->chromosome) + 1;
+    }
+  }
+  memset (&map,0,sizeof (map));
+  map.chromosomes = (MapChromosome*)hlr_calloc (header.numChromosomes + 1,sizeof (MapChromosome));
+  // the size of each chromosome is the end of its last sub-interval
+  currChromosome = NULL;
+  for (i = 0; i < arrayMax (intervals); i++) {
+    currInterval = arrp (intervals,i,Interval);
+    if (i == 0 || !strEqual (currInterval->chromosome,arrp (intervals,i - 1,Interval)->chromosome)) {
+      currChromosome = currChromosome == NULL ? map.chromosomes : currChromosome + 1;
+    }
+    for (j = 0; j < arrayMax (currInterval->subIntervals); j++) {
+      currSubInterval = arrp (currInterval->subIntervals,j,SubInterval);
+      if (currSubInterval->end > 0 && (uint32_t)currSubInterval->end > currChromosome->size) {
+        currChromosome->size = currSubInterval->end;
+      }
+    }
+  }
+  for (i = 0; i < header.numChromosomes; i++) {
+    map.chromosomes[i].firstWord = header.numWords;
+    header.numWords += (map.chromosomes[i].size + 63) / 64;
+  }
+  map.dataSize = coverageMap_getSize (&header);
+  map.data = (unsigned char*)hlr_calloc (map.dataSize,1);
+  memcpy (map.data,&header,sizeof (header));
+  memcpy (map.data + coverageMap_pad (sizeof (MapHeader)),map.chromosomes,header.numChromosomes * sizeof (MapChromosome));
+  hlr_free (map.chromosomes);
+  coverageMap_setSections (&map);
+  map.header->namesSize = 0;
+  currChromosome = NULL;
+  for (i = 0; i < arrayMax (intervals); i++) {
+    currInterval = arrp (intervals,i,Interval);
+    if (i == 0 || !strEqual (currInterval->chromosome,arrp (intervals,i - 1,Interval)->chromosome)) {
+      currChromosome = currChromosome == NULL ? map.chromosomes : currChromosome + 1;
+      currChromosome->name = map.header->namesSize;
+      strcpy (map.names + map.header->namesSize,currInterval->chromosome);
+      map.header->namesSize += strlen (currInterval->chromosome) + 1;
+    }
+    for (j = 0; j < arrayMax (currInterval->subIntervals); j++) {
+      currSubInterval = arrp (currInterval->subIntervals,j,SubInterval);
+      coverageMap_setBits (map.words + currChromosome->firstWord,currSubInterval->start < 0 ? 0 : currSubInterval->start,currSubInterval->end);
+    }
+  }
+  for (i = 0; i < arrayMax (intervals); i++) {
+    arrayDestroy (arrp (intervals,i,Interval)->subIntervals);
+  }
+  arrayDestroy (intervals);
+  // the map appears under its name only when it is complete
+  tmpFileName = stringCreate (100);
+  stringPrintf (tmpFileName,"%s.tmp",mapFile);
+  if ((fp = fopen (string (tmpFileName),"wb")) == NULL) {
+    die ("Unable to open file: %s",string (tmpFileName));
+  }
+  if (fwrite (map.data,1,map.dataSize,fp) != map.dataSize || fclose (fp) != 0 || rename (string (tmpFileName),mapFile) != 0) {
+    die ("Unable to write the coverage map: %s",mapFile);
+  }
+  stringDestroy (tmpFileName);
+  hlr_free (map.data);
+}
+
+
+
+CoverageMap* coverageMap_open (char *fileName)
+{
+  CoverageMap *map;
+  struct stat info;
+  int fd;
+
+  AllocVar (map);
+  if ((fd = open (fileName,O_RDONLY)) < 0 || fstat (fd,&info) != 0) {
+    die ("Unable to open the coverage map: %s",fileName);
+  }
+  map->dataSize = info.st_size;
+  if (map->dataSize < sizeof (MapHeader)) {
+    die ("Not a valid coverage map: %s",fileName);
+  }
+  map->data = (unsigned char*)mmap (NULL,map->dataSize,PROT_READ,MAP_SHARED,fd,0);
+  close (fd);
+  if (map->data == MAP_FAILED) {
+    die ("Unable to map the coverage map: %s",fileName);
+  }
+  if (memcmp (map->data,COVERAGE_MAP_MAGIC,8) != 0 || coverageMap_getSize ((MapHeader*)map->data) != map->dataSize) {
+    die ("Not a valid coverage map: %s",fileName);
+  }
+  coverageMap_setSections (map);
+  return map;
+}
+
+
+
+static MapChromosome* coverageMap_findChromosome (CoverageMap *map, char *chromosome)
+{
+  uint32_t low,high,middle;
+  int diff;
+
+  low = 0;
+  high = map->header->numChromosomes;
+  while (low < high) {
+    middle = low + (high - low) / 2;
+    diff = strcmp (map->names + map->chromosomes[middle].name,chromosome);
+    if (diff == 0) {
+      return map->chromosomes + middle;
+    }
+    if (diff < 0) {
+      low = middle + 1;
+    }
+    else {
+      high = middle;
+    }
+  }
+  return NULL;
+}
+
+
+
+int coverageMap_countCovered (CoverageMap *map, char *chromosome, int start, int end)
+{
+  MapChromosome *currChromosome;
+  uint64_t *words;
+  uint64_t firstMask,lastMask;
+  int first,last,i,count;
+
+  if ((currChromosome = coverageMap_findChromosome (map,chromosome)) == NULL) {
+    return 0;
+  }
+  if (start < 0) {
+    start = 0;
+  }
+  if (end > 0 && (uint32_t)end > currChromosome->size) {
+    end = currChromosome->size;
+  }
+  if (start >= end) {
+    return 0;
+  }
+  words = map->words + currChromosome->firstWord;
+  first = start >> 6;
+  last = (end - 1) >> 6;
+  firstMask = ~(uint64_t)0 << (start & 63);
+  lastMask = ~(uint64_t)0 >> (63 - ((end - 1) & 63));
+  if (first == last) {
+    return __builtin_popcountll (words[first] & firstMask & lastMask);
+  }
+  count = __builtin_popcountll (words[first] & firstMask);
+  for (i = first + 1; i < last; i++) {
+    count += __builtin_popcountll (words[i]);
+  }
+  return count + __builtin_popcountll (words[last] & lastMask);
+}
+
+
+
+void coverageMap_close (CoverageMap *map)
+{
+  if (map == NULL) {
+    return;
+  }
+  munmap (map->data,map->dataSize);
+  freeMem (map);
+}
@@ -0,0 +1,31 @@
+#ifndef DEF_COVERAGE_MAP_H
+#define DEF_COVERAGE_MAP_H
+
+
+
+/**
+   @file coverageMap.h
+   @brief Genome-wide bitmap of the bases covered by an annotation track, e.g. the repeat-masked bases, mapped in memory (mmap).
+   @details One bit per base of each chromosome, set if the base falls in a sub-interval of any interval of the track. The map is compiled once from the interval file by interval2coverageMap. The number of covered bases of a read block is then a popcount over a few words, whatever the density of the track around the read (e.g. Alu-rich loci).
+   The sub-intervals are taken as half-open, [start,end), as in positiveRangeIntersection(), so the count of a read block that overlaps a single element equals getNucleotideOverlap(); with overlapping elements the bases are counted once.
+   The map is read-only after coverageMap_open(), so it can be queried from several threads.
+ */
+
+
+
+typedef struct _coverageMap CoverageMap;
+
+
+
+/** compile an interval file into a coverage map file. @remark the words are in the byte order of this machine. */
+extern void coverageMap_compile (char* intervalFile, char* mapFile);
+/** map a coverage map written by coverageMap_compile(). @remark the program dies if the file is not a valid coverage map. */
+extern CoverageMap* coverageMap_open (char* fileName);
+/** @return the number of covered bases in [start,end) of chromosome, 0 if the chromosome is not in the map. */
+extern int coverageMap_countCovered (CoverageMap* map, char* chromosome, int start, int end);
+/** unmap the coverage map. */
+extern void coverageMap_close (CoverageMap* map);
+
+
+
+#endif
@@ -2,13 +2,15 @@
 #include <time.h>
 #include <math.h>
 
-#include <bios/confp.h>
 #include <bios/log.h>
 #include <bios/format.h>
 #include <bios/intervalFind.h>
 #include <mrf/mrf.h>
 
+#include "conf.h"
 #include "gfr.h"
+#include "metrics.h"
+#include "intervalIndex.h"
 
 #include <bios/linestream.h>
 #include <bios/common.h>
@@ -32,8 +34,9 @@
 #define SAMPLING_ITERATIONS 100000
 
 
-static config *conf = NULL; /**< Pointer to configuration file .fusionseqrc  */
+static Conf *conf = NULL; /**< Pointer to configuration file .fusionseqrc  */
 static Array countPairs = NULL; /**< Array to determine the number of reads per each transcript connection.  */
+static IntervalIndex *annotationIndex = NULL; /**< Transcript composite model */
 
 /**
   Representation of the intra-transcript paired end reads
@@ -779,10 +782,7 @@ int main (int argc, char *argv[])
   char *exonCoordinates1,*exonCoordinates2; 
   int minNumberOfPairedEndReads;
 
-  if ((conf = confp_open(getenv("FUSIONSEQ_CONFPATH"))) == NULL) {
-    die("%s:\tCannot find .fusionseqrc: %s", argv[0], getenv("FUSIONSEQ_CONFPATH") );
-    return EXIT_FAILURE;
-  }
+  conf = conf_init (argv[0], "ANNOTATION_DIR", "TRANSCRIPT_COMPOSITE_MODEL_FILENAME", NULL);
    
   if (argc != 3) {
     usage ("%s <prefix> <minNumberOfPairedEndReads>",argv[0]);
@@ -791,15 +791,17 @@ int main (int argc, char *argv[])
   srand (time (0));
   buffer = stringCreate (100);
   stringPrintf (buffer,"%s/%s", 
-                confp_get( conf, "ANNOTATION_DIR"), 
-                confp_get( conf, "TRANSCRIPT_COMPOSITE_MODEL_FILENAME"));
-  intervalFind_addIntervalsToSearchSpace (string (buffer),0);
+                conf->annotationDir, 
+                conf->transcriptCompositeModelFilename);
+  annotationIndex = intervalIndex_open (string (buffer),0);
   inters = arrayCreate (1000000,Inter);
   mrfLines = 0;
  
   superIntras = arrayCreate (100000,SuperIntra);
+  metrics_init (argv[0]);
   mrf_init ("-");
   while (currMrfEntry = mrf_nextEntry ()) {
+    metrics_addEntriesIn (1);
     mrfLines++;
     currMrfRead1 = &currMrfEntry->read1;
     currMrfRead2 = &currMrfEntry->read2;
@@ -807,8 +809,8 @@ int main (int argc, char *argv[])
       currMrfBlock1 = arrp (currMrfRead1->blocks,i,MrfBlock);
       for (j = 0; j < arrayMax (currMrfRead2->blocks); j++) {
         currMrfBlock2 = arrp (currMrfRead2->blocks,j,MrfBlock);
-        intervals1 = arrayCopy (intervalFind_getOverlappingIntervals (currMrfBlock1->targetName,currMrfBlock1->targetStart,currMrfBlock1->targetEnd));
-        intervals2 = arrayCopy (intervalFind_getOverlappingIntervals (currMrfBlock2->targetName,currMrfBlock2->targetStart,currMrfBlock2->targetEnd));
+        intervals1 = arrayCopy (intervalIndex_getOverlappingIntervals (annotationIndex,currMrfBlock1->targetName,currMrfBlock1->targetStart,currMrfBlock1->targetEnd));
+        intervals2 = arrayCopy (intervalIndex_getOverlappingIntervals (annotationIndex,currMrfBlock2->targetName,currMrfBlock2->targetStart,currMrfBlock2->targetEnd));
 	for( intvl1 = 0; intvl1 < arrayMax (intervals1); intvl1++) {
 	  for( intvl2 = 0; intvl2 < arrayMax (intervals2); intvl2++ ) {
 	    transcript1 = arru (intervals1, intvl1,Interval*);
@@ -1007,6 +1009,7 @@ int main (int argc, char *argv[])
     }
     hlr_free (exonCoordinates1);
     hlr_free (exonCoordinates2);
+    metrics_addEntriesOut (1);
     i++;
   }    
   warn ("%s_numGfrEntries: %d",argv[0],i);
@@ -1017,7 +1020,7 @@ int main (int argc, char *argv[])
   }
   fclose (fp);
   stringPrintf( buffer, "gzip -f %s.intraOffsets", argv[1] );
-  hlr_system( string(buffer), 1);
+  metrics_system( string(buffer), 1);
   arrayDestroy( superIntras );
   arrayDestroy( superInters );
   arrayDestroy( inters );
@@ -1025,7 +1028,7 @@ int main (int argc, char *argv[])
   arrayDestroy ( intraOffsets );
   arrayDestroy( interOffsetsAB );
   arrayDestroy( interOffsetsBA );
-  confp_close(conf);
+  conf_deInit ();
   return EXIT_SUCCESS;
 }
 
@@ -0,0 +1,400 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <bios/log.h>
+#include <bios/format.h>
+#include <bios/linestream.h>
+
+#include "annotationPack.h"
+#include "genePairSet.h"
+
+
+
+#define GENE_PAIR_SET_MAGIC "FSGNPRS1"
+
+
+
+/**
+   Header of a set, followed by the genes, the gene slots, the pair slots and the names, each section padded to 8 bytes.
+*/
+typedef struct {
+  char magic[8];
+  uint32_t numGenes;
+  uint32_t numGeneSlots; // power of 2
+  uint32_t numPairs;
+  uint32_t numPairSlots; // power of 2
+  uint32_t namesSize;
+  uint32_t reserved;
+} SetHeader;
+
+
+
+typedef struct {
+  uint32_t name; // offset in the names
+  uint32_t length;
+} SetGene;
+
+
+
+struct _genePairSet {
+  unsigned char *data;
+  size_t dataSize;
+  int isMapped;
+  int isBorrowed; // section of the annotation pack
+  SetHeader *header;
+  SetGene *genes;
+  uint32_t *geneSlots; // number of the gene + 1, 0 if empty
+  uint64_t *pairSlots; // canonical key of the pair + 1, 0 if empty
+  char *names;
+};
+
+
+
+static size_t genePairSet_pad (size_t size)
+{
+  return (size + 7) & ~(size_t)7;
+}
+
+
+
+static size_t genePairSet_getSize (SetHeader *header)
+{
+  return genePairSet_pad (sizeof (SetHeader)) +
+    genePairSet_pad ((size_t)header->numGenes * sizeof (SetGene)) +
+    genePairSet_pad ((size_t)header->numGeneSlots * sizeof (uint32_t)) +
+    genePairSet_pad ((size_t)header->numPairSlots * sizeof (uint64_t)) +
+    genePairSet_pad (header->namesSize);
+}
+
+
+
+static void genePairSet_setSections (GenePairSet *set)
+{
+  unsigned char *pos;
+
+  set->header = (SetHeader*)set->data;
+  pos = set->data + genePairSet_pad (sizeof (SetHeader));
+  set->genes = (SetGene*)pos;
+  pos += genePairSet_pad ((size_t)set->header->numGenes * sizeof (SetGene));
+  set->geneSlots = (uint32_t*)pos;
+  pos += genePairSet_pad ((size_t)set->header->numGeneSlots * sizeof (uint32_t));
+  set->pairSlots = (uint64_t*)pos;
+  pos += genePairSet_pad ((size_t)set->header->numPairSlots * sizeof (uint64_t));
+  set->names = (char*)pos;
+}
+
+
+
+static void genePairSet_check (GenePairSet *set, char *fileName)
+{
+  if (set->dataSize < sizeof (SetHeader) || memcmp (set->data,GENE_PAIR_SET_MAGIC,8) != 0 || genePairSet_getSize ((SetHeader*)set->data) != set->dataSize) {
+    die ("Not a valid gene pair set: %s",fileName);
+  }
+  genePairSet_setSections (set);
+}
+
+
+
+static uint32_t genePairSet_hashName (char *name, int length)
+{
+  uint32_t hash;
+  int i;
+
+  // FNV-1a
+  hash = 2166136261u;
+  for (i = 0; i < length; i++) {
+    hash ^= (unsigned char)name[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+
+
+static uint64_t genePairSet_hashKey (uint64_t key)
+{
+  // finalizer of splitmix64
+  key ^= key >> 30;
+  key *= 0xbf58476d1ce4e5b9ull;
+  key ^= key >> 27;
+  key *= 0x94d049bb133111ebull;
+  return key ^ (key >> 31);
+}
+
+
+
+static uint32_t genePairSet_getSlotCount (uint32_t numItems)
+{
+  uint32_t numSlots;
+
+  for (numSlots = 1; numSlots < 2 * numItems + 1; numSlots *= 2) {
+  }
+  return numSlots;
+}
+
+
+
+/**
+   @return the slot of the gene, empty if the gene is not in the set.
+*/
+static uint32_t genePairSet_findGene (GenePairSet *set, char *name, int length)
+{
+  SetGene *currGene;
+  uint32_t slot,mask;
+
+  mask = set->header->numGeneSlots - 1;
+  for (slot = genePairSet_hashName (name,length) & mask; set->geneSlots[slot] != 0; slot = (slot + 1) & mask) {
+    currGene = set->genes + set->geneSlots[slot] - 1;
+    if (currGene->length == (uint32_t)length && strncmp (set->names + currGene->name,name,length) == 0) {
+      break;
+    }
+  }
+  return slot;
+}
+
+
+
+/**
+   @return the slot of the pair, empty if the pair is not in the set.
+*/
+static uint32_t genePairSet_findPair (GenePairSet *set, uint32_t gene1, uint32_t gene2)
+{
+  uint64_t key;
+  uint32_t slot,mask;
+
+  key = gene1 < gene2 ? ((uint64_t)gene1 << 32 | gene2) : ((uint64_t)gene2 << 32 | gene1);
+  mask = set->header->numPairSlots - 1;
+  for (slot = genePairSet_hashKey (key) & mask; set->pairSlots[slot] != 0 && set->pairSlots[slot] != key + 1; slot = (slot + 1) & mask) {
+  }
+  return slot;
+}
+
+
+
+static uint32_t genePairSet_addGene (GenePairSet *set, char *name)
+{
+  SetGene *currGene;
+  uint32_t slot;
+  int length;
+
+  length = strlen (name);
+  slot = genePairSet_findGene (set,name,length);
+  if (set->geneSlots[slot] == 0) {
+    currGene = set->genes + set->header->numGenes++;
+    currGene->name = set->header->namesSize;
+    currGene->length = length;
+    strcpy (set->names + set->header->namesSize,name);
+    set->header->namesSize += length + 1;
+    set->geneSlots[slot] = set->header->numGenes;
+  }
+  return set->geneSlots[slot] - 1;
+}
+
+
+
+static void* genePairSet_build (Array pairs, size_t *size)
+{
+  GenePairSet set;
+  SetHeader header;
+  GenePair *currPair;
+  uint32_t gene1,gene2,slot;
+  int i;
+
+  // sized for every gene of every pair being different, the sections keep this size
+  memset (&header,0,sizeof (header));
+  memcpy (header.magic,GENE_PAIR_SET_MAGIC,sizeof (header.magic));
+  header.numGenes = 2 * arrayMax (pairs);
+  header.numGeneSlots = genePairSet_getSlotCount (header.numGenes);
+  header.numPairSlots = genePairSet_getSlotCount (arrayMax (pairs));
+  for (i = 0; i < arrayMax (pairs); i++) {
+    currPair = arrp (pairs,i,GenePair);
+    header.namesSize += strlen (currPair->gene1) + strlen (currPair->gene2) + 2;
+  }
+  memset (&set,0,sizeof (set));
+  set.dataSize = genePairSet_getSize (&header);
+  set.data = (unsigned char*)hlr_calloc (set.dataSize,1);
+  memcpy (set.data,&header,sizeof (header));
+  genePairSet_setSections (&set);
+  set.header->numGenes = 0;
+  set.header->namesSize = 0;
+  for (i = 0; i < arrayMax (pairs); i++) {
+    currPair = arrp (pairs,i,GenePair);
+    gene1 = genePairSet_addGene (&set,currPair->gene1);
+    gene2 = genePairSet_addGene (&set,currPair->gene2);
+    slot = genePairSet_findPair (&set,gene1,gene2);
+    if (set.pairSlots[slot] == 0) {
+      set.pairSlots[slot] = (gene1 < gene2 ? ((uint64_t)gene1 << 32 | gene2) : ((uint64_t)gene2 << 32 | gene1)) + 1;
+      set.header->numPairs++;
+    }
+  }
+  set.header->numGenes = header.numGenes;
+  set.header->namesSize = header.namesSize;
+  *size = set.dataSize;
+  return set.data;
+}
+
+
+
+GenePairSet* genePairSet_create (Array pairs)
+{
+  GenePairSet *set;
+
+  AllocVar (set);
+  set->data = (unsigned char*)genePairSet_build (pairs,&set->dataSize);
+  genePairSet_setSections (set);
+  return set;
+}
+
+
+
+int genePairSet_isCompiled (char *fileName)
+{
+  char magic[8];
+  FILE *fp;
+  int isCompiled;
+
+  if ((fp = fopen (fileName,"r")) == NULL) {
+    die ("Unable to open file: %s",fileName);
+  }
+  isCompiled = fread (magic,1,sizeof (magic),fp) == sizeof (magic) && memcmp (magic,GENE_PAIR_SET_MAGIC,sizeof (magic)) == 0;
+  fclose (fp);
+  return isCompiled;
+}
+
+
+
+static void genePairSet_map (GenePairSet *set, char *fileName)
+{
+  struct stat info;
+  int fd;
+
+  if ((fd = open (fileName,O_RDONLY)) < 0 || fstat (fd,&info) != 0) {
+    die ("Unable to open the gene pair set: %s",fileName);
+  }
+  set->dataSize = info.st_size;
+  set->data = (unsigned char*)mmap (NULL,set->dataSize,PROT_READ,MAP_SHARED,fd,0);
+  close (fd);
+  if (set->data == MAP_FAILED) {
+    die ("Unable to map the gene pair set: %s",fileName);
+  }
+  set->isMapped = 1;
+  genePairSet_check (set,fileName);
+}
+
+
+
+void* genePairSet_compileInMemory (char *fileName, size_t *size)
+{
+  GenePairSet set;
+  LineStream ls;
+  WordIter w;
+  Array pairs;
+  GenePair *currPair;
+  char *line,*gene1,*gene2;
+  unsigned char *data;
+  int i;
+
+  if (genePairSet_isCompiled (fileName)) {
+    memset (&set,0,sizeof (set));
+    genePairSet_map (&set,fileName);
+    data = (unsigned char*)hlr_malloc (set.dataSize);
+    memcpy (data,set.data,set.dataSize);
+    munmap (set.data,set.dataSize);
+    *size = set.dataSize;
+    return data;
+  }
+  pairs = arrayCreate (10000,GenePair);
+  ls = ls_createFromFile (fileName);
+  while (line = ls_nextLine (ls)) {
+    if (line[0] == '#' || line[0] == '@') {
+      continue;
+    }
+    w = wordIterCreate (line,"\t",1);
+    gene1 = wordNext (w);
+    gene2 = gene1 != NULL ? wordNext (w) : NULL;
+    if (gene2 != NULL) {
+      currPair = arrayp (pairs,arrayMax (pairs),GenePair);
+      currPair->gene1 = hlr_strdup (gene1);
+      currPair->gene2 = hlr_strdup (gene2);
+    }
+    wordIterDestroy (w);
+  }
+  ls_destroy (ls);
+  data = (unsigned char*)genePairSet_build (pairs,size);
+  for (i = 0; i < arrayMax (pairs); i++) {
+    currPair = arrp (pairs,i,GenePair);
+    hlr_free (currPair->gene1);
+    hlr_free (currPair->gene2);
+  }
+  arrayDestroy (pairs);
+  return data;
+}
+
+
+
+GenePairSet* genePairSet_open (char *fileName)
+{
+  GenePairSet *set;
+  size_t size;
+
+  AllocVar (set);
+  if ((set->data = (unsigned char*)annotationPack_getSection (fileName,&size)) != NULL) {
+    set->dataSize = size;
+    set->isBorrowed = 1;
+    genePairSet_check (set,fileName);
+  }
+  else if (genePairSet_isCompiled (fileName)) {
+    genePairSet_map (set,fileName);
+  }
+  else {
+    set->data = (unsigned char*)genePairSet_compileInMemory (fileName,&set->dataSize);
+    genePairSet_setSections (set);
+  }
+  return set;
+}
+
+
+
+int genePairSet_contains (GenePairSet *set, char *gene1, char *gene2)
+{
+  uint32_t slot1,slot2;
+
+  slot1 = genePairSet_findGene (set,gene1,strlen (gene1));
+  if (set->geneSlots[slot1] == 0) {
+    return 0;
+  }
+  slot2 = genePairSet_findGene (set,gene2,strlen (gene2));
+  if (set->geneSlots[slot2] == 0) {
+    return 0;
+  }
+  return set->pairSlots[genePairSet_findPair (set,set->geneSlots[slot1] - 1,set->geneSlots[slot2] - 1)] != 0;
+}
+
+
+
+int genePairSet_count (GenePairSet *set)
+{
+  return set->header->numPairs;
+}
+
+
+
+void genePairSet_destroy (GenePairSet *set)
+{
+  if (set == NULL) {
+    return;
+  }
+  if (set->isMapped) {
+    munmap (set->data,set->dataSize);
+  }
+  else if (!set->isBorrowed) {
+    hlr_free (set->data);
+  }
+  freeMem (set);
+}
@@ -0,0 +1,48 @@
+#ifndef DEF_GENE_PAIR_SET_H
+#define DEF_GENE_PAIR_SET_H
+
+#include <stddef.h>
+#include <bios/format.h>
+
+
+
+/**
+   @file genePairSet.h
+   @brief Set of unordered pairs of gene symbols, e.g. the black list and the white list of fusion candidates.
+   @details The gene symbols are interned into dense numbers through an open-addressing hash, and each pair is stored once under its canonical key (smaller number, larger number) in a second open-addressing hash, so a single probe answers both orientations of a candidate. The set is pointer-free: a list of millions of pairs can be compiled once with genePairs2genePairSet and mapped in memory (mmap) by genePairSet_open(), or added to the annotation pack (see annotationPack.h).
+ */
+
+
+
+typedef struct _genePairSet GenePairSet;
+
+
+
+/**
+   Pair of gene symbols given to genePairSet_create().
+*/
+typedef struct {
+  char* gene1;
+  char* gene2;
+} GenePair;
+
+
+
+/** create the set of the pairs. */
+extern GenePairSet* genePairSet_create (Array pairs /**< [in] Array of GenePair */);
+/** @return the compiled set of a file of tab-delimited pairs (lines starting with # or @ are skipped), or the content of a compiled set, e.g. to be written to a file. @remark to be freed with hlr_free(). */
+extern void* genePairSet_compileInMemory (char* fileName, size_t* size);
+/** @return 1 if fileName is a set compiled with genePairs2genePairSet, 0 otherwise. */
+extern int genePairSet_isCompiled (char* fileName);
+/** open the set of a file of tab-delimited pairs: from the annotation pack if the file is in it, mapped if it is compiled, otherwise built from the text. @remark the program dies if the file cannot be read. */
+extern GenePairSet* genePairSet_open (char* fileName);
+/** @return 1 if the pair gene1/gene2, in either order, is in the set, 0 otherwise. */
+extern int genePairSet_contains (GenePairSet* set, char* gene1, char* gene2);
+/** @return the number of pairs of the set. */
+extern int genePairSet_count (GenePairSet* set);
+/** de-allocate, or unmap, the set. */
+extern void genePairSet_destroy (GenePairSet* set);
+
+
+
+#endif
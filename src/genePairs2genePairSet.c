@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <bios/log.h>
+#include <bios/format.h>
+
+#include "genePairSet.h"
+
+
+
+/**
+   @file genePairs2genePairSet.c
+   @brief Compile a list of gene pairs, e.g. a black list or a white list of millions of pairs, into a gene pair set.
+   @details The set is mapped in memory (mmap) by genePairSet_open(), so gfrBlackListFilter (BLACKLIST_FILENAME) and gfrWhiteListFilter accept the compiled file in place of the text file and do not need to parse and hash the list at every run. The coordinate lines (starting with @) of a white list are not part of the set. The file is only valid on machines with the same byte order.
+   @pre A tab-delimited file with two gene symbols per line.
+   @remarks Ex: genePairs2genePairSet blackList.txt blackList.genePairSet
+ */
+
+
+
+int main (int argc, char *argv[])
+{
+  Stringa tmpFileName;
+  FILE *fp;
+  void *data;
+  size_t size;
+
+  if (argc != 3) {
+    usage ("%s <pairs.txt> <pairs.genePairSet>",argv[0]);
+  }
+  data = genePairSet_compileInMemory (argv[1],&size);
+  // the set appears under its name only when it is complete
+  tmpFileName = stringCreate (100);
+  stringPrintf (tmpFileName,"%s.tmp",argv[2]);
+  if ((fp = fopen (string (tmpFileName),"wb")) == NULL) {
+    die ("Unable to open file: %s",string (tmpFileName));
+  }
+  if (fwrite (data,1,size,fp) != size || fclose (fp) != 0 || rename (string (tmpFileName),argv[2]) != 0) {
+    die ("Unable to write the gene pair set: %s",argv[2]);
+  }
+  stringDestroy (tmpFileName);
+  hlr_free (data);
+  warn ("%s_set: %s",argv[0],argv[2]);
+  return 0;
+}
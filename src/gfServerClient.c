@@ -0,0 +1,587 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/file.h>
+#include <sys/wait.h>
+
+#include <bios/log.h>
+#include <bios/format.h>
+
+#include "conf.h"
+#include "metrics.h"
+#include "gfServerClient.h"
+
+
+
+#define GF_SIGNATURE "0ddf270562684f29" // prefix of every request to gfServer
+#define MIN_BACKOFF 100000 // microseconds
+#define MAX_BACKOFF 10000000 // microseconds
+#define START_TIMEOUT 600 // seconds
+#define MAX_CLIENT_ATTEMPTS 10
+#define DEFAULT_MAX_CLIENTS 4
+#define DEFAULT_IDLE_TIMEOUT 600 // seconds
+#define STOP_TIMEOUT 60 // seconds
+#define NUM_PORTS 100 // ports handed out from BLAT_GFSERVER_PORT
+
+
+
+/**
+   Server in the registry of the host.
+*/
+typedef struct {
+  int port;
+  char *twoBitFile;
+  long lastUsed; // time when the last client left
+  Array clients; // Array of int, the pids of the processes using the server
+  int isIdle; // set if the last client left, or died, while the registry was locked
+} Server;
+
+
+
+static int gfServerClient_connect (char *host, int port)
+{
+  struct addrinfo hints,*result,*curr;
+  char portName[16];
+  int sd;
+
+  memset (&hints,0,sizeof (hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  sprintf (portName,"%d",port);
+  if (getaddrinfo (host,portName,&hints,&result) != 0) {
+    return -1;
+  }
+  sd = -1;
+  for (curr = result; curr != NULL; curr = curr->ai_next) {
+    if ((sd = socket (curr->ai_family,curr->ai_socktype,curr->ai_protocol)) < 0) {
+      continue;
+    }
+    if (connect (sd,curr->ai_addr,curr->ai_addrlen) == 0) {
+      break;
+    }
+    close (sd);
+    sd = -1;
+  }
+  freeaddrinfo (result);
+  return sd;
+}
+
+
+
+static int gfServerClient_read (int sd, char *buffer, int size)
+{
+  int numRead,n;
+
+  numRead = 0;
+  while (numRead < size) {
+    if ((n = read (sd,buffer + numRead,size - numRead)) <= 0) {
+      return 0;
+    }
+    numRead += n;
+  }
+  return 1;
+}
+
+
+
+static int gfServerClient_readString (int sd, char *buffer)
+{
+  unsigned char length;
+
+  // gfServer sends strings as one byte with the length followed by the characters
+  if (!gfServerClient_read (sd,(char*)&length,1) || !gfServerClient_read (sd,buffer,length)) {
+    return 0;
+  }
+  buffer[length] = '\0';
+  return 1;
+}
+
+
+
+int gfServerClient_status (char *host, int port)
+{
+  char buffer[256];
+  int sd,ready;
+
+  if ((sd = gfServerClient_connect (host,port)) < 0) {
+    return 0;
+  }
+  sprintf (buffer,"%sstatus",GF_SIGNATURE);
+  ready = 0;
+  if (write (sd,buffer,strlen (buffer)) == strlen (buffer)) {
+    while (gfServerClient_readString (sd,buffer)) {
+      if (strEqual (buffer,"end")) {
+        ready = 1;
+        break;
+      }
+    }
+  }
+  close (sd);
+  return ready;
+}
+
+
+
+static int gfServerClient_backoff (int delay)
+{
+  usleep (delay);
+  return delay * 2 < MAX_BACKOFF ? delay * 2 : MAX_BACKOFF;
+}
+
+
+
+int gfServerClient_waitReady (char *host, int port, int timeout)
+{
+  time_t startTime;
+  int delay;
+
+  startTime = time (NULL);
+  delay = MIN_BACKOFF;
+  while (!gfServerClient_status (host,port)) {
+    if (time (NULL) - startTime > timeout) {
+      return 0;
+    }
+    delay = gfServerClient_backoff (delay);
+  }
+  return 1;
+}
+
+
+
+static int gfServerClient_lock (int port, char *suffix, int wait)
+{
+  static Stringa fileName = NULL;
+  int fd;
+
+  stringCreateClear (fileName,100);
+  stringPrintf (fileName,"%s/gfServer_%d.%s.lock",conf_get ()->tmpDir,port,suffix);
+  if ((fd = open (string (fileName),O_RDWR | O_CREAT,0666)) < 0) {
+    die ("Unable to open the lock file: %s",string (fileName));
+  }
+  if (flock (fd,wait ? LOCK_EX : LOCK_EX | LOCK_NB) != 0) {
+    close (fd);
+    return -1;
+  }
+  return fd;
+}
+
+
+
+static void gfServerClient_unlock (int fd)
+{
+  flock (fd,LOCK_UN);
+  close (fd);
+}
+
+
+
+static int gfServerClient_quit (char *host, int port)
+{
+  char buffer[64];
+  int sd,isSent;
+
+  if ((sd = gfServerClient_connect (host,port)) < 0) {
+    return 0;
+  }
+  // the server stops on this request since it is started with -canStop
+  sprintf (buffer,"%squit",GF_SIGNATURE);
+  isSent = write (sd,buffer,strlen (buffer)) == strlen (buffer);
+  close (sd);
+  return isSent;
+}
+
+
+
+static int gfServerClient_isUp (char *host, int port)
+{
+  int sd;
+
+  if ((sd = gfServerClient_connect (host,port)) < 0) {
+    return 0;
+  }
+  close (sd);
+  return 1;
+}
+
+
+
+static int gfServerClient_lockRegistry (void)
+{
+  Stringa fileName;
+  char hostName[256];
+  int fd;
+
+  // one registry per host, since the servers run on the host of the clients
+  if (gethostname (hostName,sizeof (hostName)) != 0) {
+    strcpy (hostName,"localhost");
+  }
+  hostName[sizeof (hostName) - 1] = '\0';
+  fileName = stringCreate (100);
+  stringPrintf (fileName,"%s/gfServer_%s.registry",conf_get ()->tmpDir,hostName);
+  if ((fd = open (string (fileName),O_RDWR | O_CREAT,0666)) < 0 || flock (fd,LOCK_EX) != 0) {
+    die ("Unable to lock the gfServer registry: %s",string (fileName));
+  }
+  stringDestroy (fileName);
+  return fd;
+}
+
+
+
+static int gfServerClient_isAlive (int pid)
+{
+  return kill (pid,0) == 0 || errno != ESRCH;
+}
+
+
+
+static Array gfServerClient_readRegistry (int fd)
+{
+  Array servers;
+  Server *currServer;
+  FILE *fp;
+  char *line,*pos,*token;
+  size_t size;
+  long pid;
+  int i,numClients;
+
+  // one line per server: port, time of the last use, pids of the clients ("-" if none), 2bit file
+  servers = arrayCreate (10,Server);
+  lseek (fd,0,SEEK_SET);
+  if ((fp = fdopen (dup (fd),"r")) == NULL) {
+    die ("Unable to read the gfServer registry");
+  }
+  line = NULL;
+  size = 0;
+  while (getline (&line,&size,fp) > 0) {
+    if ((pos = strchr (line,'\n')) != NULL) {
+      *pos = '\0';
+    }
+    currServer = arrayp (servers,arrayMax (servers),Server);
+    currServer->port = strtol (line,&pos,10);
+    currServer->lastUsed = strtol (pos,&pos,10);
+    currServer->clients = arrayCreate (10,int);
+    currServer->isIdle = 0;
+    while (*pos == ' ' || *pos == '\t') {
+      pos++;
+    }
+    token = pos;
+    if ((pos = strchr (token,'\t')) == NULL) {
+      die ("Not a valid line in the gfServer registry: %s",line);
+    }
+    *pos = '\0';
+    currServer->twoBitFile = hlr_strdup (pos + 1);
+    numClients = 0;
+    for (pos = token; *pos != '\0' && *pos != '-'; pos++) {
+      pid = strtol (pos,&pos,10);
+      // the clients that died without releasing the server are dropped
+      if (pid > 0 && gfServerClient_isAlive (pid)) {
+        array (currServer->clients,arrayMax (currServer->clients),int) = pid;
+      }
+      numClients++;
+      if (*pos == '\0') {
+        break;
+      }
+    }
+    if (numClients > 0 && arrayMax (currServer->clients) == 0) {
+      currServer->lastUsed = time (NULL);
+      currServer->isIdle = 1;
+    }
+  }
+  free (line);
+  fclose (fp);
+  // servers without clients that are not running any more (e.g. after a reboot) are dropped
+  for (i = 0; i < arrayMax (servers); i++) {
+    currServer = arrp (servers,i,Server);
+    if (arrayMax (currServer->clients) == 0 && !gfServerClient_isUp (conf_get ()->blatGfServerHost,currServer->port)) {
+      currServer->port = -1;
+      currServer->isIdle = 0;
+    }
+  }
+  return servers;
+}
+
+
+
+static void gfServerClient_writeRegistry (int fd, Array servers)
+{
+  Stringa buffer;
+  Server *currServer;
+  int i,j;
+
+  buffer = stringCreate (1000);
+  for (i = 0; i < arrayMax (servers); i++) {
+    currServer = arrp (servers,i,Server);
+    if (currServer->port < 0) {
+      continue;
+    }
+    stringAppendf (buffer,"%d\t%ld\t",currServer->port,currServer->lastUsed);
+    for (j = 0; j < arrayMax (currServer->clients); j++) {
+      stringAppendf (buffer,"%s%d",j > 0 ? "," : "",arru (currServer->clients,j,int));
+    }
+    stringAppendf (buffer,"%s\t%s\n",arrayMax (currServer->clients) == 0 ? "-" : "",currServer->twoBitFile);
+  }
+  if (ftruncate (fd,0) != 0 || lseek (fd,0,SEEK_SET) != 0 || write (fd,string (buffer),stringLen (buffer)) != stringLen (buffer)) {
+    die ("Unable to write the gfServer registry");
+  }
+  stringDestroy (buffer);
+}
+
+
+
+static void gfServerClient_freeRegistry (Array servers)
+{
+  int i;
+
+  for (i = 0; i < arrayMax (servers); i++) {
+    hlr_free (arrp (servers,i,Server)->twoBitFile);
+    arrayDestroy (arrp (servers,i,Server)->clients);
+  }
+  arrayDestroy (servers);
+}
+
+
+
+static Server* gfServerClient_findServer (Array servers, char *twoBitFile, int port)
+{
+  Server *currServer;
+  int i;
+
+  for (i = 0; i < arrayMax (servers); i++) {
+    currServer = arrp (servers,i,Server);
+    if (currServer->port >= 0 && (twoBitFile != NULL ? strEqual (currServer->twoBitFile,twoBitFile) : currServer->port == port)) {
+      return currServer;
+    }
+  }
+  return NULL;
+}
+
+
+
+static int gfServerClient_getIdleTimeout (void)
+{
+  return conf_get ()->blatGfServerIdleTimeout != 0 ? conf_get ()->blatGfServerIdleTimeout : DEFAULT_IDLE_TIMEOUT;
+}
+
+
+
+static void gfServerClient_reap (int port, int idleTimeout)
+{
+  Array servers;
+  Server *currServer;
+  time_t startTime;
+  int fd;
+
+  sleep (idleTimeout);
+  fd = gfServerClient_lockRegistry ();
+  servers = gfServerClient_readRegistry (fd);
+  currServer = gfServerClient_findServer (servers,NULL,port);
+  // a server used again in the meantime is left to the reaper of its last client
+  if (currServer != NULL && arrayMax (currServer->clients) == 0 && time (NULL) - currServer->lastUsed >= idleTimeout) {
+    gfServerClient_quit (conf_get ()->blatGfServerHost,port);
+    startTime = time (NULL);
+    while (gfServerClient_isUp (conf_get ()->blatGfServerHost,port) && time (NULL) - startTime < STOP_TIMEOUT) {
+      usleep (MIN_BACKOFF);
+    }
+    currServer->port = -1;
+    gfServerClient_writeRegistry (fd,servers);
+  }
+  gfServerClient_freeRegistry (servers);
+  gfServerClient_unlock (fd);
+}
+
+
+
+static void gfServerClient_scheduleStop (int port)
+{
+  pid_t pid;
+  int fd,idleTimeout;
+
+  if ((idleTimeout = gfServerClient_getIdleTimeout ()) < 0) {
+    return;
+  }
+  fflush (NULL);
+  if ((pid = fork ()) < 0) {
+    warn ("Unable to schedule the stop of the gfServer on port %d",port);
+    return;
+  }
+  if (pid > 0) {
+    waitpid (pid,NULL,0);
+    return;
+  }
+  // detached reaper: it must not keep the pipes of the pipeline open
+  setsid ();
+  if (fork () != 0) {
+    _exit (0);
+  }
+  for (fd = sysconf (_SC_OPEN_MAX) - 1; fd > 2; fd--) {
+    close (fd);
+  }
+  if ((fd = open ("/dev/null",O_RDWR)) >= 0) {
+    dup2 (fd,0);
+    dup2 (fd,1);
+    dup2 (fd,2);
+    if (fd > 2) {
+      close (fd);
+    }
+  }
+  gfServerClient_reap (port,idleTimeout);
+  _exit (0);
+}
+
+
+
+static void gfServerClient_scheduleIdleStops (Array servers)
+{
+  int i;
+
+  for (i = 0; i < arrayMax (servers); i++) {
+    if (arrp (servers,i,Server)->port >= 0 && arrp (servers,i,Server)->isIdle) {
+      gfServerClient_scheduleStop (arrp (servers,i,Server)->port);
+    }
+  }
+}
+
+
+
+static int gfServerClient_register (char *twoBitFile)
+{
+  Conf *conf;
+  Array servers;
+  Server *currServer;
+  int fd,port;
+
+  conf = conf_get ();
+  fd = gfServerClient_lockRegistry ();
+  servers = gfServerClient_readRegistry (fd);
+  if ((currServer = gfServerClient_findServer (servers,twoBitFile,0)) == NULL) {
+    // the first port not handed out and not used by another program
+    for (port = conf->blatGfServerPort; port < conf->blatGfServerPort + NUM_PORTS; port++) {
+      if (gfServerClient_findServer (servers,NULL,port) == NULL && !gfServerClient_isUp (conf->blatGfServerHost,port)) {
+        break;
+      }
+    }
+    if (port == conf->blatGfServerPort + NUM_PORTS) {
+      die ("No free port for gfServer in %d-%d",conf->blatGfServerPort,port - 1);
+    }
+    currServer = arrayp (servers,arrayMax (servers),Server);
+    currServer->port = port;
+    currServer->twoBitFile = hlr_strdup (twoBitFile);
+    currServer->clients = arrayCreate (10,int);
+  }
+  array (currServer->clients,arrayMax (currServer->clients),int) = getpid ();
+  currServer->isIdle = 0;
+  port = currServer->port;
+  gfServerClient_writeRegistry (fd,servers);
+  gfServerClient_unlock (fd);
+  gfServerClient_scheduleIdleStops (servers);
+  gfServerClient_freeRegistry (servers);
+  return port;
+}
+
+
+
+int gfServerClient_start (char *twoBitFile, char *name)
+{
+  Conf *conf;
+  Stringa cmd;
+  int fd,port;
+
+  conf = conf_get ();
+  port = gfServerClient_register (twoBitFile);
+  if (gfServerClient_status (conf->blatGfServerHost,port)) {
+    return port;
+  }
+  fd = gfServerClient_lock (port,"start",1);
+  if (!gfServerClient_status (conf->blatGfServerHost,port)) { // another process may have started it in the meantime
+    cmd = stringCreate (100);
+    stringPrintf (cmd,"%s -repMatch=100000 -tileSize=12 -canStop -log=%s/gfServer_%s.log start %s %d %s </dev/null >/dev/null 2>&1 &",
+                  conf->blatGfServer,conf->tmpDir,name,conf->blatGfServerHost,port,twoBitFile);
+    metrics_system (string (cmd),0);
+    stringDestroy (cmd);
+    if (!gfServerClient_waitReady (conf->blatGfServerHost,port,START_TIMEOUT)) {
+      die ("gfServer for %s not initialized: %s %s %d",twoBitFile,conf->blatGfServer,conf->blatGfServerHost,port);
+    }
+  }
+  gfServerClient_unlock (fd);
+  return port;
+}
+
+
+
+void gfServerClient_release (int port)
+{
+  Array servers;
+  Server *currServer;
+  int fd,i;
+
+  fd = gfServerClient_lockRegistry ();
+  servers = gfServerClient_readRegistry (fd);
+  if ((currServer = gfServerClient_findServer (servers,NULL,port)) != NULL) {
+    for (i = 0; i < arrayMax (currServer->clients); i++) {
+      if (arru (currServer->clients,i,int) == getpid ()) {
+        arru (currServer->clients,i,int) = arru (currServer->clients,arrayMax (currServer->clients) - 1,int);
+        arrayMax (currServer->clients)--;
+        break;
+      }
+    }
+    if (arrayMax (currServer->clients) == 0) {
+      currServer->lastUsed = time (NULL);
+      currServer->isIdle = 1;
+    }
+  }
+  gfServerClient_writeRegistry (fd,servers);
+  gfServerClient_unlock (fd);
+  gfServerClient_scheduleIdleStops (servers);
+  gfServerClient_freeRegistry (servers);
+}
+
+
+
+static int gfServerClient_acquire (int port)
+{
+  char slot[16];
+  int i,fd,maxClients,delay;
+  time_t startTime;
+
+  maxClients = conf_get ()->blatGfServerMaxClients > 0 ? conf_get ()->blatGfServerMaxClients : DEFAULT_MAX_CLIENTS;
+  startTime = time (NULL);
+  delay = MIN_BACKOFF;
+  for (;;) {
+    for (i = 0; i < maxClients; i++) {
+      sprintf (slot,"%d",i);
+      if ((fd = gfServerClient_lock (port,slot,0)) >= 0) {
+        return fd;
+      }
+    }
+    if (time (NULL) - startTime > START_TIMEOUT) {
+      die ("No free client slot of gfServer on port %d after %d seconds (%d slots)",port,START_TIMEOUT,maxClients);
+    }
+    delay = gfServerClient_backoff (delay);
+  }
+}
+
+
+
+void gfServerClient_run (int port, char *cmd)
+{
+  int fd,attempts,delay;
+
+  fd = gfServerClient_acquire (port);
+  attempts = 0;
+  delay = MIN_BACKOFF;
+  while (metrics_system (cmd,1) != 0) {
+    if (++attempts == MAX_CLIENT_ATTEMPTS) {
+      die ("Cannot map the reads %s",cmd);
+    }
+    delay = gfServerClient_backoff (delay);
+  }
+  gfServerClient_unlock (fd);
+}
@@ -0,0 +1,34 @@
+#ifndef DEF_GF_SERVER_CLIENT_H
+#define DEF_GF_SERVER_CLIENT_H
+
+
+
+/**
+   @file gfServerClient.h
+   @brief Client of the Blat gfServer.
+   @details The readiness of a gfServer is checked by speaking its protocol directly (the "status" request), instead of spawning 'gfServer status' in a loop. Waiting for a server and retrying a failed gfClient call use an exponential backoff. The number of gfClient calls in flight against the same server is bounded by BLAT_GFSERVER_MAX_CLIENTS (default: 4) across all the processes sharing TMP_DIR, using one lock file per slot.
+   The servers are shared by all the processes of a host. The registry TMP_DIR/gfServer_<host>.registry, locked with flock(), maps each 2bit file to the port of its server, handed out from BLAT_GFSERVER_PORT on, and lists the pids of its clients; the clients that died without releasing the server are dropped. When the last client leaves, a detached process stops the server if it is still without clients after BLAT_GFSERVER_IDLE_TIMEOUT seconds (default: 600; -1 keeps it running), so the genome index is loaded once for many samples in a row.
+   The alignments themselves are still computed by gfClient, since the PSL output requires the Blat aligner on the client side.
+ */
+
+
+
+/** check if the gfServer is up and answering requests.
+    @return 1 if the server answered the status request, 0 otherwise. */
+extern int gfServerClient_status (char* host, int port);
+/** wait until the gfServer is ready, polling with an exponential backoff.
+    @return 1 if the server is ready, 0 if it did not answer within timeout seconds. */
+extern int gfServerClient_waitReady (char* host, int port, int timeout);
+/** start a gfServer on BLAT_GFSERVER_HOST with the given 2bit file, unless one is already running on this host, and wait until it is ready. The calling process is registered as a client of the server until gfServerClient_release(). Concurrent processes starting the same server are serialized with a lock file in TMP_DIR.
+    @return the port of the server. @pre conf_init() has been called. @remark the program dies if the server cannot be started. */
+extern int gfServerClient_start (char* twoBitFile /**< [in] path of the reference in 2bit format */, char* name /**< [in] name of the reference, used for the log file TMP_DIR/gfServer_name.log */);
+/** unregister the calling process as a client of the server on port. The server is stopped once it has been without clients for BLAT_GFSERVER_IDLE_TIMEOUT seconds.
+    @pre conf_init() has been called. */
+extern void gfServerClient_release (int port);
+/** run a gfClient command line against the server on port, holding one of the BLAT_GFSERVER_MAX_CLIENTS slots. A failed call is retried with an exponential backoff.
+    @pre conf_init() has been called. @remark the program dies if no slot frees up within 10 minutes or if the call keeps failing. */
+extern void gfServerClient_run (int port, char* cmd);
+
+
+
+#endif
@@ -5,6 +5,7 @@
 #include <bios/bits.h>
 
 #include "gfr.h"
+#include "metrics.h"
 
 
 
@@ -199,9 +200,11 @@ int gfr_init (char *fileName)
 {
   int i;
   Texta tokens;
+  metrics_init (NULL);
   lsGfr = ls_createFromFile (fileName);
   char* firstLine = ls_nextLine( lsGfr );
   if( firstLine==NULL) return 0;
+  metrics_addBytesRead (strlen (firstLine) + 1);
   columnTypes = arrayCreate (20,int);
   columnHeaders = textCreate (20);
   presentColumnTypes = bitAlloc (100);  
@@ -326,6 +329,8 @@ static GfrEntry* gfr_processNextEntry (int freeMemory)
       if (freeMemory) {
         gfr_freeEntry (currEntry);
       }
+      metrics_addEntriesIn (1);
+      metrics_addBytesRead (strlen (line) + 1);
       AllocVar (currEntry);
       index = 0;
       w = wordIterCreate (line,"\t",0);
@@ -567,6 +572,7 @@ char* gfr_writeHeader (void)
     stringAppendf (buffer,"%s%s",textItem (columnHeaders,i), 
 		   i < arrayMax (columnHeaders) - 1 ? "\t" : "");
   }
+  metrics_addBytesWritten (stringLen (buffer) + 1);
   return string (buffer);
 }
 
@@ -763,6 +769,13 @@ char* gfr_writeGfrEntry (GfrEntry *currEntry)
       stringAppendf (buffer,"%f",currEntry->RESPER);
     }
   }
+  for (j = 0; currEntry->interReads != NULL && j < arrayMax (currEntry->interReads); j++) {
+    if (arrp (currEntry->interReads,j,GfrInterRead)->flag != 0) {
+      metrics_addReadsFlagged (1);
+    }
+  }
+  metrics_addEntriesOut (1);
+  metrics_addBytesWritten (stringLen (buffer) + 1);
   return string (buffer);
 }
 
@@ -3,13 +3,14 @@
 #include <unistd.h>
 #include <sys/types.h>
 
-#include <bios/confp.h>
 #include <bios/log.h>
 #include <bios/format.h>
 #include <bios/numUtil.h>
 #include <bios/fasta.h>
 
+#include "conf.h"
 #include "gfr.h"
+#include "twoBit.h"
 
 /**
   @file gfr2bpJunction.c 
@@ -36,7 +37,8 @@ typedef struct {
 } Region;
 
 
-static config *Conf = NULL;
+static Conf *conf = NULL;
+static TwoBit *twoBit = NULL;
 
 static int sortTilesByName (Seq *a, Seq *b)
 {
@@ -125,39 +127,36 @@ static Array getTilesForRegion (int tileSize,
 				int junctionIsToTheRightOfTile) 
 {
   Stringa buffer;
-  Stringa targetsFile;
-  FILE *fp;
   Array targetSeqs;
-  int i;
+  Seq *currSeq;
+  char *regionSequence;
+  int i,chromosomeSize;
 
-  buffer = stringCreate (100);
-  targetsFile = stringCreate (100);
-  stringPrintf (targetsFile,"targets_%d.txt",getpid ());
-  if (!(fp = fopen (string (targetsFile),"w")) ){
-    die ("Unable to open target file: %s",string (targetsFile));
-  }
   if (junctionIsToTheRightOfTile == 1) {
-    for (i = start - tileSize; i <= end - tileSize; i++) {
-      fprintf (fp,"%s:%d-%d\n",chromosome,i,i + tileSize);
-    }
+    start -= tileSize;
+    end -= tileSize;
+  }
+  targetSeqs = arrayCreate (end - start + 2,Seq);
+  chromosomeSize = twoBit_getSequenceSize (twoBit,chromosome);
+  if (chromosomeSize < 0 || end < start) {
+    return targetSeqs;
   }
-  else {
-    for (i = start; i <= end; i++) {
-      fprintf (fp,"%s:%d-%d\n",chromosome,i,i + tileSize);
+  // the tiles overlap: the whole region is extracted once
+  regionSequence = twoBit_getRegion (twoBit,chromosome,start,end + tileSize,1);
+  buffer = stringCreate (100);
+  for (i = start; i <= end; i++) {
+    if (i < 0 || i + tileSize > chromosomeSize) {
+      continue;
     }
+    currSeq = arrayp (targetSeqs,arrayMax (targetSeqs),Seq);
+    stringPrintf (buffer,"%s:%d-%d",chromosome,i,i + tileSize);
+    currSeq->name = hlr_strdup (string (buffer));
+    currSeq->sequence = (char*)hlr_malloc (tileSize + 1);
+    strncpy (currSeq->sequence,regionSequence + (i - (start > 0 ? start : 0)),tileSize);
+    currSeq->sequence[tileSize] = '\0';
+    currSeq->size = tileSize;
   }
-  fclose (fp);
-  stringPrintf (buffer,"%s %s/%s stdout -noMask -seqList=%s",
-		confp_get(Conf, "BLAT_TWO_BIT_TO_FA"),
-		confp_get(Conf, "BLAT_DATA_DIR"),
-		confp_get(Conf, "BLAT_TWO_BIT_DATA_FILENAME"),
-		string (targetsFile));
-  fasta_initFromPipe (string (buffer));
-  targetSeqs = fasta_readAllSequences (0);
-  fasta_deInit ();
-  stringPrintf (buffer,"rm -rf %s",string (targetsFile));
-  hlr_system (string (buffer),0);
-  stringDestroy (targetsFile);
+  hlr_free (regionSequence);
   stringDestroy (buffer);
   return targetSeqs;
 }
@@ -265,12 +264,12 @@ static void printCommands (char *id,
 	   id,
 	   orientation,
 	   fileCount,
-	   confp_get(Conf, "BOWTIE_INDEXES"),
+	   conf->bowtieIndexes,
 	   id,
 	   orientation,
 	   fileCount,
 	   gfrPrefix,
-	   confp_get(Conf, "BOWTIE_INDEXES"),
+	   conf->bowtieIndexes,
 	   id,
 	   orientation,
 	   fileCount,
@@ -283,7 +282,7 @@ static void printCommands (char *id,
 	   id,
 	   orientation,
 	   fileCount,
-	   confp_get(Conf, "BOWTIE_INDEXES"),
+	   conf->bowtieIndexes,
 	   id,
 	   orientation,
 	   fileCount);
@@ -335,7 +334,7 @@ static void writeTiles (Array tiles1,
     for (j = 0; j < arrayMax (tiles2); j++) {
       secondSeq = arrp (tiles2,j,Seq);
       numJunctions++; 
-       if (numJunctions == atoi(confp_get(Conf, "MAX_NUMBER_OF_JUNCTIONS_PER_FILE"))) {
+       if (numJunctions == conf->maxNumberOfJunctionsPerFile) {
         printCommands (id,orientation,fileCount,fpJobList1,fpJobList2,gfrPrefix,fileCount == 1 ? 1 : 0,0);
         fclose (fp);
         numJunctions = 0;
@@ -376,8 +375,8 @@ int main (int argc, char *argv[])
     usage ("%s <file.gfr> <tileSize> <sizeFlankingRegion> [minDASPER]",argv[0]);
   }
 
-  if ((Conf = confp_open(getenv("FUSIONSEQ_CONFPATH"))) == NULL)
-    return EXIT_FAILURE;
+  conf = conf_init (argv[0], "BLAT_DATA_DIR", "BLAT_TWO_BIT_DATA_FILENAME", "BOWTIE_INDEXES", "MAX_NUMBER_OF_JUNCTIONS_PER_FILE", NULL);
+  twoBit = twoBit_open (conf_getPath (conf->blatDataDir,conf->blatTwoBitDataFilename));
 
   gfr_init (argv[1]);
   tileSize = atoi (argv[2]);
@@ -440,7 +439,8 @@ int main (int argc, char *argv[])
   fclose (fpJobList2);
   hlr_free (gfrPrefix);
   stringDestroy (buffer);
-  confp_close(Conf);
+  twoBit_close (twoBit);
+  conf_deInit ();
 
   return EXIT_SUCCESS;
 }
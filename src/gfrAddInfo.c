@@ -1,9 +1,9 @@
 #include <stdlib.h>
 
-#include <bios/confp.h>
 #include <bios/log.h>
 #include <bios/format.h>
 
+#include "conf.h"
 #include "util.h"
 #include "gfr.h"
 
@@ -23,32 +23,20 @@
 int main (int argc, char *argv[])
 {
 	GfrEntry *currGE;
-	Array kgXrefs;
+	KgXrefTable *kgXrefs;
 	Stringa buffer;
 	int count;
 
-	config *Conf;
+	Conf *conf;
 	
-	if ((Conf = confp_open(getenv("FUSIONSEQ_CONFPATH"))) == NULL) {
-	  die("%s:\tCannot find .fusionseqrc: %s", argv[0], getenv("FUSIONSEQ_CONFPATH"));
-	  return EXIT_FAILURE;
-	}
-	if( confp_get( Conf, "ANNOTATION_DIR")==NULL ) {
-	  die("%s:\tCannot find ANNOTATION_DIR in the configuration file: %s)", argv[0], getenv("FUSIONSEQ_CONFPATH") );
-	  return EXIT_FAILURE;
-	}
-	if( confp_get( Conf, "KNOWN_GENE_XREF_FILENAME")==NULL ) {
-	  die("%s:\tCannot find KNOWN_GENE_XREF_FILENAME in the configuration file: %s)", argv[0], getenv("FUSIONSEQ_CONFPATH") );
-	  return EXIT_FAILURE;
-	}
+	conf = conf_init (argv[0], "ANNOTATION_DIR", "KNOWN_GENE_XREF_FILENAME", NULL);
 
 	buffer = stringCreate (100);
 	stringPrintf (buffer,"%s/%s",
-		      confp_get(Conf, "ANNOTATION_DIR"),
-		      confp_get(Conf, "KNOWN_GENE_XREF_FILENAME"));
+		      conf->annotationDir,
+		      conf->knownGeneXrefFilename);
 
-	kgXrefs = util_readKnownGeneXrefs (string (buffer));
-	arraySort (kgXrefs,(ARRAYORDERF)sortKgXrefsByTranscriptName);
+	kgXrefs = kgXrefTable_open (string (buffer));
 	stringDestroy (buffer);
 
 	count = 0;
@@ -66,8 +54,9 @@ int main (int argc, char *argv[])
 		count++;
 	}
 	gfr_deInit ();
+	kgXrefTable_close (kgXrefs);
 	warn ("%s_numGfrEntries: %d",argv[0],count);
-	confp_close(Conf);
+	conf_deInit ();
 
 	return EXIT_SUCCESS;
 }
@@ -1,29 +1,71 @@
 #include <bios/log.h>
 #include <bios/format.h>
+#include <bios/linestream.h>
 
 #include "gfr.h"
+#include "termMatcher.h"
 
 /**
    @file gfrAnnotationConsistencyFilter.c
    @brief It removes candidates involving genes with specific description, such as ribosomal, pseudogenes, etc. 
-   @details It removes candidates involving genes with specific text in the gene description, such as ribosomal, pseudogenes, etc
+   @details It removes candidates involving genes with specific text in the gene description, such as ribosomal, pseudogenes, etc. Several strings can be given, on the command line or one per line in a file (-f), and the descriptions are scanned once for all of them (see termMatcher.h); with several strings, the number of strings that removed at least one candidate is reported.
    
    @author Andrea Sboner  (andrea.sboner.w [at] gmail.com).  
    @version 0.8
    @date 2013.09.10
    @remarks WARNings will be output to stdout to summarize the filter results.
-   @prestring string the element to remove, ex. pseudogene.
+   @pre string the element to remove, ex. pseudogene; or -f file.txt, with one string per line (lines starting with # are skipped).
    @pre A valid GFR file as input, including stdin.
  */
 
+static void readTerms (Texta terms, char *fileName)
+{
+  LineStream ls;
+  char *line;
+
+  ls = ls_createFromFile (fileName);
+  while (line = ls_nextLine (ls)) {
+    if (line[0] == '\0' || line[0] == '#') {
+      continue;
+    }
+    textAdd (terms,line);
+  }
+  ls_destroy (ls);
+}
+
 int main (int argc, char *argv[])
 {
 	GfrEntry *currGE;
 	int count;
 	int countRemoved;
+	int countMatched;
+	int i;
+	Texta terms;
+	Array countsRemoved;
+	Array matches1,matches2;
+	TermMatcher *matcher;
  
-	if (argc != 2) {
-		usage ("%s <string>",argv[0]);
+	if (argc < 2) {
+		usage ("%s <string> [string ...] | -f <strings.txt>",argv[0]);
+	}
+	terms = textCreate (10);
+	for (i = 1; i < argc; i++) {
+		if (strEqual (argv[i],"-f")) {
+			if (i + 1 == argc) {
+				usage ("%s <string> [string ...] | -f <strings.txt>",argv[0]);
+			}
+			readTerms (terms,argv[++i]);
+		}
+		else {
+			textAdd (terms,argv[i]);
+		}
+	}
+	matcher = termMatcher_create (terms);
+	matches1 = arrayCreate (10,int);
+	matches2 = arrayCreate (10,int);
+	countsRemoved = arrayCreate (arrayMax (terms),int);
+	for (i = 0; i < arrayMax (terms); i++) {
+		array (countsRemoved,i,int) = 0;
 	}
 	count = 0;
 	countRemoved = 0;
@@ -34,8 +76,18 @@ int main (int argc, char *argv[])
 				currGE->descriptionTranscript2 == NULL) {
 			die ("Transcript description is missing");
 		}
-		if (strCaseStr (currGE->descriptionTranscript1,argv[1]) ||
-		    strCaseStr (currGE->descriptionTranscript2,argv[1])) {
+		termMatcher_findAll (matcher,currGE->descriptionTranscript1,matches1);
+		termMatcher_findAll (matcher,currGE->descriptionTranscript2,matches2);
+		if (arrayMax (matches1) > 0 || arrayMax (matches2) > 0) {
+			// a string found in both descriptions counts once
+			for (i = 0; i < arrayMax (matches2); i++) {
+				array (matches1,arrayMax (matches1),int) = arru (matches2,i,int);
+			}
+			arraySort (matches1,(ARRAYORDERF)arrayIntcmp);
+			arrayUniq (matches1,NULL,(ARRAYORDERF)arrayIntcmp);
+			for (i = 0; i < arrayMax (matches1); i++) {
+				arru (countsRemoved,arru (matches1,i,int),int)++;
+			}
 			countRemoved++;
 			continue;
 		}
@@ -43,9 +95,26 @@ int main (int argc, char *argv[])
 		count++;
 	}
 	gfr_deInit ();
-	warn ("%s_string: %s",argv[0],argv[1]);
+	// the strings themselves are only reported when there is one, as they can contain any character
+	if (arrayMax (terms) == 1) {
+		warn ("%s_string: %s",argv[0],textItem (terms,0));
+	}
+	else {
+		countMatched = 0;
+		for (i = 0; i < arrayMax (terms); i++) {
+			if (arru (countsRemoved,i,int) > 0) {
+				countMatched++;
+			}
+		}
+		warn ("%s_numStrings: %d",argv[0],arrayMax (terms));
+		warn ("%s_numStringsMatched: %d",argv[0],countMatched);
+	}
+	termMatcher_destroy (matcher);
+	arrayDestroy (matches1);
+	arrayDestroy (matches2);
+	arrayDestroy (countsRemoved);
+	textDestroy (terms);
 	warn ("%s_numRemoved: %d",argv[0],countRemoved);
 	warn ("%s_numGfrEntries: %d",argv[0],count);
 	return 0;
 }
-
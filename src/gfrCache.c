@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <sys/stat.h>
+
+#include <bios/log.h>
+#include <bios/format.h>
+
+#include "gfr.h"
+#include "conf.h"
+#include "gfrCache.h"
+#include "kvStore.h"
+
+
+
+#define GFR_CACHE_VERSION 2 // part of the keys: changed when the verdicts of the same inputs change
+
+
+
+extern void updateStats (GfrEntry* currGE);
+
+
+
+static KvStore *store = NULL;
+static Stringa context = NULL;
+static char *cacheName = NULL;
+static int numHits = 0;
+static int numMisses = 0;
+
+
+
+void gfrCache_init (char *filterName, int argc, char *argv[], ...)
+{
+  va_list args;
+  Stringa fileName;
+  char *cacheDir,*key,*pos;
+  int i;
+
+  cacheDir = getenv ("FUSIONSEQ_CACHE_DIR");
+  if (cacheDir == NULL || cacheDir[0] == '\0') {
+    cacheDir = conf_get ()->cacheDir;
+  }
+  if (cacheDir == NULL || cacheDir[0] == '\0') {
+    return;
+  }
+  pos = strrchr (filterName,'/');
+  cacheName = hlr_strdup (pos != NULL ? pos + 1 : filterName);
+  context = stringCreate (100);
+  stringPrintf (context,"%d\t%s",GFR_CACHE_VERSION,cacheName);
+  for (i = 1; i < argc; i++) {
+    stringAppendf (context,"\t%s",argv[i]);
+  }
+  va_start (args,argv);
+  while ((key = va_arg (args,char*)) != NULL) {
+    stringAppendf (context,"\t%s=%s",key,conf_getString (key) != NULL ? conf_getString (key) : "");
+  }
+  va_end (args);
+  fileName = stringCreate (100);
+  stringPrintf (fileName,"%s/%s.cache",cacheDir,cacheName);
+  if ((store = kvStore_open (string (fileName))) == NULL) {
+    warn ("%s: unable to open the cache %s, running without it",cacheName,string (fileName));
+  }
+  stringDestroy (fileName);
+}
+
+
+
+void gfrCache_addContextFile (char *fileName)
+{
+  struct stat info;
+
+  if (store == NULL) {
+    return;
+  }
+  if (stat (fileName,&info) != 0) {
+    stringAppendf (context,"\t%s",fileName);
+    return;
+  }
+  stringAppendf (context,"\t%s:%lld:%lld",fileName,(long long)info.st_size,(long long)info.st_mtime);
+}
+
+
+
+static char* gfrCache_getKey (GfrEntry *currGE)
+{
+  static Stringa buffer = NULL;
+  GfrInterRead *currGIR;
+  int i;
+
+  stringCreateClear (buffer,1000);
+  stringAppendf (buffer,"%s\n%s\t%s\t%d\t%d\t%s\t%s\t%d\t%d\n",string (context),
+                 currGE->nameTranscript1,currGE->chromosomeTranscript1,currGE->startTranscript1,currGE->endTranscript1,
+                 currGE->nameTranscript2,currGE->chromosomeTranscript2,currGE->startTranscript2,currGE->endTranscript2);
+  for (i = 0; currGE->interReads != NULL && i < arrayMax (currGE->interReads); i++) {
+    currGIR = arrp (currGE->interReads,i,GfrInterRead);
+    stringAppendf (buffer,"%d,%d,%d,%d,%d,%d,%d|",currGIR->pairType,currGIR->number1,currGIR->number2,
+                   currGIR->readStart1,currGIR->readEnd1,currGIR->readStart2,currGIR->readEnd2);
+  }
+  for (i = 0; currGE->readsTranscript1 != NULL && i < arrayMax (currGE->readsTranscript1); i++) {
+    stringAppendf (buffer,"%s|",textItem (currGE->readsTranscript1,i));
+  }
+  stringCatChar (buffer,'\n');
+  for (i = 0; currGE->readsTranscript2 != NULL && i < arrayMax (currGE->readsTranscript2); i++) {
+    stringAppendf (buffer,"%s|",textItem (currGE->readsTranscript2,i));
+  }
+  return kvStore_hash (string (buffer),stringLen (buffer));
+}
+
+
+
+int gfrCache_lookup (GfrEntry *currGE, int *keep)
+{
+  char *value;
+  int i,numFlagged;
+
+  if (store == NULL) {
+    return 0;
+  }
+  value = kvStore_get (store,gfrCache_getKey (currGE));
+  if (value == NULL || (value[0] != '0' && value[0] != '1') || value[1] != ':' ||
+      strlen (value + 2) != (currGE->interReads != NULL ? arrayMax (currGE->interReads) : 0)) {
+    numMisses++;
+    return 0;
+  }
+  numHits++;
+  *keep = value[0] == '1';
+  numFlagged = 0;
+  for (i = 0; currGE->interReads != NULL && i < arrayMax (currGE->interReads); i++) {
+    if (value[i + 2] == '1') {
+      arrp (currGE->interReads,i,GfrInterRead)->flag = 1;
+      numFlagged++;
+    }
+  }
+  if (*keep && numFlagged > 0) {
+    updateStats (currGE);
+  }
+  return 1;
+}
+
+
+
+void gfrCache_store (GfrEntry *currGE, int keep)
+{
+  static Stringa value = NULL;
+  int i;
+
+  if (store == NULL) {
+    return;
+  }
+  stringCreateClear (value,100);
+  stringPrintf (value,"%d:",keep ? 1 : 0);
+  for (i = 0; currGE->interReads != NULL && i < arrayMax (currGE->interReads); i++) {
+    stringCatChar (value,arrp (currGE->interReads,i,GfrInterRead)->flag ? '1' : '0');
+  }
+  kvStore_put (store,gfrCache_getKey (currGE),string (value));
+}
+
+
+
+void gfrCache_deInit (void)
+{
+  if (store == NULL) {
+    return;
+  }
+  warn ("%s_cacheHits: %d",cacheName,numHits);
+  warn ("%s_cacheMisses: %d",cacheName,numMisses);
+  kvStore_close (store);
+  store = NULL;
+  stringDestroy (context);
+  hlr_free (cacheName);
+}
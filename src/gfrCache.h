@@ -0,0 +1,33 @@
+#ifndef DEF_GFR_CACHE_H
+#define DEF_GFR_CACHE_H
+
+#include "gfr.h"
+
+
+
+/**
+   @file gfrCache.h
+   @brief Cache of the filter results across re-runs of the pipeline.
+   @details The verdict of a filter (keep/remove) and the flags of the inter-transcript reads are stored in a key-value store (see kvStore.h), one per filter. The key of an entry is the hash of the filter name, its parameters, the relevant configuration values and the columns of the candidate that determine the verdict (transcripts, inter-transcript reads and their sequences), so that a re-run with a different upstream or downstream threshold only recomputes the candidates that changed.
+   The cache is enabled by the environment variable FUSIONSEQ_CACHE_DIR or by CACHE_DIR in .fusionseqrc; the store of each filter is CACHE_DIR/filterName.cache.
+ */
+
+
+
+/** initialization of the cache.
+    @remark the optional arguments are the names of the configuration values that affect the verdict, terminated by NULL. @pre conf_init() has been called. */
+extern void gfrCache_init (char* filterName /**< [in] name of the filter, usually argv[0] */,
+                           int argc /**< [in] number of parameters */, char* argv[] /**< [in] parameters of the filter, argv[0] is skipped */, ...);
+/** add the size and the modification time of a reference file to the context of the cache. @pre gfrCache_init() has been called. */
+extern void gfrCache_addContextFile (char* fileName);
+/** look up the verdict of an entry. If found, the flags of the inter-transcript reads are restored and the stats updated.
+    @return 1 if the entry is in the cache, 0 otherwise (also if the cache is disabled). */
+extern int gfrCache_lookup (GfrEntry* currGE, int* keep /**< [out] 1 if the entry passes the filter */);
+/** store the verdict of an entry and the flags of its inter-transcript reads. */
+extern void gfrCache_store (GfrEntry* currGE, int keep);
+/** de-initialization of the cache. @remark it reports the number of hits. */
+extern void gfrCache_deInit (void);
+
+
+
+#endif
@@ -1,11 +1,12 @@
 #include <stdlib.h>
-#include <bios/confp.h>
 #include <bios/log.h>
 #include <bios/format.h>
 #include <bios/intervalFind.h>
 
+#include "conf.h"
 #include "util.h"
 #include "gfr.h"
+#include "intervalIndex.h"
 
 /**
   \file gfrClassify.c 
@@ -27,25 +28,25 @@ int main (int argc, char *argv[])
 {
 	int i;
 	GfrEntry* gfrE;
-	config *conf;
+	Conf *conf;
+	IntervalIndex *annotationIndex;
   
-	if ((conf = confp_open(getenv("FUSIONSEQ_CONFPATH"))) == NULL)
-		return EXIT_FAILURE;
+	conf = conf_init (argv[0], "ANNOTATION_DIR", "TRANSCRIPT_COMPOSITE_MODEL_FILENAME", NULL);
 
 	Array intervals = arrayCreate( 50, Interval);
 	Stringa buffer = stringCreate (100);
 
 	stringPrintf(buffer,"%s/%s",
-		     confp_get(conf, "ANNOTATION_DIR"),
-		     confp_get(conf, "TRANSCRIPT_COMPOSITE_MODEL_FILENAME"));
-	intervalFind_addIntervalsToSearchSpace (string (buffer),0);
+		     conf->annotationDir,
+		     conf->transcriptCompositeModelFilename);
+	annotationIndex = intervalIndex_open (string (buffer),0);
   
 	gfr_init("-");
 	printf( "%s\n", gfr_writeHeader());
 	while( gfrE = gfr_nextEntry()) {
 		if (strEqual(gfrE->fusionType, "cis" ) && 
 		    (gfrE->strandTranscript1 == gfrE->strandTranscript2)) {
-			intervals = arrayCopy (intervalFind_getOverlappingIntervals (gfrE->chromosomeTranscript1, gfrE->endTranscript1+1, gfrE->startTranscript2-1 ));
+			intervals = arrayCopy (intervalIndex_getOverlappingIntervals (annotationIndex, gfrE->chromosomeTranscript1, gfrE->endTranscript1+1, gfrE->startTranscript2-1 ));
 			stringPrintf(buffer, "read-through");
 			if (arrayMax(intervals)>0) {
 				for (i = 0; i < arrayMax(intervals); i++) {
@@ -68,9 +69,10 @@ int main (int argc, char *argv[])
     
 	}
 	gfr_deInit();
+	intervalIndex_close (annotationIndex);
 	arrayDestroy(intervals);
 	stringDestroy (buffer);
-	confp_close(conf);
+	conf_deInit ();
 
   return 0;
 }
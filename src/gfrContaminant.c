@@ -0,0 +1,325 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <bios/log.h>
+#include <bios/format.h>
+#include <bios/blatParser.h>
+
+#include "gfr.h"
+#include "util.h"
+#include "conf.h"
+#include "gfServerClient.h"
+#include "kmerIndex.h"
+#include "alignmentCache.h"
+#include "subprocess.h"
+#include "gfrContaminant.h"
+#include "uthash.h"
+
+
+
+typedef struct {
+  int minScore;
+  MemFile *reads;
+  MemFile *psl;
+} Batch;
+
+
+
+typedef struct _query {
+  char *read;
+  int entryIndex;
+  int readIndex;
+  int minScore;
+  int span; // overlap of the longest alignment, as getNucleotideOverlap(); -1 until the read is aligned
+  struct _query *same; // pending query with the same read and minimum score, whose span is copied; NULL if none
+} Query;
+
+
+
+typedef struct {
+  char *key; // minimum score and read
+  Query *query; // the one query aligned for the key
+  UT_hash_handle hh;
+} UniqueQuery;
+
+
+
+typedef struct {
+  KmerIndex *index;
+  Array pending; // Array of Query*
+  int first;
+  int step;
+} Worker;
+
+
+
+static Batch* gfrContaminant_getBatch (Array batches, int minScore, char *name)
+{
+  Batch *currBatch;
+  int i;
+
+  for (i = 0; i < arrayMax (batches); i++) {
+    currBatch = arrp (batches,i,Batch);
+    if (currBatch->minScore == minScore) {
+      return currBatch;
+    }
+  }
+  currBatch = arrayp (batches,arrayMax (batches),Batch);
+  currBatch->minScore = minScore;
+  currBatch->reads = subprocess_createMemFile (name);
+  currBatch->psl = subprocess_createMemFile (name);
+  return currBatch;
+}
+
+
+
+static int gfrContaminant_getMinReadSize (GfrEntry *currGE)
+{
+  int l,readSize1,readSize2,minReadSize;
+
+  if (arrayMax (currGE->readsTranscript1) != arrayMax (currGE->readsTranscript2)) {
+    die ("Error: different number of inter-transcript reads %d vs. %d",
+         arrayMax (currGE->readsTranscript1),arrayMax (currGE->readsTranscript2));
+  }
+  minReadSize = 100000;
+  for (l = 0; l < arrayMax (currGE->readsTranscript1); l++) {
+    readSize1 = strlen (textItem (currGE->readsTranscript1,l));
+    readSize2 = strlen (textItem (currGE->readsTranscript2,l));
+    if (readSize1 != readSize2) {
+      die ("The two reads have different lengths: 1:%d vs 2:%d",readSize1,readSize2);
+    }
+    if (readSize1 < minReadSize) {
+      minReadSize = readSize1;
+    }
+  }
+  return minReadSize;
+}
+
+
+
+static void gfrContaminant_alignWithGfClient (Array pending, char *twoBitFile, char *name)
+{
+  Conf *conf;
+  Array batches;
+  Batch *currBatch;
+  Query *currQuery;
+  BlatQuery *blQ;
+  Stringa cmd;
+  int i,queryIndex,overlap,port;
+
+  conf = conf_get ();
+  if (conf->tmpDir == NULL || conf->blatGfServer == NULL || conf->blatGfClient == NULL || conf->blatGfServerHost == NULL) {
+    die ("TMP_DIR, BLAT_GFSERVER, BLAT_GFCLIENT and BLAT_GFSERVER_HOST are required by CONTAMINANT_ALIGNER=gfClient: %s",getenv ("FUSIONSEQ_CONFPATH"));
+  }
+  port = gfServerClient_start (twoBitFile,name);
+
+  // writing all the reads, one file per minimum score
+  batches = arrayCreate (5,Batch);
+  for (i = 0; i < arrayMax (pending); i++) {
+    currQuery = arru (pending,i,Query*);
+    currQuery->span = 0; // reads without a hit are not reported by gfClient
+    currBatch = gfrContaminant_getBatch (batches,currQuery->minScore,name);
+    fprintf (subprocess_getStream (currBatch->reads),">%d\n%s\n",i,currQuery->read);
+  }
+
+  // one gfClient call per file, the results are assigned back to the reads
+  cmd = stringCreate (100);
+  for (i = 0; i < arrayMax (batches); i++) {
+    currBatch = arrp (batches,i,Batch);
+    stringPrintf (cmd,"%s %s %d / -t=dna -q=dna -minScore=%d -out=psl %s %s >/dev/null 2>&1",
+                  conf->blatGfClient,conf->blatGfServerHost,port,currBatch->minScore,
+                  subprocess_getPath (currBatch->reads),subprocess_getPath (currBatch->psl));
+    gfServerClient_run (port,string (cmd));
+    blatParser_initFromFile (subprocess_getPath (currBatch->psl));
+    while (blQ = blatParser_nextQuery ()) {
+      if (sscanf (blQ->qName,"%d",&queryIndex) != 1 || queryIndex < 0 || queryIndex >= arrayMax (pending)) {
+        die ("Not a valid index in the blat query name:\t%s",blQ->qName);
+      }
+      currQuery = arru (pending,queryIndex,Query*);
+      overlap = getNucleotideOverlap (blQ);
+      if (overlap > currQuery->span) {
+        currQuery->span = overlap;
+      }
+    }
+    blatParser_deInit ();
+    subprocess_destroyMemFile (currBatch->reads);
+    subprocess_destroyMemFile (currBatch->psl);
+  }
+  gfServerClient_release (port);
+  stringDestroy (cmd);
+  arrayDestroy (batches);
+}
+
+
+
+static void* gfrContaminant_runWorker (void *data)
+{
+  Worker *worker;
+  Query *currQuery;
+  int i;
+
+  worker = (Worker*)data;
+  for (i = worker->first; i < arrayMax (worker->pending); i += worker->step) {
+    currQuery = arru (worker->pending,i,Query*);
+    currQuery->span = kmerIndex_align (worker->index,currQuery->read,currQuery->minScore);
+  }
+  return NULL;
+}
+
+
+
+static void gfrContaminant_alignWithKmerIndex (Array pending, char *twoBitFile)
+{
+  KmerIndex *index;
+  Worker *workers;
+  pthread_t *threads;
+  int i,numThreads;
+
+  index = kmerIndex_create (twoBitFile);
+  numThreads = conf_get ()->contaminantThreads > 0 ? conf_get ()->contaminantThreads : (int)sysconf (_SC_NPROCESSORS_ONLN);
+  if (numThreads < 1) {
+    numThreads = 1;
+  }
+  if (numThreads > arrayMax (pending)) {
+    numThreads = arrayMax (pending);
+  }
+  workers = (Worker*)hlr_calloc (numThreads,sizeof (Worker));
+  threads = (pthread_t*)hlr_calloc (numThreads,sizeof (pthread_t));
+  for (i = 0; i < numThreads; i++) {
+    workers[i].index = index;
+    workers[i].pending = pending;
+    workers[i].first = i;
+    workers[i].step = numThreads;
+    if (pthread_create (&threads[i],NULL,gfrContaminant_runWorker,&workers[i]) != 0) {
+      die ("Unable to create the alignment thread %d",i);
+    }
+  }
+  for (i = 0; i < numThreads; i++) {
+    pthread_join (threads[i],NULL);
+  }
+  hlr_free (workers);
+  hlr_free (threads);
+  kmerIndex_destroy (index);
+}
+
+
+
+static void gfrContaminant_addQuery (Array queries, char *read, int entryIndex, int readIndex, int minScore)
+{
+  Query *currQuery;
+
+  currQuery = arrayp (queries,arrayMax (queries),Query);
+  currQuery->read = read;
+  currQuery->entryIndex = entryIndex;
+  currQuery->readIndex = readIndex;
+  currQuery->minScore = minScore;
+  currQuery->span = -1;
+  currQuery->same = NULL;
+}
+
+
+
+Array gfrContaminant_flagReads (Array gfrEntries, Array entryIndices, char *twoBitFile, char *name, double maxOverlapAllowed)
+{
+  Array counts,minReadSizes,queries,pending;
+  AlignmentCache *cache;
+  UniqueQuery *uniqueQueries,*currUQ,*tmp;
+  Query *currQuery;
+  GfrEntry *currGE;
+  Stringa params,value;
+  char *aligner,*cachedValue;
+  int i,l,entryIndex,minReadSize,minScore;
+
+  counts = arrayCreate (arrayMax (gfrEntries),int);
+  minReadSizes = arrayCreate (arrayMax (gfrEntries),int);
+  for (i = 0; i < arrayMax (gfrEntries); i++) {
+    array (counts,i,int) = 0;
+    array (minReadSizes,i,int) = 0;
+  }
+  aligner = conf_get ()->contaminantAligner != NULL ? conf_get ()->contaminantAligner : "kmer";
+  if (!strEqual (aligner,"kmer") && !strEqual (aligner,"gfClient")) {
+    die ("Unknown CONTAMINANT_ALIGNER (kmer or gfClient): %s",aligner);
+  }
+
+  // one query per read of each pair; the minimum score of gfClient depends on the shortest read of the entry
+  queries = arrayCreate (1000,Query);
+  for (i = 0; i < arrayMax (entryIndices); i++) {
+    entryIndex = arru (entryIndices,i,int);
+    currGE = arrp (gfrEntries,entryIndex,GfrEntry);
+    if (arrayMax (currGE->readsTranscript1) == 0) {
+      continue;
+    }
+    minReadSize = gfrContaminant_getMinReadSize (currGE);
+    arru (minReadSizes,entryIndex,int) = minReadSize;
+    minScore = minReadSize - 5 > 20 ? minReadSize - 5 : 20;
+    for (l = 0; l < arrayMax (currGE->readsTranscript1); l++) {
+      gfrContaminant_addQuery (queries,textItem (currGE->readsTranscript1,l),entryIndex,l,minScore);
+      gfrContaminant_addQuery (queries,textItem (currGE->readsTranscript2,l),entryIndex,l,minScore);
+    }
+  }
+
+  // only the reads that are not in the alignment cache are aligned, once per read and minimum score even without the cache
+  cache = alignmentCache_open (twoBitFile,aligner);
+  params = stringCreate (20);
+  value = stringCreate (20);
+  pending = arrayCreate (arrayMax (queries) + 1,Query*);
+  uniqueQueries = NULL;
+  for (i = 0; i < arrayMax (queries); i++) {
+    currQuery = arrp (queries,i,Query);
+    stringPrintf (params,"minScore=%d",currQuery->minScore);
+    stringPrintf (value,"%d\t%s",currQuery->minScore,currQuery->read);
+    HASH_FIND_STR (uniqueQueries,string (value),currUQ);
+    if (currUQ != NULL) {
+      currQuery->same = currUQ->query;
+    }
+    else if ((cachedValue = alignmentCache_get (cache,currQuery->read,string (params))) != NULL) {
+      currQuery->span = atoi (cachedValue);
+    }
+    else {
+      AllocVar (currUQ);
+      currUQ->key = hlr_strdup (string (value));
+      currUQ->query = currQuery;
+      HASH_ADD_KEYPTR (hh,uniqueQueries,currUQ->key,strlen (currUQ->key),currUQ);
+      array (pending,arrayMax (pending),Query*) = currQuery;
+    }
+  }
+  HASH_ITER (hh,uniqueQueries,currUQ,tmp) {
+    HASH_DEL (uniqueQueries,currUQ);
+    hlr_free (currUQ->key);
+    freeMem (currUQ);
+  }
+  if (arrayMax (pending) > 0) {
+    if (strEqual (aligner,"kmer")) {
+      gfrContaminant_alignWithKmerIndex (pending,twoBitFile);
+    }
+    else {
+      gfrContaminant_alignWithGfClient (pending,twoBitFile,name);
+    }
+  }
+  for (i = 0; i < arrayMax (pending); i++) {
+    currQuery = arru (pending,i,Query*);
+    stringPrintf (params,"minScore=%d",currQuery->minScore);
+    stringPrintf (value,"%d",currQuery->span);
+    alignmentCache_put (cache,currQuery->read,string (params),string (value));
+  }
+  alignmentCache_close (cache);
+
+  for (i = 0; i < arrayMax (queries); i++) {
+    currQuery = arrp (queries,i,Query);
+    if (currQuery->same != NULL) {
+      currQuery->span = currQuery->same->span;
+    }
+    if (currQuery->span > ((double)arru (minReadSizes,currQuery->entryIndex,int)) * maxOverlapAllowed) {
+      arrp (arrp (gfrEntries,currQuery->entryIndex,GfrEntry)->interReads,currQuery->readIndex,GfrInterRead)->flag = 1;
+      arru (counts,currQuery->entryIndex,int)++;
+    }
+  }
+  stringDestroy (params);
+  stringDestroy (value);
+  arrayDestroy (pending);
+  arrayDestroy (queries);
+  arrayDestroy (minReadSizes);
+  return counts;
+}
@@ -0,0 +1,30 @@
+#ifndef DEF_GFR_CONTAMINANT_H
+#define DEF_GFR_CONTAMINANT_H
+
+#include <bios/format.h>
+
+
+
+/**
+   @file gfrContaminant.h
+   @brief Alignment of the inter-transcript reads against a contaminant reference (ribosomal, mitochondrial, unknown genome sequence).
+   @details Two aligners are available, selected by CONTAMINANT_ALIGNER in .fusionseqrc:
+   - kmer (default): the reference is loaded into an in-memory k-mer index (see kmerIndex.h) and the reads are screened by CONTAMINANT_THREADS threads (default: number of processors), without gfServer;
+   - gfClient: the reads of all the candidates are written into one in-memory FASTA file (see subprocess.h), named by their index, and aligned with a single gfClient call against the reference loaded by gfServer. Candidates with different read lengths need a different minimum score, so there is one file and one gfClient call per distinct minimum score. The PSL results are then demultiplexed back to the candidates.
+   The aligned span of each read is stored in the alignment cache (see alignmentCache.h), so that only the reads not seen before are aligned.
+ */
+
+
+
+/** align the inter-transcript reads of the selected entries against the reference. The reads whose alignment covers more than maxOverlapAllowed of the read length are flagged (GfrInterRead::flag).
+    @return Array of int with the number of flagged reads of each entry of gfrEntries (0 for the entries that were not selected).
+    @pre conf_init() has been called. With CONTAMINANT_ALIGNER=gfClient, TMP_DIR, BLAT_GFSERVER, BLAT_GFCLIENT and BLAT_GFSERVER_HOST must be defined and the gfServer is started if needed (see gfServerClient.h). */
+extern Array gfrContaminant_flagReads (Array gfrEntries /**< [in,out] Array of GfrEntry */,
+                                       Array entryIndices /**< [in] Array of int, indices of the entries to align */,
+                                       char* twoBitFile /**< [in] reference in 2bit format */,
+                                       char* name /**< [in] name of the reference, used for the temporary files */,
+                                       double maxOverlapAllowed /**< [in] MAX_OVERLAP_ALLOWED */);
+
+
+
+#endif
@@ -2,6 +2,8 @@
 #include "format.h"
 #include "gfr.h"
 #include "intervalFind.h"
+#include "intervalIndex.h"
+#include "conf.h"
 
 typedef struct {
   char* gene1;
@@ -32,6 +34,7 @@ static void findCoordinates( GfrEntry *gfrE, int *start1, int *end1, int *start2
 
 int main (int argc, char *argv[])
 {
+  IntervalIndex *annotationIndex;
   GfrEntry *currGE;
   int count;
   int countRemoved; 
@@ -41,7 +44,9 @@ int main (int argc, char *argv[])
   if (argc != 2) {
     usage ("%s <EST.interval>",argv[0]);
   }  
-  intervalFind_addIntervalsToSearchSpace( argv[1], 0);	
+  // the configuration is optional: it only tells where the annotation pack is, if any
+  conf_initOptional( argv[0] );
+  annotationIndex = intervalIndex_open( argv[1], 0 );	
 
   // beginFiltering
   count = 0;
@@ -56,8 +61,8 @@ int main (int argc, char *argv[])
       int start1, end1, start2, end2;
       findCoordinates( currGE, &start1, &end1, &start2, &end2 );
       
-      Array intervals1 = arrayCopy( intervalFind_getOverlappingIntervals( currGE->chromosomeTranscript1, start1, end1 ) ); 
-      Array intervals2 = intervalFind_getOverlappingIntervals( currGE->chromosomeTranscript2, start2, end2 );
+      Array intervals1 = arrayCopy( intervalIndex_getOverlappingIntervals( annotationIndex, currGE->chromosomeTranscript1, start1, end1 ) ); 
+      Array intervals2 = intervalIndex_getOverlappingIntervals( annotationIndex, currGE->chromosomeTranscript2, start2, end2 );
       for( i=0; i<arrayMax( intervals1 ); i++ ) {
 	Interval* currInterval1 = arru( intervals1, i, Interval* );
 	for( j=0; j<arrayMax ( intervals2 ); j++ ) {
@@ -80,9 +85,11 @@ int main (int argc, char *argv[])
     }
   }	           
   gfr_deInit ();
+  intervalIndex_close( annotationIndex );
   warn ("%s_EST_data: %s",argv[0], argv[1]);
   warn ("%s_numRemoved: %d",argv[0], countRemoved);
   warn ("%s_numGfrEntries: %d",argv[0],count);
+  conf_deInit ();
   return 0;
 }
 
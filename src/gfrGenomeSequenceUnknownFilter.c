@@ -1,12 +1,13 @@
-#include <bios/confp.h>
 #include <bios/log.h>
 #include <bios/format.h>
 #include <bios/blatParser.h>
 //#include <bios/linestream.h>
-#include <bios/confp.h>
 
+#include "conf.h"
 #include "util.h"
 #include "gfr.h"
+#include "gfrCache.h"
+#include "gfrContaminant.h"
 
 /**
    @file gfrGenomeSequenceUnknownFilter.c
@@ -20,7 +21,7 @@
   @attention It requires a GFR file from stdin: @code $ gfrGenomeSequenceUnknownFilter < file.gfr @endcode
  
    @remarks WARNings will be output to stdout to summarize the filter results.
-   @remarks To speed up the computation, gfServer and gfClient (part of Blat suite) are used. If the server is not running, it will be initiated. The location of the tools must be defined in .fusionseqrc. Moreover, the mitochondrial reference is assigned to BLAT_GFSERVER_PORT + 2. 
+   @remarks To speed up the computation, gfServer and gfClient (part of Blat suite) are used. If the server is not running, it will be initiated. The location of the tools must be defined in .fusionseqrc. Moreover, the gfServer of the unknown genome sequences is shared with the other processes on the host and its port is handed out from BLAT_GFSERVER_PORT on (see gfServerClient.h). By default the reads are screened in-process with a k-mer index of the reference and no gfServer is needed; CONTAMINANT_ALIGNER=gfClient uses gfServer and a single gfClient call for all the candidates (see gfrContaminant.h).
  */
   
 int main (int argc, char *argv[])
@@ -29,123 +30,65 @@ int main (int argc, char *argv[])
   int count;
   int countRemoved;
   int unknownCount; 
-  unsigned int minReadSize;
   int  i;
   Stringa cmd;
-  BlatQuery *blQ=NULL;
-  config *conf = NULL; /**< Pointer to configuration file .fusionseqrc  */
-  int BLAT_GFSERVER_PORT=-1;
+  Array gfrEntries;
+  Array verdicts,entryIndices,unknownCounts;
+  int keep;
+  Conf *conf = NULL; /**< Pointer to configuration file .fusionseqrc  */
 
-  if ((conf = confp_open(getenv("FUSIONSEQ_CONFPATH"))) == NULL) {
-    die("%s:\tCannot find .fusionseqrc: %s", argv[0], getenv("FUSIONSEQ_CONFPATH"));
-    return EXIT_FAILURE;
-  }
-  if( confp_get( conf,"MAX_OVERLAP_ALLOWED")==NULL ) {
-    die("%s:\tCannot find MAX_OVERLAP_ALLOWED in the configuration file: %s)", argv[0], getenv("FUSIONSEQ_CONFPATH") );
-    return EXIT_FAILURE;
-  }
-  if( confp_get( conf,"MAX_FRACTION_HOMOLOGOUS")==NULL ) {
-    die("%s:\tCannot find MAX_FRACTION_HOMOLOGOUS in the configuration file: %s)", argv[0], getenv("FUSIONSEQ_CONFPATH") );
-    return EXIT_FAILURE;
-  }
- if( confp_get( conf, "GENOMEUNKNOWN_DIR")==NULL ) {
-    die("%s:\tCannot find GENOMEUNKNOWN_DIR in the configuration file: %s)", argv[0], getenv("FUSIONSEQ_CONFPATH") );
-    return EXIT_FAILURE;
-  }
-  if( confp_get( conf, "GENOMEUNKNOWN_FILENAME")==NULL ) {
-    die("%s:\tCannot find GENOMEUNKNOWN_FILENAME in the configuration file: %s)", argv[0], getenv("FUSIONSEQ_CONFPATH") );
-    return EXIT_FAILURE;
-  }
-if( confp_get( conf, "TMP_DIR")==NULL ) {
-    die("%s:\tCannot find TMP_DIR in the configuration file: %s)", argv[0], getenv("FUSIONSEQ_CONFPATH") );
-    return EXIT_FAILURE;
-  }
- if( confp_get( conf, "BLAT_GFSERVER")==NULL ) {
-    die("%s:\tCannot find BLAT_GFSERVER in the configuration file: %s)", argv[0], getenv("FUSIONSEQ_CONFPATH") );
-    return EXIT_FAILURE;
-  }
- if( confp_get( conf, "BLAT_GFCLIENT")==NULL ) {
-    die("%s:\tCannot find BLAT_GFCLIENT in the configuration file: %s)", argv[0], getenv("FUSIONSEQ_CONFPATH") );
-    return EXIT_FAILURE;
-  }
-if( confp_get( conf, "BLAT_GFSERVER_HOST")==NULL ) {
-    die("%s:\tCannot find BLAT_GFSERVER_HOST in the configuration file: %s)", argv[0], getenv("FUSIONSEQ_CONFPATH") );
-    return EXIT_FAILURE;
-  }
- if( confp_get( conf, "BLAT_GFSERVER_PORT")==NULL ) {
-    die("%s:\tCannot find BLAT_GFSERVER_PORT in the configuration file: %s)", argv[0], getenv("FUSIONSEQ_CONFPATH") );
-    return EXIT_FAILURE;
- } else BLAT_GFSERVER_PORT=atoi(confp_get( conf, "BLAT_GFSERVER_PORT"))+3;
+  conf = conf_init (argv[0], "MAX_OVERLAP_ALLOWED", "MAX_FRACTION_HOMOLOGOUS", "GENOMEUNKNOWN_DIR", "GENOMEUNKNOWN_FILENAME", NULL);
 
   count = 0;
   countRemoved = 0;
   
   cmd = stringCreate (100);
-  // initializing the gfServers
-  stringPrintf( cmd, "%s status %s %d &> /dev/null", confp_get( conf, "BLAT_GFSERVER"),  confp_get( conf, "BLAT_GFSERVER_HOST"), atoi(confp_get( conf, "BLAT_GFSERVER_PORT")) + 2);
-  int ret = hlr_system( string(cmd), 1 );
-   if( ret != 0 ) { // not initialized
-    stringPrintf( cmd , "%s -repMatch=100000 -tileSize=12 -canStop -log=%s/gfServer_mitochondrial.log start %s %d %s/%s  &", confp_get( conf, "BLAT_GFSERVER"), confp_get( conf, "TMP_DIR"),  confp_get( conf, "BLAT_GFSERVER_HOST"), BLAT_GFSERVER_PORT, confp_get( conf, "GENOMEUNKNOWN_DIR"), confp_get( conf,"GENOMEUNKNOWN_FILENAME"));
-    hlr_system( string( cmd ), 0 );
-    long int startTime = time(0);
-    stringPrintf( cmd , "%s status %s %d &> /dev/null", confp_get( conf, "BLAT_GFSERVER"), confp_get( conf, "BLAT_GFSERVER_HOST"), BLAT_GFSERVER_PORT);
-    while( hlr_system( string(cmd), 1) && (time(0)-startTime)<600 ) ;
-    if( hlr_system( string(cmd), 1 ) != 0 )  {
-      die("gfServer for %s/%s not initialized: %s %s %s", confp_get( conf, "GENOMEUNKNOWN_DIR"), confp_get( conf, "GENOMEUNKNOWN_FILENAME"), confp_get( conf, "BLAT_GFSERVER"), confp_get( conf, "BLAT_GFSERVER_HOST"), BLAT_GFSERVER_PORT); 
-      return EXIT_FAILURE;
-    }
-  } 
-
- 
+  gfrCache_init (argv[0], argc, argv, "MAX_OVERLAP_ALLOWED", "MAX_FRACTION_HOMOLOGOUS", "GENOMEUNKNOWN_DIR", "GENOMEUNKNOWN_FILENAME", "CONTAMINANT_ALIGNER", NULL);
+  stringPrintf( cmd, "%s/%s", conf->genomeUnknownDir, conf->genomeUnknownFilename );
+  gfrCache_addContextFile( string(cmd) );
   gfr_init ("-");
+  gfrEntries = gfr_parse ();
   puts (gfr_writeHeader ());
-  while (currGE = gfr_nextEntry ()) {
-    unknownCount = 0;
-    minReadSize=1000;
-    writeFasta( currGE, &minReadSize, confp_get( conf, "TMP_DIR") ); // in util.c
-    stringPrintf(cmd, "cd %s;%s %s %d / -t=dna -q=dna -minScore=%d -out=psl %s_reads.fa %s.mito.psl &>/dev/null", confp_get( conf, "TMP_DIR"), confp_get( conf, "BLAT_GFCLIENT"), confp_get( conf, "BLAT_GFSERVER_HOST"), BLAT_GFSERVER_PORT, minReadSize - 5 > 20 ? minReadSize - 5 : 20 , currGE->id, currGE->id);
-    int attempts=0;
-    ret = hlr_system( string(cmd), 1 );
-    while( hlr_system( string(cmd), 1 ) && attempts<5000 ) attempts++;
-    if( attempts == 5000 ) {
-      die("Cannot map the reads %s", string( cmd ));
-      return EXIT_FAILURE;
+  // verdicts from the cache; the reads of the other entries are aligned all together
+  verdicts = arrayCreate( arrayMax (gfrEntries), int );
+  entryIndices = arrayCreate( arrayMax (gfrEntries), int );
+  for (i = 0; i < arrayMax (gfrEntries); i++) {
+    currGE = arrp (gfrEntries,i,GfrEntry);
+    if (gfrCache_lookup (currGE,&keep)) {
+      array( verdicts, i, int ) = keep;
+    } else {
+      array( verdicts, i, int ) = -1;
+      array( entryIndices, arrayMax(entryIndices), int ) = i;
     }
-    
-    // reading the results of blast from File
-    stringPrintf(cmd,  "%s/%s.mito.psl", confp_get( conf, "TMP_DIR"), currGE->id);
-    blatParser_initFromFile( string(cmd) );
-    while( blQ = blatParser_nextQuery() ) {
-      //warn("iter %d\tquery %s", iter, blQ->qName );iter++; 
-      int nucleotideOverlap = getNucleotideOverlap ( blQ );
-      if (nucleotideOverlap > (((double) minReadSize) * strtod(confp_get( conf, "MAX_OVERLAP_ALLOWED"), NULL))) {
-	char* value = strchr( blQ->qName,'/' );
-	if( value ) *value = '\0'; else die("Not a valid index in the blat query name:\t%s", blQ->qName );
-	int indexOfInter = atoi( blQ->qName ); // the following three lines should removed the read if writing the GFR entry
-	GfrInterRead *currGIR = arrp( currGE->interReads, indexOfInter, GfrInterRead );
-	currGIR->flag = 1;
-	unknownCount++;
-      } 
+  }
+  unknownCounts = gfrContaminant_flagReads( gfrEntries, entryIndices, string(cmd), "unknown", conf->maxOverlapAllowed );
+  for (i = 0; i < arrayMax (gfrEntries); i++) {
+    currGE = arrp (gfrEntries,i,GfrEntry);
+    keep = arru( verdicts, i, int );
+    if (keep == -1) {
+      unknownCount = arru( unknownCounts, i, int );
+      keep = ( (double) unknownCount / (double) ( arrayMax(currGE->readsTranscript1) + arrayMax(currGE->readsTranscript2) ) ) <= conf->maxFractionHomologous;
+      gfrCache_store( currGE, keep );
+      if( keep && unknownCount > 0 ) updateStats( currGE );
     }
-    blatParser_deInit();
-    if ( ( (double) unknownCount / (double) ( arrayMax(currGE->readsTranscript1) + arrayMax(currGE->readsTranscript2) ) ) <= strtod(confp_get( conf, "MAX_FRACTION_HOMOLOGOUS"), NULL)) {   
-      if( unknownCount > 0 ) updateStats( currGE );
+    if (keep) {
       // writing the gfrEntry
       puts (gfr_writeGfrEntry (currGE));
       count++;
     } else {
       countRemoved++;
     }
-    // removing temporary files
-    stringPrintf (cmd,"rm -rf %s/%s_reads.fa %s/%s.mito.psl", confp_get( conf, "TMP_DIR"),  currGE->id, confp_get( conf, "TMP_DIR"),  currGE->id );
-    hlr_system( string(cmd) , 1);      
   }
+  arrayDestroy( verdicts );
+  arrayDestroy( entryIndices );
+  arrayDestroy( unknownCounts );
   gfr_deInit ();
+  gfrCache_deInit ();
   
   stringDestroy( cmd );
   warn ("%s_numRemoved: %d",argv[0],countRemoved);
   warn ("%s_numGfrEntries: %d",argv[0],count);
-  confp_close(conf);
+  conf_deInit ();
   conf=NULL;
   
   return 0;
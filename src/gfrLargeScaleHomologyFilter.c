@@ -1,10 +1,10 @@
 #include <stdlib.h>
 
-#include <bios/confp.h>
 #include <bios/log.h>
 #include <bios/format.h>
 
-#include "util.h"
+#include "conf.h"
+#include "treeFamTable.h"
 #include "gfr.h"
 
 /**
@@ -18,63 +18,18 @@
    @pre A valid GFR file as input, including stdin.
    @pre knownToTreefam a tab delimited file that include the information about paralogs
  */
-static int sortKgTreeFamsByTranscriptName (KgTreeFam *a, KgTreeFam *b) 
+static int isHomologous (TreeFamTable *treeFams, char *transcript1, char *transcript2)
 {
-  return strcmp (a->transcriptName,b->transcriptName);
-}
-
-
-
-static char* lookUpTreeFam (Array kgTreeFams, char *transcript) 
-{
-  KgTreeFam testKGTF;
-  int index;
-  int foundIt;
-   
-  foundIt = 0;
-  testKGTF.transcriptName = hlr_strdup (transcript);
-  foundIt = arrayFind (kgTreeFams,&testKGTF,&index,(ARRAYORDERF)sortKgTreeFamsByTranscriptName);
-  hlr_free (testKGTF.transcriptName);
-  if (foundIt) {
-    return  arrp (kgTreeFams,index,KgTreeFam)->treeFamId;
-  }
-  return NULL;
-}
+  static Array familiesTranscript1 = NULL;
+  static Array familiesTranscript2 = NULL;
 
-
-
-static int isHomologous (Array kgTreeFams, char *transcript1, char *transcript2)
-{
-  Texta tokens;
-  int i,j;
-  char *treeFamId;
-  static Texta treeFamIdsTranscript1 = NULL;
-  static Texta treeFamIdsTranscript2 = NULL;
-
-  textCreateClear (treeFamIdsTranscript1,100);
-  textCreateClear (treeFamIdsTranscript2,100);
-  tokens = textFieldtokP (transcript1,"|");
-  for (i = 0; i < arrayMax (tokens); i++) {
-    if (treeFamId = lookUpTreeFam (kgTreeFams,textItem (tokens,i))) {
-      textAdd (treeFamIdsTranscript1,treeFamId);
-    } 
-  }
-  textDestroy (tokens);
-  tokens = textFieldtokP (transcript2,"|");
-  for (i = 0; i < arrayMax (tokens); i++) {
-    if (treeFamId = lookUpTreeFam (kgTreeFams,textItem (tokens,i))) {
-      textAdd (treeFamIdsTranscript2,treeFamId);
-    } 
-  }
-  textDestroy (tokens);
-  for (i = 0; i < arrayMax (treeFamIdsTranscript1); i++) {
-     for (j = 0; j < arrayMax (treeFamIdsTranscript2); j++) {
-       if (strEqual (textItem (treeFamIdsTranscript1,i),textItem (treeFamIdsTranscript2,j))) {
-         return 1;
-       }
-     }
+  if (familiesTranscript1 == NULL) {
+    familiesTranscript1 = arrayCreate (10,int);
+    familiesTranscript2 = arrayCreate (10,int);
   }
-  return 0;
+  treeFamTable_getFamilies (treeFams,transcript1,familiesTranscript1);
+  treeFamTable_getFamilies (treeFams,transcript2,familiesTranscript2);
+  return treeFamTable_haveCommonFamily (familiesTranscript1,familiesTranscript2);
 }
 
 
@@ -82,32 +37,20 @@ static int isHomologous (Array kgTreeFams, char *transcript1, char *transcript2)
 int main (int argc, char *argv[])
 {
   GfrEntry *currGE;
-  Array kgTreeFams;
+  TreeFamTable *treeFams;
   Stringa buffer;
   int count;
   int countRemoved;
 
-  config *conf;
+  Conf *conf;
 
-  if ((conf = confp_open(getenv("FUSIONSEQ_CONFPATH"))) == NULL) {
-    die("%s:\tCannot find .fusionseqrc", argv[0]);
-    return EXIT_FAILURE;
-  } 
-  if ((confp_get( conf,"ANNOTATION_DIR")) == NULL) {
-    die("%s:\tCannot find ANNOTATION_DIR in the configuration file: %s", argv[0], getenv("FUSIONSEQ_CONFPATH") );
-    return EXIT_FAILURE;
-  } 
-  if ((confp_get( conf,"KNOWN_GENE_TREE_FAM_FILENAME")) == NULL) {
-    die("%s:\tCannot find KNOWN_GENE_TREE_FAM_FILENAME in the configuration file: %sc", argv[0], getenv("FUSIONSEQ_CONFPATH") );
-    return EXIT_FAILURE;
-  } 
+  conf = conf_init (argv[0], "ANNOTATION_DIR", "KNOWN_GENE_TREE_FAM_FILENAME", NULL); 
 
   buffer = stringCreate (100);
   stringPrintf (buffer,"%s/%s",
-                confp_get(conf, "ANNOTATION_DIR"), 
-		confp_get(conf, "KNOWN_GENE_TREE_FAM_FILENAME"));
-  kgTreeFams = util_readKnownGeneTreeFams (string (buffer));
-  arraySort (kgTreeFams,(ARRAYORDERF)sortKgTreeFamsByTranscriptName);
+                conf->annotationDir, 
+		conf->knownGeneTreeFamFilename);
+  treeFams = treeFamTable_open (string (buffer));
   stringDestroy (buffer);
 
   count = 0;
@@ -115,7 +58,7 @@ int main (int argc, char *argv[])
   gfr_init ("-");
   puts (gfr_writeHeader ());
   while (currGE = gfr_nextEntry ()){
-    if (isHomologous (kgTreeFams,currGE->nameTranscript1,currGE->nameTranscript2)) {
+    if (isHomologous (treeFams,currGE->nameTranscript1,currGE->nameTranscript2)) {
       countRemoved++;
       continue;
     }
@@ -123,10 +66,11 @@ int main (int argc, char *argv[])
     count++;
   }
   gfr_deInit ();
+  treeFamTable_close (treeFams);
   warn ("%s_numRemoved: %d",argv[0],countRemoved);
   warn ("%s_numGfrEntries: %d",argv[0],count);
 
-  confp_close(conf);
+  conf_deInit ();
 
   return EXIT_SUCCESS;
 }
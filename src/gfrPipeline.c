@@ -0,0 +1,427 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <bios/confp.h>
+#include <bios/log.h>
+#include <bios/format.h>
+#include <bios/linestream.h>
+
+#include "metrics.h"
+
+/**
+   @file gfrPipeline.c
+   @brief Driver of the GFR filter chain with cost-based ordering of the filters.
+   @details It runs the GFR filters listed in a pipeline file, one after the other, on the GFR read from stdin and writes the final GFR to stdout. For every filter it records the cost per entry (wall time / number of input entries) and the selectivity (fraction of entries that pass). Consecutive filters marked as commutative are reordered so that the cheapest and most selective ones run first, i.e. by increasing cost / (1 - selectivity). The statistics are accumulated across runs in a stats file, by default pipeline.txt.stats.
+   The pipeline file has one stage per line, a keyword followed by a tab and the command line of the filter:
+   - filter: a commutative filter, i.e. it only removes entries or flags reads of single entries (e.g. gfrProximityFilter, gfrBlackListFilter, gfrRibosomalFilter).
+   - stage: a barrier that keeps its position, e.g. because it adds columns (gfrAddInfo), because its verdict depends on the whole set of candidates (gfrRandomPairingFilter) or because it reorders the entries (gfrSpliceJunctionFilter).
+   Filters without statistics keep the order of the pipeline file and run after the ones with statistics.
+
+   @version 0.8
+   @remarks WARNings will be output to stderr to summarize the chosen plan and the filter results.
+   @pre A valid GFR file as input, including stdin.
+   @pre TMP_DIR (optional) in .fusionseqrc is used for the intermediate GFR files; the current directory otherwise.
+   @param [in] -explain only print the chosen plan, without running it
+   @param [in] pipeline.txt the pipeline file
+   @param [in] stats.txt (optional) the file with the statistics of previous runs
+ */
+
+
+#define PIPELINE_STAGE_FILTER 1
+#define PIPELINE_STAGE_BARRIER 2
+
+
+
+typedef struct {
+	char *command;
+	int type;
+	int position; /**< position in the pipeline file */
+	int runs; /**< number of previous runs with at least one input entry */
+	double entriesIn; /**< total number of input entries over all runs */
+	double entriesOut; /**< total number of output entries over all runs */
+	double seconds; /**< total wall time over all runs */
+} Stage;
+
+
+
+static int hasStats (Stage *a)
+{
+	return a->runs > 0 && a->entriesIn > 0;
+}
+
+
+
+static double getCostPerEntry (Stage *a)
+{
+	return a->seconds / a->entriesIn;
+}
+
+
+
+static double getSelectivity (Stage *a)
+{
+	return a->entriesOut / a->entriesIn;
+}
+
+
+
+/**
+	 Ordering of commutative filters: filters with statistics are sorted by increasing cost / (1 - selectivity), which minimizes the expected cost of the chain for independent filters. Filters that never removed anything come after, by increasing cost. Filters without statistics keep the original order at the end.
+ */
+static int sortStagesByRank (Stage **a, Stage **b)
+{
+	double removedA,removedB,rankA,rankB;
+
+	if (!hasStats (*a) || !hasStats (*b)) {
+		if (hasStats (*a)) {
+			return -1;
+		}
+		if (hasStats (*b)) {
+			return 1;
+		}
+		return (*a)->position - (*b)->position;
+	}
+	removedA = 1.0 - getSelectivity (*a);
+	removedB = 1.0 - getSelectivity (*b);
+	if (removedA <= 0.0 || removedB <= 0.0) {
+		if (removedA > 0.0) {
+			return -1;
+		}
+		if (removedB > 0.0) {
+			return 1;
+		}
+		rankA = getCostPerEntry (*a);
+		rankB = getCostPerEntry (*b);
+	}
+	else {
+		rankA = getCostPerEntry (*a) / removedA;
+		rankB = getCostPerEntry (*b) / removedB;
+	}
+	if (rankA < rankB) {
+		return -1;
+	}
+	if (rankA > rankB) {
+		return 1;
+	}
+	return (*a)->position - (*b)->position;
+}
+
+
+
+static int sortStagesByCommand (Stage *a, Stage *b)
+{
+	return strcmp (a->command,b->command);
+}
+
+
+
+static Array readPipeline (char *fileName)
+{
+	LineStream ls;
+	Array stages;
+	Stage *currStage;
+	char *line,*pos;
+
+	stages = arrayCreate (30,Stage);
+	ls = ls_createFromFile (fileName);
+	while (line = ls_nextLine (ls)) {
+		if (line[0] == '\0' || line[0] == '#') {
+			continue;
+		}
+		pos = strchr (line,'\t');
+		if (pos == NULL) {
+			die ("Expected <filter|stage>\\t<command> in the pipeline file: %s",line);
+		}
+		*pos = '\0';
+		currStage = arrayp (stages,arrayMax (stages),Stage);
+		if (strEqual (line,"filter")) {
+			currStage->type = PIPELINE_STAGE_FILTER;
+		}
+		else if (strEqual (line,"stage")) {
+			currStage->type = PIPELINE_STAGE_BARRIER;
+		}
+		else {
+			die ("Unknown stage type in the pipeline file: %s",line);
+		}
+		currStage->command = hlr_strdup (pos + 1);
+		currStage->position = arrayMax (stages) - 1;
+	}
+	ls_destroy (ls);
+	return stages;
+}
+
+
+
+/**
+   The stats file is tab-delimited: runs, entriesIn, entriesOut, seconds, command.
+ */
+static Array readStats (char *fileName)
+{
+	LineStream ls;
+	Array stats;
+	Stage *currStat;
+	Texta tokens;
+	char *line;
+
+	stats = arrayCreate (30,Stage);
+	if (access (fileName,R_OK) != 0) {
+		return stats;
+	}
+	ls = ls_createFromFile (fileName);
+	while (line = ls_nextLine (ls)) {
+		if (line[0] == '\0' || line[0] == '#') {
+			continue;
+		}
+		tokens = textFieldtokP (line,"\t");
+		if (arrayMax (tokens) != 5) {
+			die ("Invalid line in the stats file %s: %s",fileName,line);
+		}
+		currStat = arrayp (stats,arrayMax (stats),Stage);
+		currStat->runs = atoi (textItem (tokens,0));
+		currStat->entriesIn = atof (textItem (tokens,1));
+		currStat->entriesOut = atof (textItem (tokens,2));
+		currStat->seconds = atof (textItem (tokens,3));
+		currStat->command = hlr_strdup (textItem (tokens,4));
+		textDestroy (tokens);
+	}
+	ls_destroy (ls);
+	arraySort (stats,(ARRAYORDERF)sortStagesByCommand);
+	return stats;
+}
+
+
+
+static void writeStats (char *fileName, Array stats, Array stages)
+{
+	FILE *fp;
+	Stage *currStage,*currStat;
+	int i,index;
+
+	for (i = 0; i < arrayMax (stages); i++) {
+		currStage = arrp (stages,i,Stage);
+		if (arrayFindInsert (stats,currStage,&index,(ARRAYORDERF)sortStagesByCommand)) {
+			currStat = arrp (stats,index,Stage);
+			currStat->command = hlr_strdup (currStage->command);
+		}
+		currStat = arrp (stats,index,Stage);
+		currStat->runs = currStage->runs;
+		currStat->entriesIn = currStage->entriesIn;
+		currStat->entriesOut = currStage->entriesOut;
+		currStat->seconds = currStage->seconds;
+	}
+	if (!(fp = fopen (fileName,"w"))) {
+		die ("Unable to open stats file: %s",fileName);
+	}
+	fprintf (fp,"# runs\tentriesIn\tentriesOut\tseconds\tcommand\n");
+	for (i = 0; i < arrayMax (stats); i++) {
+		currStat = arrp (stats,i,Stage);
+		fprintf (fp,"%d\t%.0f\t%.0f\t%.6f\t%s\n",currStat->runs,currStat->entriesIn,currStat->entriesOut,currStat->seconds,currStat->command);
+	}
+	fclose (fp);
+}
+
+
+
+static void assignStats (Array stages, Array stats)
+{
+	Stage *currStage,*currStat;
+	int i,index;
+
+	for (i = 0; i < arrayMax (stages); i++) {
+		currStage = arrp (stages,i,Stage);
+		if (arrayFind (stats,currStage,&index,(ARRAYORDERF)sortStagesByCommand)) {
+			currStat = arrp (stats,index,Stage);
+			currStage->runs = currStat->runs;
+			currStage->entriesIn = currStat->entriesIn;
+			currStage->entriesOut = currStat->entriesOut;
+			currStage->seconds = currStat->seconds;
+		}
+	}
+}
+
+
+
+/**
+	 Creates the execution plan: barriers keep their position, runs of consecutive commutative filters are sorted by rank.
+ */
+static Array createPlan (Array stages)
+{
+	Array plan;
+	int i,j,start;
+
+	plan = arrayCreate (arrayMax (stages),Stage*);
+	for (i = 0; i < arrayMax (stages); i++) {
+		array (plan,arrayMax (plan),Stage*) = arrp (stages,i,Stage);
+	}
+	i = 0;
+	while (i < arrayMax (plan)) {
+		if (arru (plan,i,Stage*)->type == PIPELINE_STAGE_BARRIER) {
+			i++;
+			continue;
+		}
+		start = i;
+		while (i < arrayMax (plan) && arru (plan,i,Stage*)->type == PIPELINE_STAGE_FILTER) {
+			i++;
+		}
+		qsort (arrp (plan,start,Stage*),i - start,sizeof (Stage*),(int (*)(const void*,const void*))sortStagesByRank);
+	}
+	for (j = 0; j < arrayMax (plan); j++) {
+		Stage *currStage = arru (plan,j,Stage*);
+		if (hasStats (currStage)) {
+			warn ("%s_plan: %d\t%s\t%s\tcostPerEntry=%g\tselectivity=%.4f\truns=%d",
+						"gfrPipeline",j + 1,currStage->type == PIPELINE_STAGE_FILTER ? "filter" : "stage",currStage->command,
+						getCostPerEntry (currStage),getSelectivity (currStage),currStage->runs);
+		}
+		else {
+			warn ("%s_plan: %d\t%s\t%s\tcostPerEntry=NA\tselectivity=NA\truns=0",
+						"gfrPipeline",j + 1,currStage->type == PIPELINE_STAGE_FILTER ? "filter" : "stage",currStage->command);
+		}
+	}
+	return plan;
+}
+
+
+
+static int countEntries (char *fileName)
+{
+	LineStream ls;
+	char *line;
+	int count;
+
+	count = 0;
+	ls = ls_createFromFile (fileName);
+	while (line = ls_nextLine (ls)) {
+		if (line[0] != '\0') {
+			count++;
+		}
+	}
+	ls_destroy (ls);
+	return count > 0 ? count - 1 : 0; // header
+}
+
+
+
+static double getTime (void)
+{
+	struct timeval tv;
+
+	gettimeofday (&tv,NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+
+
+static void copyStream (FILE *in, FILE *out)
+{
+	char buffer[65536];
+	size_t n;
+
+	while ((n = fread (buffer,1,sizeof (buffer),in)) > 0) {
+		if (fwrite (buffer,1,n,out) != n) {
+			die ("Unable to write the GFR file");
+		}
+	}
+}
+
+
+
+int main (int argc, char *argv[])
+{
+	Array stages,stats,plan;
+	Stage *currStage;
+	Stringa fileIn,fileOut,statsFile,cmd;
+	FILE *fp;
+	config *conf;
+	char *tmpDir;
+	char *pipelineFile;
+	int explain;
+	int i,entriesIn,entriesOut;
+	double startTime,seconds;
+
+	explain = 0;
+	i = 1;
+	if (argc > 1 && strEqual (argv[1],"-explain")) {
+		explain = 1;
+		i++;
+	}
+	if (argc - i < 1 || argc - i > 2) {
+		usage ("%s [-explain] <pipeline.txt> [stats.txt]",argv[0]);
+	}
+	pipelineFile = argv[i];
+	statsFile = stringCreate (100);
+	if (argc - i == 2) {
+		stringPrintf (statsFile,"%s",argv[i + 1]);
+	}
+	else {
+		stringPrintf (statsFile,"%s.stats",pipelineFile);
+	}
+	tmpDir = ".";
+	if ((conf = confp_open (getenv ("FUSIONSEQ_CONFPATH"))) != NULL &&
+			confp_get (conf,"TMP_DIR") != NULL) {
+		tmpDir = hlr_strdup (confp_get (conf,"TMP_DIR"));
+	}
+
+	stages = readPipeline (pipelineFile);
+	stats = readStats (string (statsFile));
+	assignStats (stages,stats);
+	plan = createPlan (stages);
+	if (explain) {
+		return EXIT_SUCCESS;
+	}
+
+	fileIn = stringCreate (100);
+	fileOut = stringCreate (100);
+	cmd = stringCreate (100);
+	stringPrintf (fileIn,"%s/gfrPipeline_%d_0.gfr",tmpDir,(int)getpid ());
+	if (!(fp = fopen (string (fileIn),"w"))) {
+		die ("Unable to open file: %s",string (fileIn));
+	}
+	copyStream (stdin,fp);
+	fclose (fp);
+	entriesIn = countEntries (string (fileIn));
+	for (i = 0; i < arrayMax (plan); i++) {
+		currStage = arru (plan,i,Stage*);
+		stringPrintf (fileOut,"%s/gfrPipeline_%d_%d.gfr",tmpDir,(int)getpid (),i + 1);
+		stringPrintf (cmd,"%s < %s > %s",currStage->command,string (fileIn),string (fileOut));
+		startTime = getTime ();
+		if (metrics_system (string (cmd),1) != 0) {
+			unlink (string (fileIn));
+			unlink (string (fileOut));
+			die ("Filter failed: %s",currStage->command);
+		}
+		seconds = getTime () - startTime;
+		entriesOut = countEntries (string (fileOut));
+		warn ("%s_stage: %s\tentriesIn=%d\tentriesOut=%d\tseconds=%.3f",argv[0],currStage->command,entriesIn,entriesOut,seconds);
+		if (entriesIn > 0) {
+			currStage->runs++;
+			currStage->entriesIn += entriesIn;
+			currStage->entriesOut += entriesOut;
+			currStage->seconds += seconds;
+		}
+		unlink (string (fileIn));
+		stringPrintf (fileIn,"%s",string (fileOut));
+		entriesIn = entriesOut;
+	}
+	if (!(fp = fopen (string (fileIn),"r"))) {
+		die ("Unable to open file: %s",string (fileIn));
+	}
+	copyStream (fp,stdout);
+	fclose (fp);
+	unlink (string (fileIn));
+	writeStats (string (statsFile),stats,stages);
+
+	warn ("%s_numGfrEntries: %d",argv[0],entriesIn);
+	arrayDestroy (plan);
+	arrayDestroy (stages);
+	arrayDestroy (stats);
+	stringDestroy (fileIn);
+	stringDestroy (fileOut);
+	stringDestroy (statsFile);
+	stringDestroy (cmd);
+	if (conf != NULL) {
+		confp_close (conf);
+	}
+	return EXIT_SUCCESS;
+}
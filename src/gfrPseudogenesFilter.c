@@ -1,8 +1,9 @@
 #include <bios/log.h>
 #include <bios/format.h>
 #include <bios/intervalFind.h>
-#include <bios/confp.h>
+#include "conf.h"
 #include "gfr.h"
+#include "intervalIndex.h"
 
 /**
    @file gfrPseudogenesFlter.c
@@ -18,7 +19,8 @@
    @pre [in] minNumberInterReads An integer representing the minimum number of reads to keep the fusion candidate.
  */
 
-static config *Conf = NULL; /**< Pointer to configuration file .fusionseqrc  */
+static Conf *conf = NULL; /**< Pointer to configuration file .fusionseqrc  */
+static IntervalIndex *annotationIndex = NULL; /**< pseudogene intervals */
 
 static float getNumInter( GfrInterRead* currInter, int readLength ) { // computes the correct number of the inters by considering split reads on splice junctions.
   float numInter=0.0;
@@ -44,35 +46,35 @@ static float getNumInter( GfrInterRead* currInter, int readLength ) { // compute
   return overlap;
   }*/
 
+static void countOverlaps( IntervalQuery* query, Interval* currInterval ) {
+  query->result++;
+}
+
+static void addReadQuery( Array queries, char* chromosome, int start, int end ) {
+  IntervalQuery* currQuery = arrayp( queries, arrayMax( queries ), IntervalQuery );
+  currQuery->chromosome = chromosome;
+  currQuery->start = start;
+  currQuery->end = end;
+  currQuery->result = 0;
+}
+
 int main (int argc, char *argv[]) {
 	GfrEntry *currGE;
 	int count,countRemoved;
-	int i, j;
-	Array intervals;
+	int i;
+	Array queries = arrayCreate( 100, IntervalQuery );
 	GfrInterRead *currGIR;
-	int totalOverlaps;
 	float minNumInterReads;
 	float numberOfInters;
 	Stringa buffer = stringCreate(100);
 
-	if ((Conf = confp_open(getenv("FUSIONSEQ_CONFPATH"))) == NULL) {
-	  die("%s:\tCannot find .fusionseqrc: %s", argv[0], getenv("FUSIONSEQ_CONFPATH"));
-	  return EXIT_FAILURE;
-	}
-	if( confp_get( Conf, "PSEUDOGENE_DIR")==NULL ) {
-	  die("%s:\tCannot find PSEUDOGENE_DIR in the configuration file: %s)", argv[0], getenv("FUSIONSEQ_CONFPATH") );
-	  return EXIT_FAILURE;
-	}
-	if( confp_get( Conf, "PSEUDOGENE_FILENAME")==NULL ) {
-	  die("%s:\tCannot find PSEUDOGENE_FILENAME in the configuration file: %s)", argv[0], getenv("FUSIONSEQ_CONFPATH") );
-	  return EXIT_FAILURE;
-	}
+	conf = conf_init (argv[0], "PSEUDOGENE_DIR", "PSEUDOGENE_FILENAME", NULL);
 
 	if (argc != 2) {
 	  usage ("%s <minNumInterReads>",argv[0]);
 	}
-	stringPrintf( buffer, "%s/%s", confp_get( Conf, "PSEUDOGENE_DIR"), confp_get( Conf, "PSEUDOGENE_FILENAME") );
-	intervalFind_addIntervalsToSearchSpace (string(buffer),0);
+	stringPrintf( buffer, "%s/%s", conf->pseudogeneDir, conf->pseudogeneFilename );
+	annotationIndex = intervalIndex_open (string(buffer),0);
 	stringDestroy(buffer); 
 	minNumInterReads = atof (argv[1]);
 	count = 0;
@@ -82,42 +84,21 @@ int main (int argc, char *argv[]) {
 	while (currGE = gfr_nextEntry ()){
 	  int readLength = strlen( arru( currGE->readsTranscript1, 0, char* ) );
 	  numberOfInters = (float) currGE->numInter;
+	  // the two ends of all the reads are swept at once against the pseudogenes
+	  arrayClear( queries );
 	  for (i = 0; i < arrayMax (currGE->interReads); i++) {
 	    currGIR = arrp (currGE->interReads,i,GfrInterRead);
-	    //if (currGIR->pairType == GFR_PAIR_TYPE_EXONIC_EXONIC) {
-	    // continue;
-	    // }
-	    totalOverlaps = 0;
-	    intervals = intervalFind_getOverlappingIntervals (currGE->chromosomeTranscript1,currGIR->readStart1,currGIR->readEnd1);
-	    if( arrayMax( intervals ) > 0 ) { 
-	      currGE->numInter-= getNumInter( currGIR, readLength );
-	      currGIR->flag = 1;
-	      continue;
-	    }
-	    /*for(j=0; j < arrayMax( intervals ); j++) { // to fix SAM2MRF before using the total overlap
-	      Interval* currInterval = arru( intervals, j, Interval*);
-	      totalOverlaps = getNucleotideOverlap ( currGIR->readStart1,currGIR->readEnd1, currInterval );
-	    }
-	    if ( totalOverlaps >  ( (double)(readLength) * 0.25 ) ) {
-	      currGE->numInter-= getNumInter( currGIR, readLength );
-	      currGIR->flag = 1;
-	      continue;
-	      }*/
-	    intervals = intervalFind_getOverlappingIntervals (currGE->chromosomeTranscript2,currGIR->readStart2,currGIR->readEnd2);
-	    if( arrayMax( intervals ) > 0 ) { 
+	    addReadQuery( queries, currGE->chromosomeTranscript1, currGIR->readStart1, currGIR->readEnd1 );
+	    addReadQuery( queries, currGE->chromosomeTranscript2, currGIR->readStart2, currGIR->readEnd2 );
+	  }
+	  intervalIndex_sweep( annotationIndex, queries, countOverlaps );
+	  for (i = 0; i < arrayMax (currGE->interReads); i++) {
+	    currGIR = arrp (currGE->interReads,i,GfrInterRead);
+	    // any overlap flags the read; the total overlap (getNucleotideOverlap) waits for a fix of SAM2MRF
+	    if( arrp( queries, 2*i, IntervalQuery )->result > 0 || arrp( queries, 2*i+1, IntervalQuery )->result > 0 ) { 
 	      currGE->numInter-= getNumInter( currGIR, readLength );
 	      currGIR->flag = 1;
-	      continue;
-	    }
-	    /* for(j=0; j < arrayMax( intervals ); j++) { // to fix SAM2MRF before using the total overlap
-	      Interval* currInterval = arru( intervals, j, Interval*);
-	      totalOverlaps = getNucleotideOverlap ( currGIR->readStart2,currGIR->readEnd2, currInterval );
 	    }
-	    if ( totalOverlaps >  ( ((double)(readLength)) * 0.25) ) {
-	      currGE->numInter-= getNumInter( currGIR, readLength );
-	      currGIR->flag = 1;
-	      continue;
-	      }*/
 	  }
 	  
 	  if (currGE->numInter < (float)minNumInterReads) { 
@@ -128,7 +109,9 @@ int main (int argc, char *argv[]) {
 	  count++;
 	}
 	gfr_deInit ();
-	warn ( "%s_interval: %s/%s", argv[0], confp_get( Conf, "PSEUDOGENE_DIR"), confp_get( Conf, "PSEUDOGENE_FILENAME") );
+	arrayDestroy( queries );
+	intervalIndex_close( annotationIndex );
+	warn ( "%s_interval: %s/%s", argv[0], conf->pseudogeneDir, conf->pseudogeneFilename );
 	warn ("%s_numRemoved: %d",argv[0],countRemoved);
 	warn ("%s_numGfrEntries: %d",argv[0],count);
 	return 0;
@@ -1,13 +1,15 @@
 #include <bios/log.h>
 #include <bios/format.h>
 #include <bios/intervalFind.h>
-#include <bios/confp.h>
+#include "conf.h"
 #include "gfr.h"
+#include "intervalIndex.h"
+#include "coverageMap.h"
 
 /**
    @file gfrRepeatMaskerFilter.c
    @brief Filter to remove artifacts due to mis-alignment to repetitive regions.
-   @details It removes candidates with reads overlapping repetitive sequences. It looks at non-exonic reads and, if some overlap exists with repetitive regions, the reads are excluded and the number of inter-reads is updated accordingly. MAX_OVERLAP_ALLOWED will determine if an overlap triggers the removal of the read. If the remaining number of reads is below the threshold (minNumberOfReads), the fusion candidate is removed.
+   @details It removes candidates with reads overlapping repetitive sequences. It looks at non-exonic reads and, if some overlap exists with repetitive regions, the reads are excluded and the number of inter-reads is updated accordingly. MAX_OVERLAP_ALLOWED will determine if an overlap triggers the removal of the read. If REPEATMASKER_COVERAGE_FILENAME is set, the overlap is the number of repeat bases of the read, counted in the coverage map compiled by interval2coverageMap (overlapping repeats are counted once); otherwise it is the overlap with the last repeat hit by the read. If the remaining number of reads is below the threshold (minNumberOfReads), the fusion candidate is removed.
    
    @author Andrea Sboner  (andrea.sboner.w [at] gmail.com).  
    @version 0.8
@@ -18,7 +20,9 @@
    @pre [in] minNumberInterReads An integer representing the minimum number of reads to keep the fusion candidate.
  */
 
-static config *Conf = NULL; /**< Pointer to configuration file .fusionseqrc  */
+static Conf *conf = NULL; /**< Pointer to configuration file .fusionseqrc  */
+static IntervalIndex *annotationIndex = NULL; /**< RepeatMasker intervals */
+static CoverageMap *coverageMap = NULL; /**< RepeatMasker bases, if REPEATMASKER_COVERAGE_FILENAME is set */
 
 static float getNumInter( GfrInterRead* currInter, int readLength ) { // computes the correct number of the inters by considering split reads on splice junctions.
   float numInter=0.0;
@@ -44,35 +48,49 @@ int getNucleotideOverlap( int start, int end, Interval* currInterval ) {
   return overlap;
 }
 
+static void addOverlap( IntervalQuery* query, Interval* currInterval ) { // as in the per-read loop, the overlap with the last interval (by start) is kept
+  query->result = getNucleotideOverlap( query->start, query->end, currInterval );
+}
+
+static void countCoveredBases( Array queries ) {
+  int i;
+  for( i=0; i<arrayMax( queries ); i++ ) {
+    IntervalQuery* currQuery = arrp( queries, i, IntervalQuery );
+    currQuery->result = coverageMap_countCovered( coverageMap, currQuery->chromosome, currQuery->start, currQuery->end );
+  }
+}
+
+static void addReadQuery( Array queries, char* chromosome, int start, int end ) {
+  IntervalQuery* currQuery = arrayp( queries, arrayMax( queries ), IntervalQuery );
+  currQuery->chromosome = chromosome;
+  currQuery->start = start;
+  currQuery->end = end;
+  currQuery->result = 0;
+}
+
 int main (int argc, char *argv[]) {
 	GfrEntry *currGE;
 	int count,countRemoved;
-	int i, j;
-	Array intervals;
+	int i, k;
+	Array queries = arrayCreate( 100, IntervalQuery );
 	GfrInterRead *currGIR;
 	int totalOverlaps;
 	float minNumInterReads;
 	float numberOfInters;
 	Stringa buffer = stringCreate(100);
 
-	if ((Conf = confp_open(getenv("FUSIONSEQ_CONFPATH"))) == NULL) {
-	  die("%s:\tCannot find .fusionseqrc: %s", argv[0], getenv("FUSIONSEQ_CONFPATH"));
-	  return EXIT_FAILURE;
-	}
-	if( confp_get( Conf, "REPEATMASKER_DIR")==NULL ) {
-	  die("%s:\tCannot find REPEATMASKER_DIR in the configuration file: %s)", argv[0], getenv("FUSIONSEQ_CONFPATH") );
-	  return EXIT_FAILURE;
-	}
-	if( confp_get( Conf, "REPEATMASKER_FILENAME")==NULL ) {
-	  die("%s:\tCannot find REPEATMASKER_FILENAME in the configuration file: %s)", argv[0], getenv("FUSIONSEQ_CONFPATH") );
-	  return EXIT_FAILURE;
-	}
+	conf = conf_init (argv[0], "REPEATMASKER_DIR", "REPEATMASKER_FILENAME", NULL);
 
 	if (argc != 2) {
 	  usage ("%s <minNumInterReads>",argv[0]);
 	}
-	stringPrintf( buffer, "%s/%s", confp_get( Conf, "REPEATMASKER_DIR"), confp_get( Conf, "REPEATMASKER_FILENAME") );
-	intervalFind_addIntervalsToSearchSpace (string(buffer),0);
+	stringPrintf( buffer, "%s/%s", conf->repeatMaskerDir, conf->repeatMaskerFilename );
+	if (conf->repeatMaskerCoverageFilename != NULL) {
+	  stringPrintf( buffer, "%s/%s", conf->repeatMaskerDir, conf->repeatMaskerCoverageFilename );
+	  coverageMap = coverageMap_open (string(buffer));
+	} else {
+	  annotationIndex = intervalIndex_open (string(buffer),0);
+	}
 	stringDestroy(buffer); 
 	minNumInterReads = atof (argv[1]);
 	count = 0;
@@ -82,28 +100,36 @@ int main (int argc, char *argv[]) {
 	while (currGE = gfr_nextEntry ()){
 	  int readLength = strlen(arru(currGE->readsTranscript1, 0, char*));
 	  numberOfInters = (float) currGE->numInter;
+	  // the two ends of all the non-exonic reads are swept at once against the repeats
+	  arrayClear( queries );
 	  for (i = 0; i < arrayMax (currGE->interReads); i++) {
 	    currGIR = arrp (currGE->interReads,i,GfrInterRead);
 	    if (currGIR->pairType == GFR_PAIR_TYPE_EXONIC_EXONIC) {
 	      continue;
 	    }
-	    totalOverlaps = 0;
-	    intervals = intervalFind_getOverlappingIntervals (currGE->chromosomeTranscript1,currGIR->readStart1,currGIR->readEnd1);
-	    for(j=0; j < arrayMax( intervals ); j++) {
-	      Interval* currInterval = arru( intervals, j, Interval*);
-	      totalOverlaps = getNucleotideOverlap ( currGIR->readStart1,currGIR->readEnd1, currInterval );
+	    addReadQuery( queries, currGE->chromosomeTranscript1, currGIR->readStart1, currGIR->readEnd1 );
+	    addReadQuery( queries, currGE->chromosomeTranscript2, currGIR->readStart2, currGIR->readEnd2 );
+	  }
+	  if (coverageMap != NULL) {
+	    countCoveredBases( queries );
+	  } else {
+	    intervalIndex_sweep( annotationIndex, queries, addOverlap );
+	  }
+	  k = 0;
+	  for (i = 0; i < arrayMax (currGE->interReads); i++) {
+	    currGIR = arrp (currGE->interReads,i,GfrInterRead);
+	    if (currGIR->pairType == GFR_PAIR_TYPE_EXONIC_EXONIC) {
+	      continue;
 	    }
-	    if ( totalOverlaps >  ( ((double)(readLength)) * strtod(confp_get(Conf, "MAX_OVERLAP_ALLOWED"), NULL) ) ) {
+	    totalOverlaps = arrp( queries, k++, IntervalQuery )->result;
+	    if ( totalOverlaps >  ( ((double)(readLength)) * conf->maxOverlapAllowed ) ) {
 	      currGE->numInter-= getNumInter( currGIR, readLength );
 	      currGIR->flag = 1;
+	      k++;
 	      continue;
 	    }
-	    intervals = intervalFind_getOverlappingIntervals (currGE->chromosomeTranscript2,currGIR->readStart2,currGIR->readEnd2);
-	     for(j=0; j < arrayMax( intervals ); j++) {
-	      Interval* currInterval = arru( intervals, j, Interval*);
-	      totalOverlaps = getNucleotideOverlap ( currGIR->readStart2,currGIR->readEnd2, currInterval );
-	    }
-	    if ( totalOverlaps >  ( ((double)(readLength)) * strtod(confp_get(Conf, "MAX_OVERLAP_ALLOWED"), NULL) ) ) {
+	    totalOverlaps = arrp( queries, k++, IntervalQuery )->result;
+	    if ( totalOverlaps >  ( ((double)(readLength)) * conf->maxOverlapAllowed ) ) {
 	      currGE->numInter-= getNumInter( currGIR, readLength );
 	      currGIR->flag = 1;
 	      continue;
@@ -118,7 +144,10 @@ int main (int argc, char *argv[]) {
 	  count++;
 	}
 	gfr_deInit ();
-	warn ( "%s_interval: %s/%s", argv[0], confp_get( Conf, "REPEATMASKER_DIR"), confp_get( Conf, "REPEATMASKER_FILENAME") );
+	arrayDestroy( queries );
+	intervalIndex_close( annotationIndex );
+	coverageMap_close( coverageMap );
+	warn ( "%s_interval: %s/%s", argv[0], conf->repeatMaskerDir, conf->repeatMaskerFilename );
 	warn ("%s_numRemoved: %d",argv[0],countRemoved);
 	warn ("%s_numGfrEntries: %d",argv[0],count);
 	return 0;
@@ -1,7 +1,7 @@
 #include <bios/log.h>
 #include <bios/format.h>
 #include <bios/intervalFind.h>
-#include <bios/confp.h>
+#include "conf.h"
 #include "gfr.h"
 
 /**
@@ -16,7 +16,7 @@
    @pre A valid GFR file as input, including stdin.
  */
 
-static config *Conf = NULL; /**< Pointer to configuration file .fusionseqrc  */
+static Conf *conf = NULL; /**< Pointer to configuration file .fusionseqrc  */
 
 static float getNumInter( GfrInterRead* currInter, int readLength ) { // computes the correct number of the inters by considering split reads on splice junctions.
   float numInter=0.0;
@@ -52,10 +52,7 @@ int main (int argc, char *argv[]) {
 	Stringa buffer = stringCreate(100);
 	float minNumInterReads;
 
-	if ((Conf = confp_open(getenv("FUSIONSEQ_CONFPATH"))) == NULL) {
-	  die("%s:\tCannot find .fusionseqrc: %s", argv[0], getenv("FUSIONSEQ_CONFPATH"));
-	  return EXIT_FAILURE;
-	}
+	conf = conf_init (argv[0], NULL);
 	if (argc != 2) {
 	  usage ("%s <minNumInterReads>",argv[0]);
 	}
@@ -2,8 +2,8 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/wait.h>
 
-#include <bios/confp.h>
 #include <bios/log.h>
 #include <bios/format.h>
 #include <bios/bowtieParser.h>
@@ -12,8 +12,28 @@
 #include <bios/blastParser.h>
 #include <bios/linestream.h>
 
+#include "conf.h"
 #include "gfr.h"
 #include "util.h"
+#include "metrics.h"
+#include "gfrCache.h"
+#include "gfServerClient.h"
+#include "alignmentCache.h"
+#include "twoBit.h"
+#include "localAligner.h"
+#include "subprocess.h"
+#include "intervalIndex.h"
+
+
+#define LOCAL_MIN_SCORE 30 // the default minScore of blat
+
+
+
+static Conf *conf = NULL;
+static TwoBit *twoBit = NULL;
+static AlignmentCache *alignmentCache = NULL;
+static int gfServerPort = -1; // -1 until the gfServer of the genome is needed
+static IntervalIndex *pseudogeneIndex = NULL;
 
 
 /**
@@ -24,8 +44,13 @@
    @version 0.8
    @date 2013.09.10
    @remarks WARNings will be output to stdout to summarize the filter results.
-   @remarks To speed up the computation, gfServer and gfClient (part of Blat suite) are used. If the server is not running, it will be initiated. The location of the tools must be defined in .fusionseqrc. Moreover, the human genome reference is assigned to  BLAT_GFSERVER_PORT. Note that gfrRibosomal filter uses gfServer on BLAT_GFSERVER_PORT + 1.
-   @pre It requires 'blat' and 'fastx_collapser' to be used, defined in .fusionseqrc
+   @remarks To speed up the computation, gfServer and gfClient (part of Blat suite) are used. If the server is not running, it will be initiated, when the first read that is not in the alignment cache has to be aligned against the genome. The location of the tools must be defined in .fusionseqrc. Moreover, the gfServer of the human genome reference is shared with the other processes on the host, so the genome is loaded once for many samples; its port is handed out from BLAT_GFSERVER_PORT on (see gfServerClient.h).
+   @remarks The number of genomic alignments of each read is kept in the alignment cache (CACHE_DIR), so that a read is aligned against the genome only once across candidates and runs.
+   @remarks The reads of each end are aligned in process against the region of the other transcript (see localAligner.h), instead of running blat -fine on the extracted transcripts.
+   @remarks With -j N the candidates are checked by N worker processes; the output follows the order of the input.
+   @remarks No temporary files are written: the reads and the PSL of gfClient, and the results of the workers, are in-memory files (see subprocess.h).
+   @param [in] -j numWorkers number of worker processes, 1 by default [optional]
+   @attention @code $ gfrSmallScaleHomologyFilter -j 8 < file.gfr @endcode
    @pre A valid GFR file as input, including stdin.
    @pre humanReference.2bit A 2bit file with the sequences of the human genome, defined in .fusionseqrc
  */
@@ -36,7 +61,6 @@
   \author Andrea Sboner (andrea.sboner.w [at] gmail.com).
   \version 0.8
   \date 2012.08.22						
-  \pre It requires 'blat' and 'fastx' to be on the path.
  */
 
 /*static int sortBowtieQueriesBySequenceName (BowtieQuery *a, BowtieQuery *b)
@@ -61,101 +85,242 @@ static char getTranscriptNumber (char *seqName)
   return *(pos + 1);
 }
 
+/// number of reads, counted with their multiplicity, that align to the region of the partner transcript
+static int countHomologousReads( TwoBit* twoBit, char* chromosome, int start, int end, Texta reads, double maxOverlapAllowed, int* minReadSize )
+{
+  LocalAligner *aligner;
+  Array collapsedReads;
+  CollapsedRead *currCR;
+  char *sequence;
+  int l, readSize, homologousCount = 0;
+
+  for (l = 0; l < arrayMax (reads); l++) {
+    readSize = strlen( textItem( reads, l ) );
+    if( readSize == 0 ) die("Read size cannot be zero: read[ %s ]", textItem( reads, l ));
+    if( readSize < *minReadSize ) *minReadSize = readSize;
+  }
+  if (!(sequence = twoBit_getRegion( twoBit, chromosome, start, end, 1 ))) {
+    die ("Sequence not found in the 2bit file: %s", chromosome);
+  }
+  aligner = localAligner_create( sequence );
+  hlr_free( sequence );
+  collapsedReads = util_collapseReads( reads );
+  for (l = 0; l < arrayMax (collapsedReads); l++) {
+    currCR = arrp( collapsedReads, l, CollapsedRead );
+    if ( localAligner_align( aligner, currCR->sequence, LOCAL_MIN_SCORE ) > ( ((double)strlen( currCR->sequence ))* maxOverlapAllowed) ) {
+      homologousCount += currCR->count;
+    }
+  }
+  arrayDestroy( collapsedReads );
+  localAligner_destroy( aligner );
+  return homologousCount;
+}
+
 void checkPseudogeneOverlap( BlatQuery* blQ ) 
 {
   PslEntry* blE;
   int i;
-  Array intervals=arrayCreate(2, Interval);
-  for( i=0; i<arrayMax(blQ->entries); i++) {
+  Array intervals; // owned by the index
+  // backwards, so that a removal does not skip the next entry
+  for( i=arrayMax(blQ->entries)-1; i>=0; i--) {
     blE = arrp( blQ->entries, i, PslEntry );
-    intervals = intervalFind_getOverlappingIntervals ( blE->tName, blE->tStart, blE->tEnd);
+    intervals = intervalIndex_getOverlappingIntervals ( pseudogeneIndex, blE->tName, blE->tStart, blE->tEnd);
     if( arrayMax(intervals)>0) arrayRemoveD( blQ->entries, i );
   }
 }
 
-int main (int argc, char *argv[])
+/// port of the gfServer of the genome, started at the first read missing from the alignment cache: a run resolved by the caches does not load the genome
+static int getGfServerPort( void )
 {
-  GfrEntry *currGE;
-  int i,j,k,l, h,index;
-  Stringa buffer,cmd,fnSequencesToAlign;
+  Stringa twoBitFile;
+
+  if( gfServerPort < 0 ) {
+    twoBitFile = stringCreate( 100 );
+    stringPrintf( twoBitFile, "%s/%s", conf->blatDataDir, conf->blatTwoBitDataFilename );
+    gfServerPort = gfServerClient_start( string(twoBitFile), "genome" );
+    stringDestroy( twoBitFile );
+  }
+  return gfServerPort;
+}
+
+/// homology checks of a candidate. @return 1 if the candidate is kept
+static int checkCandidate( GfrEntry* currGE )
+{
+  static Stringa cmd = NULL;
+  static Stringa params = NULL;
+  static Stringa value = NULL;
   FILE *fp;
-  FILE *fp1;
-  FILE *fp2;
-  FILE *freads1;
-  FILE *freads2;
-  Array gfrEntries;
-  BowtieQuery *currBQ,testBQ;
-  BowtieEntry *currBE;
-  Texta seqNames;
-  int readSize1, readSize2, minReadSize;
-  Array bowtieQueries;
-  char transcriptNumber;
-  int isHomologous,homologousCount;
-  int count;
-  int countRemoved;
-  unsigned short int tooMany;
+  MemFile *reads, *psl;
   BlatQuery *blQ;
+  Array numHits;
+  int l, k, minReadSize, minScore, numPending, homologousCount;
+  unsigned short int tooMany;
 
-  config *conf;
-
-  if ((conf = confp_open(getenv("FUSIONSEQ_CONFPATH"))) == NULL) {
-    die("%s:\tCannot find .fusionseqrc", argv[0]);
-    return EXIT_FAILURE;
-  } 
-  if ( (confp_get( conf, "BLAT_TWO_BIT_TO_FA")) == NULL) {
-    die("%s:\tCannot find BLAT_TWO_BIT_TO_FA in the configuration file: %s", argv[0], getenv("FUSIONSEQ_CONFPATH") );
-    return EXIT_FAILURE;
-  } 
-  if ( (confp_get( conf,"BLAT_DATA_DIR")) == NULL) {
-    die("%s:\tCannot find BLAT_DATA_DIR in the configuration file: %sc", argv[0], getenv("FUSIONSEQ_CONFPATH") );
-    return EXIT_FAILURE;
-  } 
- if( confp_get( conf, "TMP_DIR")==NULL ) {
-    die("%s:\tCannot find TMP_DIR in the configuration file: %s)", argv[0], getenv("FUSIONSEQ_CONFPATH") );
-    return EXIT_FAILURE;
+  stringCreateClear( cmd, 100 );
+  stringCreateClear( params, 100 );
+  stringCreateClear( value, 20 );
+  homologousCount = 0;
+  minReadSize=10000;
+  // reads of one end aligned in process against the region of the other transcript
+  homologousCount += countHomologousReads( twoBit, currGE->chromosomeTranscript1, currGE->startTranscript1, currGE->endTranscript1, currGE->readsTranscript2, conf->maxOverlapAllowed, &minReadSize );
+  homologousCount += countHomologousReads( twoBit, currGE->chromosomeTranscript2, currGE->startTranscript2, currGE->endTranscript2, currGE->readsTranscript1, conf->maxOverlapAllowed, &minReadSize );
+  if (((double)homologousCount / (double)arrayMax(currGE->readsTranscript1)) > conf->maxFractionHomologous ) { 
+    gfrCache_store( currGE, 0 );
+    return 0;
   }
-  if( confp_get( conf, "BLAT_GFSERVER")==NULL ) {
-    die("%s:\tCannot find BLAT_GFSERVER in the configuration file: %s)", argv[0], getenv("FUSIONSEQ_CONFPATH") );
-    return EXIT_FAILURE;
+  homologousCount = 0;
+  // there is no homology between the two genes, but what about the rest of the genome
+  minScore = minReadSize - (int)(0.1 * minReadSize) > 20 ? minReadSize - (int) (0.1 * minReadSize) : 20;
+  stringPrintf( params, "minScore=%d", minScore );
+  // looking up the reads in the alignment cache, only the others are aligned against the genome
+  if (arrayMax(currGE->readsTranscript1) != arrayMax(currGE->readsTranscript2))
+    die("Error: different number of inter-transcript reads %d vs. %d", arrayMax( currGE->readsTranscript1), arrayMax( currGE->readsTranscript2) );
+  numHits = arrayCreate( 2 * arrayMax(currGE->readsTranscript1), int );
+  numPending = 0;
+  reads = subprocess_createMemFile( currGE->id );
+  fp = subprocess_getStream( reads );
+  for (l = 0; l < arrayMax (currGE->readsTranscript1); l++) {
+    for (k = 0; k < 2; k++) {
+      char* currRead = textItem( k == 0 ? currGE->readsTranscript1 : currGE->readsTranscript2, l );
+      char* cachedValue = alignmentCache_get( alignmentCache, currRead, string(params) );
+      if( cachedValue ) {
+	array( numHits, 2 * l + k, int ) = atoi( cachedValue );
+      } else {
+	array( numHits, 2 * l + k, int ) = -2; // pending
+	fprintf( fp, ">%d/%d\n%s\n", l, k + 1, currRead );
+	numPending++;
+      }
+    }
   }
- if( confp_get( conf, "BLAT_GFCLIENT")==NULL ) {
-    die("%s:\tCannot find BLAT_GFCLIENT in the configuration file: %s)", argv[0], getenv("FUSIONSEQ_CONFPATH") );
-    return EXIT_FAILURE;
+  if( numPending > 0 ) {
+    psl = subprocess_createMemFile( currGE->id );
+    stringPrintf(cmd, "%s %s %d / -t=dna -q=dna -minScore=%d -out=psl %s %s >/dev/null 2>&1", conf->blatGfClient, conf->blatGfServerHost, getGfServerPort(), minScore, subprocess_getPath( reads ), subprocess_getPath( psl ));
+    gfServerClient_run( gfServerPort, string(cmd) );
+    // reading the results of blast from the in-memory file
+    blatParser_initFromFile( subprocess_getPath( psl ) );
+    while( blQ = blatParser_nextQuery() ) {
+      checkPseudogeneOverlap( blQ );
+      if( sscanf( blQ->qName, "%d/%d", &l, &k ) != 2 || l < 0 || l >= arrayMax(currGE->readsTranscript1) || k < 1 || k > 2 ) {
+	die("Not a valid index in the blat query name:\t%s", blQ->qName );
+      }
+      arru( numHits, 2 * l + k - 1, int ) = arrayMax( blQ->entries );
+      stringPrintf( value, "%d", arrayMax( blQ->entries ) );
+      alignmentCache_put( alignmentCache, textItem( k == 1 ? currGE->readsTranscript1 : currGE->readsTranscript2, l ), string(params), string(value) );
+    }
+    blatParser_deInit();
+    subprocess_destroyMemFile( psl );
+    for (l = 0; l < arrayMax (numHits); l++) {
+      if( arru( numHits, l, int ) == -2 ) { // not reported by gfClient
+	arru( numHits, l, int ) = -1;
+	alignmentCache_put( alignmentCache, textItem( l % 2 == 0 ? currGE->readsTranscript1 : currGE->readsTranscript2, l / 2 ), string(params), "-1" );
+      }
+    }
   }
-if( confp_get( conf, "BLAT_GFSERVER_HOST")==NULL ) {
-    die("%s:\tCannot find BLAT_GFSERVER_HOST in the configuration file: %s)", argv[0], getenv("FUSIONSEQ_CONFPATH") );
-    return EXIT_FAILURE;
-  }if( confp_get( conf, "BLAT_GFSERVER_PORT")==NULL ) {
-    die("%s:\tCannot find BLAT_GFSERVER_PORT in the configuration file: %s)", argv[0], getenv("FUSIONSEQ_CONFPATH") );
-    return EXIT_FAILURE;
+  // -1 means that the read was not aligned, otherwise the number of alignments outside pseudogenes
+  tooMany = 1;
+  for (l = 0; l < arrayMax (numHits); l++) {
+    if( arru( numHits, l, int ) < 0 ) continue;
+    tooMany = 0;
+    if( arru( numHits, l, int ) > 1 ) {
+      homologousCount+= arru( numHits, l, int ) - 1;
+      GfrInterRead *currGIR = arrp( currGE->interReads, l / 2, GfrInterRead ); // the read is removed when writing the GFR entry
+      currGIR->flag = 1;
+    }
   }
- if( confp_get( conf, "PSEUDOGENE_DIR")==NULL ) {
-   die("%s:\tCannot find PSEUDOGENE_DIR in the configuration file: %s)", argv[0], getenv("FUSIONSEQ_CONFPATH") );
-   return EXIT_FAILURE;
- }
- if( confp_get( conf, "PSEUDOGENE_FILENAME")==NULL ) {
-   die("%s:\tCannot find PSEUDOGENE_FILENAME in the configuration file: %s)", argv[0], getenv("FUSIONSEQ_CONFPATH") );
-   return EXIT_FAILURE;
- }
- 
-  cmd = stringCreate (100);
-  // initializing the gfServers
-  stringPrintf( cmd, "%s status %s %s &> /dev/null", confp_get( conf, "BLAT_GFSERVER"), confp_get( conf, "BLAT_GFSERVER_HOST"), confp_get( conf, "BLAT_GFSERVER_PORT") );
-  int ret = hlr_system( string(cmd), 1 );
-  if( ret != 0 ) { // not initialized
-    stringPrintf( cmd , "%s -repMatch=100000 -tileSize=12 -canStop -log=%s/gfServer_genome.log start %s %s %s/%s  &", confp_get( conf, "BLAT_GFSERVER"), confp_get(conf, "TMP_DIR"),confp_get( conf, "BLAT_GFSERVER_HOST"), confp_get( conf, "BLAT_GFSERVER_PORT"), confp_get(conf, "BLAT_DATA_DIR"), confp_get(conf, "BLAT_TWO_BIT_DATA_FILENAME"));
-    hlr_system( string( cmd ), 0 );
-    long int startTime = time(0);
-    stringPrintf( cmd , "%s status %s %s &2> /dev/null", confp_get( conf, "BLAT_GFSERVER"), confp_get( conf, "BLAT_GFSERVER_HOST"), confp_get( conf, "BLAT_GFSERVER_PORT"));
-    while( hlr_system( string(cmd), 1) && (time(0)-startTime)<600 ) ;
-    if( hlr_system( string(cmd), 1 ) != 0 )  {
-      die("gfServer for %s/%s not initialized: %s %s %s", confp_get(conf, "BLAT_DATA_DIR"), confp_get(conf, "BLAT_TWO_BIT_DATA_FILENAME"), confp_get( conf, "BLAT_GFSERVER"), confp_get( conf, "BLAT_GFSERVER_HOST"), confp_get( conf, "BLAT_GFSERVER_PORT")); 
-      return EXIT_FAILURE;
+  arrayDestroy( numHits );
+  subprocess_destroyMemFile( reads );
+  if (  tooMany == 1 || ( ( (double) homologousCount / (double) ( arrayMax(currGE->readsTranscript1) + arrayMax(currGE->readsTranscript2) ) )  > conf->maxFractionHomologous ) ) {
+    gfrCache_store( currGE, 0 );
+    return 0;
+  }
+  // the gfrEntry is written, if everthing else didn't stop 
+  gfrCache_store( currGE, 1 );
+  if( homologousCount > 0 ) updateStats( currGE );
+  return 1;
+}
+
+/// number of inter-transcript reads flagged in a candidate
+static int countFlaggedReads( GfrEntry* currGE )
+{
+  int l, numFlagged = 0;
+  for (l = 0; l < arrayMax (currGE->interReads); l++) {
+    if( arrp( currGE->interReads, l, GfrInterRead )->flag ) numFlagged++;
+  }
+  return numFlagged;
+}
+
+/// worker process: it checks the candidates w, w + numWorkers, ... and writes "index keep numFlagged" followed by the entry, if kept, into its results
+static void runWorker( Array gfrEntries, Array pending, int w, int numWorkers, MemFile* results )
+{
+  FILE *fp;
+  GfrEntry *currGE;
+  int i, index, keep;
+
+  fp = subprocess_getStream( results );
+  for (i = w; i < arrayMax (pending); i += numWorkers) {
+    index = arru( pending, i, int );
+    currGE = arrp( gfrEntries, index, GfrEntry );
+    keep = checkCandidate( currGE );
+    fprintf( fp, "%d\t%d\t%d\n", index, keep, keep ? countFlaggedReads( currGE ) : 0 );
+    if( keep ) fprintf( fp, "%s\n", gfr_writeGfrEntry( currGE ) );
+  }
+  fflush( fp );
+}
+
+/// reads the results of a worker into outputs, indexed by candidate
+static void readWorkerResults( MemFile* results, Array outputs )
+{
+  LineStream ls;
+  char *line;
+  int index, keep, numFlagged;
+
+  ls = ls_createFromFile( subprocess_getPath( results ) );
+  while( line = ls_nextLine( ls ) ) {
+    if( sscanf( line, "%d\t%d\t%d", &index, &keep, &numFlagged ) != 3 ) {
+      die ("Not a valid result of a worker: %s", line);
+    }
+    if( keep ) {
+      if( !(line = ls_nextLine( ls )) ) {
+	die ("Missing entry in the results of a worker: %d", index);
+      }
+      arru( outputs, index, char* ) = hlr_strdup( line );
+      // the entries written by the workers are accounted here
+      metrics_addEntriesOut( 1 );
+      metrics_addBytesWritten( strlen( line ) + 1 );
+      metrics_addReadsFlagged( numFlagged );
     }
-  } 
-  // end initialization
+  }
+  ls_destroy( ls );
+}
 
-  
+int main (int argc, char *argv[])
+{
+  GfrEntry *currGE;
+  int i, w;
+  Stringa buffer, cmd;
+  Array gfrEntries, pending, outputs;
+  Array results;
+  int count;
+  int countRemoved;
+  int numWorkers;
+  pid_t pid;
+  Array pids;
+  int status;
+  int keep;
+
+  numWorkers = 1;
+  for (i = 1; i < argc; i++) {
+    if( strEqual( argv[i], "-j" ) && i + 1 < argc ) {
+      numWorkers = atoi( argv[++i] );
+    } else {
+      usage( "%s [-j numWorkers] < file.gfr", argv[0] );
+    }
+  }
+  if( numWorkers < 1 ) numWorkers = 1;
+
+  conf = conf_init (argv[0], "BLAT_DATA_DIR", "BLAT_TWO_BIT_DATA_FILENAME", "TMP_DIR", "BLAT_GFSERVER", "BLAT_GFCLIENT", "BLAT_GFSERVER_HOST", "BLAT_GFSERVER_PORT", "PSEUDOGENE_DIR", "PSEUDOGENE_FILENAME", NULL); 
+ 
+  cmd = stringCreate (100);
   gfr_init ("-");
   gfrEntries =  gfr_parse ();
   if (arrayMax (gfrEntries) == 0){
@@ -163,158 +328,106 @@ if( confp_get( conf, "BLAT_GFSERVER_HOST")==NULL ) {
     gfr_deInit ();
     return 0;
   }
-  seqNames = textCreate (10000); 
+  twoBit = twoBit_open( conf_getPath( conf->blatDataDir, conf->blatTwoBitDataFilename ) );
   buffer = stringCreate (100);
-  fnSequencesToAlign = stringCreate (100);
   count = 0;
   countRemoved = 0;
 
-  stringPrintf( buffer, "%s/%s", confp_get( conf, "PSEUDOGENE_DIR"), confp_get( conf, "PSEUDOGENE_FILENAME") );
-  intervalFind_addIntervalsToSearchSpace (string(buffer),0);
+  stringPrintf( buffer, "%s/%s", conf->pseudogeneDir, conf->pseudogeneFilename );
+  pseudogeneIndex = intervalIndex_open (string(buffer),0);
 
+  // the number of workers does not change the verdicts: it is not part of the cache key
+  gfrCache_init (argv[0], 1, argv, "MAX_OVERLAP_ALLOWED", "MAX_FRACTION_HOMOLOGOUS", "BLAT_DATA_DIR", "BLAT_TWO_BIT_DATA_FILENAME", "PSEUDOGENE_DIR", "PSEUDOGENE_FILENAME", NULL);
+  stringPrintf( cmd, "%s/%s", conf->blatDataDir, conf->blatTwoBitDataFilename );
+  gfrCache_addContextFile( string(cmd) );
+  gfrCache_addContextFile( string(buffer) );
+  // the number of genomic alignments of a read depends also on the pseudogenes that are discarded
+  stringPrintf( cmd, "gfClient pseudogenes=%s", string(buffer) );
+  stringPrintf( buffer, "%s/%s", conf->blatDataDir, conf->blatTwoBitDataFilename );
+  alignmentCache = alignmentCache_open( string(buffer), string(cmd) );
   puts (gfr_writeHeader ());
- 
+
+  // output of each candidate, NULL if removed; the candidates in the cache are resolved here
+  outputs = arrayCreate( arrayMax (gfrEntries), char* );
+  pending = arrayCreate( arrayMax (gfrEntries), int );
   for (i = 0; i < arrayMax (gfrEntries); i++) {
     currGE = arrp (gfrEntries,i,GfrEntry);
-    homologousCount = 0;
-    minReadSize=10000;
-    // creating two fasta files with the two genes
-    
-    stringPrintf( cmd, "%s %s/%s -seq=%s -start=%d -end=%d %s/%s_transcript1.fa", confp_get(conf, "BLAT_TWO_BIT_TO_FA") , confp_get(conf, "BLAT_DATA_DIR"), confp_get(conf, "BLAT_TWO_BIT_DATA_FILENAME"), currGE->chromosomeTranscript1, currGE->startTranscript1, currGE->endTranscript1, confp_get(conf, "TMP_DIR"), currGE->id);
-    hlr_system( string(cmd) , 0);   
-    stringPrintf( cmd, "%s %s/%s -seq=%s -start=%d -end=%d %s/%s_transcript2.fa", confp_get(conf, "BLAT_TWO_BIT_TO_FA"),  confp_get(conf, "BLAT_DATA_DIR"), confp_get(conf, "BLAT_TWO_BIT_DATA_FILENAME"), currGE->chromosomeTranscript2, currGE->startTranscript2, currGE->endTranscript2, confp_get(conf, "TMP_DIR"), currGE->id);
-    hlr_system( string(cmd) , 0);   
-    
-    Stringa fa1 = stringCreate( 100 ); 
-    Stringa fa2 = stringCreate( 100 );
-    
-    // creating the two fasta files with the reads
-    stringPrintf( fa1, "%s/%s_reads1.fa", confp_get(conf, "TMP_DIR"), currGE->id);
-    if (!(freads1 = fopen ( string(fa1) ,"w"))) {
-      die ("Unable to open file: %s",string (fa1));
-    }   
-    // writing the reads of the first end into file
-    
-    for (l = 0; l < arrayMax (currGE->readsTranscript1); l++) {
-      char* currRead1 = hlr_strdup( textItem (currGE->readsTranscript1,l)); // read1
-      readSize1 = strlen( currRead1 );
-      if( readSize1 == 0 ) die("Read size cannot be zero: read1[ %s ]", currRead1);
-      if( readSize1 < minReadSize ) minReadSize = readSize1;
-      fprintf( freads1, ">%d\n%s\n", l, currRead1 );
-      hlr_free( currRead1 );
-    }
-    fclose( freads1 );
-    
-    stringPrintf( fa2, "%s/%s_reads2.fa", confp_get(conf, "TMP_DIR"), currGE->id);
-    if (!(freads2 = fopen ( string(fa2) ,"w"))) {
-      die ("Unable to open file: %s",string (fa2));
-    } 
-    // writing the reads of the second end into file
-    for (l = 0; l < arrayMax (currGE->readsTranscript2); l++) {
-      char* currRead2 = hlr_strdup( textItem (currGE->readsTranscript2,l)); // read2
-      readSize2 = strlen( currRead2 );
-      if( readSize2 == 0 ) die("Read size cannot be zero: read2[ %s ]", currRead2);
-      if( readSize2 < minReadSize ) minReadSize = readSize2;
-      fprintf( freads2, ">%d\n%s\n", l, currRead2 );
-      hlr_free( currRead2 );
-    }
-    fclose( freads2 );      
-    
-    // collapse the reads 2  ## requires the FASTX package
-    stringPrintf( cmd, "%s -i %s/%s_reads2.fa -o %s/%s_reads2.collapsed.fa", confp_get(conf, "FASTX_COLLAPSER"), confp_get(conf, "TMP_DIR"), currGE->id, confp_get(conf, "TMP_DIR"), currGE->id  );
-    hlr_system (string (cmd),0);
-    
-    //blat of reads2 against the first transcript
-    stringPrintf( cmd, "%s -t=dna -out=psl -fine -tileSize=15 %s/%s_transcript1.fa %s/%s_reads2.collapsed.fa stdout",confp_get(conf, "BLAT_BLAT"), confp_get(conf, "TMP_DIR"), currGE->id, confp_get(conf, "TMP_DIR"), currGE->id );
-    
-    // reading the results of blast from Pipe
-    blatParser_initFromPipe( string(cmd) );
-    while( blQ = blatParser_nextQuery() ) {
-      int nucleotideOverlap = getNucleotideOverlap ( blQ );
-      if ( nucleotideOverlap > ( ((double)readSize2)* atof(confp_get(conf,"MAX_OVERLAP_ALLOWED"))) ) {
-	char* value = strchr(blQ->qName,'-');
-	homologousCount+=atoi(value+1);
+    array( outputs, i, char* ) = NULL;
+    if (gfrCache_lookup (currGE,&keep)) {
+      if (keep) {
+        array( outputs, i, char* ) = hlr_strdup( gfr_writeGfrEntry (currGE) );
       }
+      continue;
     }
-    blatParser_deInit();
-    
-    // collapse the reads 1 ## requires the FASTX package on the path
-    stringPrintf( cmd, "%s -i %s/%s_reads1.fa -o %s/%s_reads1.collapsed.fa", confp_get(conf, "FASTX_COLLAPSER"), confp_get(conf, "TMP_DIR"), currGE->id, confp_get(conf, "TMP_DIR"), currGE->id  );
-    hlr_system (string (cmd),0);
-    
-    //blat of reads1 against the second transcript
-    stringPrintf( cmd, "%s -t=dna -out=psl -fine -tileSize=15 %s/%s_transcript2.fa %s/%s_reads1.collapsed.fa stdout",confp_get(conf, "BLAT_BLAT"), confp_get(conf, "TMP_DIR"), currGE->id, confp_get(conf, "TMP_DIR"), currGE->id  );
-    
-    blatParser_initFromPipe( string(cmd) );
-    while( blQ = blatParser_nextQuery() ) {		
-      int nucleotideOverlap = getNucleotideOverlap ( blQ );
-      if ( nucleotideOverlap > ( ((double)readSize1)* atof(confp_get(conf,"MAX_OVERLAP_ALLOWED"))) ) {
-	char* value = strchr(blQ->qName,'-');
-	homologousCount+=atoi(value+1);
+    array( pending, arrayMax (pending), int ) = i;
+  }
+  if( numWorkers > arrayMax (pending) ) numWorkers = arrayMax (pending) > 0 ? arrayMax (pending) : 1;
+
+  if( numWorkers == 1 ) {
+    for (i = 0; i < arrayMax (pending); i++) {
+      currGE = arrp (gfrEntries,arru( pending, i, int ),GfrEntry);
+      if( checkCandidate( currGE ) ) {
+        arru( outputs, arru( pending, i, int ), char* ) = hlr_strdup( gfr_writeGfrEntry (currGE) );
       }
     }
-    blatParser_deInit();
-    stringPrintf (cmd,"cd %s;rm -rf %s_reads?.fa %s_reads?.collapsed.fa %s_transcript?.fa", confp_get(conf, "TMP_DIR"), currGE->id,currGE->id,currGE->id);
-    hlr_system( string(cmd) , 0);      
-    if (((double)homologousCount / (double)arrayMax(currGE->readsTranscript1)) <= atof(confp_get(conf, "MAX_FRACTION_HOMOLOGOUS")) ) { 
-      homologousCount = 0;
-      // there is no homology between the two genes, but what about the rest of the genome
-      writeFasta( currGE, &minReadSize,  confp_get(conf, "TMP_DIR") );
-      stringPrintf(cmd, "cd %s; %s %s %s / -t=dna -q=dna -minScore=%d -out=psl %s_reads.fa %s.smallhomology.psl &>/dev/null", confp_get(conf, "TMP_DIR"), confp_get( conf, "BLAT_GFCLIENT"), confp_get( conf, "BLAT_GFSERVER_HOST"), confp_get( conf, "BLAT_GFSERVER_PORT"), minReadSize - (int)(0.1 * minReadSize) > 20 ? minReadSize - (int) (0.1 * minReadSize) : 20 ,  currGE->id,  currGE->id);
-      int attempts=0;
-      ret = hlr_system( string(cmd), 1 );
-      while( hlr_system( string(cmd), 1 ) && attempts<5000 ) attempts++;
-      if( attempts == 5000 ) {
-	die("Cannot map the reads %s", string( cmd ));
-	return EXIT_FAILURE;
+  } else {
+    // the workers share the gfServer, registered by this process
+    getGfServerPort();
+    // one process per worker, each writing its results into an in-memory file
+    results = arrayCreate( numWorkers, MemFile* );
+    pids = arrayCreate( numWorkers, pid_t );
+    fflush( stdout );
+    for (w = 0; w < numWorkers; w++) {
+      array( results, w, MemFile* ) = subprocess_createMemFile( "smallScaleHomology" );
+      if( (pid = fork()) < 0 ) {
+        die ("Unable to start the worker %d", w);
       }
-      // reading the results of blast from File
-      stringPrintf(cmd,  "%s/%s.smallhomology.psl", confp_get( conf, "TMP_DIR"), currGE->id);
-      blatParser_initFromFile( string(cmd) );
-      tooMany = 1;
-      while( blQ = blatParser_nextQuery() ) {
-	tooMany = 0;
-	checkPseudogeneOverlap( blQ );
-	if( arrayMax( blQ->entries ) > 1 ) {
-	  homologousCount+= arrayMax( blQ->entries ) - 1;
-	  char* value = strchr( blQ->qName,'/' );
-	  if( value ) *value = '\0'; else die("Not a valid index in the blat query name:\t%s", blQ->qName );
-	  int indexOfInter = atoi( blQ->qName ); // the following three lines should removed the read if writing the GFR entry
-	  GfrInterRead *currGIR = arrp( currGE->interReads, indexOfInter, GfrInterRead );
-	  currGIR->flag = 1;
-	}
+      if( pid == 0 ) {
+        runWorker( gfrEntries, pending, w, numWorkers, arru( results, w, MemFile* ) );
+        _exit( 0 ); // the exit handlers and buffers belong to the parent
       }
-      blatParser_deInit();
-      if (  tooMany == 1 || ( ( (double) homologousCount / (double) ( arrayMax(currGE->readsTranscript1) + arrayMax(currGE->readsTranscript2) ) )  > atof(confp_get(conf, "MAX_FRACTION_HOMOLOGOUS")) ) ) {
-	countRemoved++;
-	stringPrintf (cmd,"cd %s; rm -rf %s_reads*.fa %s_reads?.collapsed.fa %s_transcript?.fa %s.smallhomology.psl", confp_get(conf, "TMP_DIR"), currGE->id,currGE->id,currGE->id,currGE->id);
-	hlr_system( string(cmd), 1 );
-	continue;
+      array( pids, w, pid_t ) = pid;
+    }
+    for (w = 0; w < numWorkers; w++) {
+      if( waitpid( arru( pids, w, pid_t ), &status, 0 ) < 0 || !WIFEXITED( status ) || WEXITSTATUS( status ) != 0 ) {
+        die ("The worker %d failed", w);
       }
-      // writing the gfrEntry, if everthing else didn't stop 
-      if( homologousCount > 0 ) updateStats( currGE );
-      puts (gfr_writeGfrEntry (currGE));
+    }
+    for (w = 0; w < numWorkers; w++) {
+      readWorkerResults( arru( results, w, MemFile* ), outputs );
+      subprocess_destroyMemFile( arru( results, w, MemFile* ) );
+    }
+    arrayDestroy( results );
+    arrayDestroy( pids );
+  }
+
+  // the output follows the order of the input
+  for (i = 0; i < arrayMax (outputs); i++) {
+    if( arru( outputs, i, char* ) ) {
+      puts( arru( outputs, i, char* ) );
+      hlr_free( arru( outputs, i, char* ) );
       count++;
-      // removing temporary files
-      stringPrintf (cmd,"cd %s;rm -rf %s_reads*.fa %s_reads?.collapsed.fa %s_transcript?.fa  %s.smallhomology.psl", confp_get(conf, "TMP_DIR"), currGE->id,currGE->id,currGE->id,currGE->id);
-      hlr_system( string(cmd) , 1);      
     } else {
       countRemoved++;
     }
-    
   }
 
   gfr_deInit ();
+  gfrCache_deInit ();
+  alignmentCache_close (alignmentCache);
+  twoBit_close (twoBit);
+  if( gfServerPort >= 0 ) {
+    gfServerClient_release( gfServerPort );
+  }
 
-  stringDestroy (fnSequencesToAlign);
+  arrayDestroy (outputs);
+  arrayDestroy (pending);
   stringDestroy (cmd);
   stringDestroy (buffer);
   warn ("%s_numRemoved: %d",argv[0],countRemoved);  
   warn ("%s_numGfrEntries: %d",argv[0],count);
 
-  confp_close(conf);
+  conf_deInit ();
 
   return EXIT_SUCCESS;
 }
-
-
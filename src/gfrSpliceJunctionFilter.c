@@ -4,7 +4,6 @@
 #include <sys/types.h>
 #include <time.h>
 
-#include <bios/confp.h>
 #include <bios/log.h>
 #include <bios/format.h>
 #include <bios/bowtieParser.h>
@@ -12,8 +11,16 @@
 #include <bios/intervalFind.h>
 #include <bios/blatParser.h>
 
+#include "conf.h"
 #include "gfr.h"
 #include "util.h"
+#include "metrics.h"
+#include "alignmentCache.h"
+#include "subprocess.h"
+#include "kmerIndex.h"
+#include "uthash.h"
+
+#define SPLICE_JUNCTION_MIN_SCORE 30 // the default minScore of blat
 
 int sortGfrById( GfrEntry* a, GfrEntry* b) {
   return strcmp( a->id, b->id);
@@ -23,29 +30,102 @@ int sortGfrByDASPER( GfrEntry* a, GfrEntry* b) {
   return (int) ( b->DASPER*1e06 - a->DASPER*1e06);
 }
 
+typedef struct {
+  int entryIndex;
+  int readNum;
+  int next; // next PendingRead with the same read, -1 if none
+} PendingRead;
+
+/// a read aligned once for all its occurrences in the candidates
+typedef struct {
+  char *read;
+  char *targetNames; // NULL until aligned
+  int firstPending; // first PendingRead waiting for the alignment, -1 if none
+  UT_hash_handle hh;
+} UniqueRead;
+
+/// number of the hits of a read, in the splice junction library, that are proper splice junctions of the other transcript
+static int countSpliceJunctionHits( GfrEntry* currGE, int readNum, char* targetNames ) {
+  int j, numHits=0;
+  if( strEqual( targetNames, "-" ) ) 
+    return 0;
+  Texta targets = textFieldtokP( targetNames, "," );
+  for( j=0; j<arrayMax( targets ); j++ ) {
+    Texta readPos = textFieldtokP( textItem( targets, j ), "|");
+    if( readNum == 1 ) { // found hit for read1 
+      if( strEqual( currGE->chromosomeTranscript2, textItem( readPos, 0 )) && 
+	  currGE->startTranscript2 <= atoi(  textItem( readPos, 1 )) &&
+	  currGE->endTranscript2 >= atoi( textItem( readPos, 2 )) ) { //found a proper hit in the splice junction
+	numHits++;
+      }
+    }
+    if( readNum == 2 ) {// found hit for read2
+      if( strEqual( currGE->chromosomeTranscript1, textItem( readPos, 0 )) && 
+	  currGE->startTranscript1 <= atoi( textItem(readPos, 1 )) &&
+	  currGE->endTranscript1 >= atoi(textItem( readPos, 2 )) ) { //found a proper hit in the splice junction
+	numHits++;
+      }
+    }      
+    textDestroy( readPos);
+  }
+  textDestroy( targets );
+  return numHits;
+}
+
+static void checkSpliceJunctionHits( GfrEntry* currGE, int readNum, char* targetNames, double maxFractionSplices, int* toRemove ) {
+  if (countSpliceJunctionHits( currGE, readNum, targetNames ) > arrayMax( currGE->interReads ) * maxFractionSplices)  {
+    *toRemove = 1;
+  }
+}
+
+/// names of the splice junctions hit by a read, comma-separated as in the blat output, "-" if none
+static char* getSpliceJunctionTargets( KmerIndex* index, char* read, Array targets, Stringa targetNames ) {
+  int j;
+  stringClear( targetNames );
+  kmerIndex_getTargets( index, read, SPLICE_JUNCTION_MIN_SCORE, targets );
+  for( j=0; j<arrayMax( targets ); j++ ) {
+    stringAppendf( targetNames, "%s%s", j > 0 ? "," : "", kmerIndex_getSequenceName( index, arru( targets, j, int ) ) );
+  }
+  if( arrayMax( targets ) == 0 ) 
+    stringCpy( targetNames, "-" );
+  return string( targetNames );
+}
+
+static int hasSuffix( char* s, char* suffix ) {
+  int length = strlen( s ), suffixLength = strlen( suffix );
+  return length >= suffixLength && strEqual( s + length - suffixLength, suffix );
+}
+
 int main (int argc, char *argv[])
 {
   GfrEntry *currGE;
-  int i,j,l;
-  Stringa cmd;
+  int i,j,l,k;
+  Stringa cmd, targetNames;
   FILE *freads;
-  Array gfrEntries;
+  MemFile *readsFA;
+  Array gfrEntries, keptEntries;
+  Array toRemove;
   int count;
   int countRemoved;
+  Array pendingReads;
+  PendingRead *currPR;
+  Array blatReads;
+  UniqueRead *uniqueReads, *currUR, *tmp;
   int readSize1,readSize2;
   BlatQuery *blQ = NULL;
-  config *conf;
+  AlignmentCache *alignmentCache;
+  KmerIndex *index = NULL;
+  Array targets = NULL;
+  Conf *conf;
 
-  if ((conf = confp_open(getenv("FUSIONSEQ_CONFPATH"))) == NULL)
-	  return EXIT_FAILURE;
+  conf = conf_init (argv[0], "MAX_FRACTION_SPLICES", NULL);
   
   if( argc != 2 ) {
-    usage("%s <splice_junction_library>\nNB: the splice junction library should be in 2bit format.\nEx: %s ucsc_nh_sj75.2bit", argv[0], argv[0]);
+    usage("%s <splice_junction_library>\nNB: the splice junction library should be in 2bit format, aligned with blat, or a k-mer index built by twoBit2kmerIndex, matched in process.\nEx: %s ucsc_nh_sj75.2bit\nEx: %s ucsc_nh_sj75.kmerIndex", argv[0], argv[0], argv[0]);
   }
   char* spliceJunctionLibrary = argv[1];
 
   gfr_init ("-");
-  gfrEntries = arrayCreate( 100, GfrEntry );
   gfrEntries =  gfr_parse ();
   if (arrayMax (gfrEntries) == 0){
     puts (gfr_writeHeader ());
@@ -53,20 +133,29 @@ int main (int argc, char *argv[])
     return 0;
   }
 
-  // creating the fasta files with the reads 
-  Stringa readsFA = stringCreate( 100 ); 
- 
-  stringPrintf( readsFA, "%d_reads.fa", (int) getpid());
-  freads = fopen ( string(readsFA) ,"w");
-  if (freads == NULL) {
-    die ("Unable to open file: %s",string (readsFA));
-  }     
+  // with a prebuilt index the reads are matched in process, otherwise they are written in an in-memory fasta file for blat
+  if( hasSuffix( spliceJunctionLibrary, ".kmerIndex" ) ) {
+    index = kmerIndex_open( spliceJunctionLibrary );
+    targets = arrayCreate( 10, int );
+    readsFA = NULL;
+    freads = NULL;
+  } else {
+    readsFA = subprocess_createMemFile( "reads.fa" );
+    freads = subprocess_getStream( readsFA );
+  }
   cmd = stringCreate (100);
-  puts (gfr_writeHeader ());
+  targetNames = stringCreate (100);
+  toRemove = arrayCreate( arrayMax( gfrEntries ), int );
   count = 0;
   countRemoved = 0;
+  pendingReads = arrayCreate( 1000, PendingRead );
+  blatReads = arrayCreate( 1000, UniqueRead* );
+  uniqueReads = NULL;
+  // the hits of the reads already aligned against this library are taken from the alignment cache
+  alignmentCache = alignmentCache_open( spliceJunctionLibrary, index ? "kmerIndex" : "blat -t=dna" );
   for (i = 0; i < arrayMax (gfrEntries); i++) {
     currGE = arrp (gfrEntries,i,GfrEntry);  
+    array( toRemove, i, int ) = 0;
     if (strEqual( currGE->fusionType, "read-through")) {
       continue;
     }
@@ -77,102 +166,114 @@ int main (int argc, char *argv[])
           arrayMax(currGE->readsTranscript2));
     // writing the reads into file
     for (l = 0; l < arrayMax (currGE->readsTranscript1); l++) {      
-      char* currRead1 = hlr_strdup( textItem (currGE->readsTranscript1,l)); // read1
-      char* currRead2 = hlr_strdup( textItem (currGE->readsTranscript2,l)); // read2
-      fprintf( freads, ">%s_1_%d\n%s\n>%s_2_%d\n%s\n", currGE->id, l+1, currRead1, currGE->id, l+1, currRead2 );
+      char* currRead1 = textItem (currGE->readsTranscript1,l); // read1
+      char* currRead2 = textItem (currGE->readsTranscript2,l); // read2
       readSize1 = strlen( currRead1 );
       readSize2 = strlen( currRead2 );
       if(readSize1 != readSize2 ) die("The two reads have different lengths: 1:%d vs 2:%d", readSize1, readSize2);
-      hlr_free( currRead1 );
-      hlr_free( currRead2 );
+      for( k=1; k<=2; k++ ) {
+	char* currRead = k == 1 ? currRead1 : currRead2;
+	// a read shared by several candidates is looked up and aligned once
+	HASH_FIND_STR( uniqueReads, currRead, currUR );
+	if( currUR == NULL ) {
+	  AllocVar( currUR );
+	  currUR->read = currRead;
+	  currUR->firstPending = -1;
+	  HASH_ADD_KEYPTR( hh, uniqueReads, currUR->read, strlen( currUR->read ), currUR );
+	  char* value = alignmentCache_get( alignmentCache, currRead, NULL );
+	  if( value ) {
+	    currUR->targetNames = hlr_strdup( value );
+	  } else if( index ) {
+	    currUR->targetNames = hlr_strdup( getSpliceJunctionTargets( index, currRead, targets, targetNames ) );
+	    alignmentCache_put( alignmentCache, currRead, NULL, currUR->targetNames );
+	  } else {
+	    fprintf( freads, ">%d\n%s\n", arrayMax( blatReads ), currRead );
+	    array( blatReads, arrayMax( blatReads ), UniqueRead* ) = currUR;
+	  }
+	}
+	if( currUR->targetNames ) {
+	  checkSpliceJunctionHits( currGE, k, currUR->targetNames, conf->maxFractionSplices, arrp( toRemove, i, int ) );
+	} else {
+	  currPR = arrayp( pendingReads, arrayMax( pendingReads ), PendingRead );
+	  currPR->entryIndex = i;
+	  currPR->readNum = k;
+	  currPR->next = currUR->firstPending;
+	  currUR->firstPending = arrayMax( pendingReads ) - 1;
+	}
+      }
     }
   }
-  fclose( freads ); 
-  freads=NULL;
   
   
   //blat of reads against the splice junction library
-  stringPrintf( cmd, "blat -t=dna %s %s stdout", spliceJunctionLibrary, string (readsFA) );
-  
-  arraySort(gfrEntries, (ARRAYORDERF) sortGfrById);
-  blatParser_initFromPipe(string(cmd));
-  Texta toRemove = textCreate( 10 );
-  while (blQ = blatParser_nextQuery()) {
-    Texta tok  = textFieldtokP( blQ->qName, "_");
-    Stringa readID = stringCreate( 20 );
-    for (i = 0; i < (arrayMax(tok)-2); i++) {
-      stringAppendf( readID, "%s%s", textItem( tok, i), i < (arrayMax(tok)-3) ? "_" : "" );
-    }
-    while(  l<arrayMax( toRemove) ) {
-      if( strEqual( string(readID), textItem( toRemove, l ) ) ) 
-	break;
-      l++;
+  if( arrayMax( blatReads ) > 0 ) {
+    stringPrintf( cmd, "blat -t=dna %s %s stdout", spliceJunctionLibrary, subprocess_getPath( readsFA ) );
+    metrics_startSubprocess();
+    blatParser_initFromPipe(string(cmd));
+    while (blQ = blatParser_nextQuery()) {
+      if( sscanf( blQ->qName, "%d", &k ) != 1 || k < 0 || k >= arrayMax( blatReads ) ) 
+	die( "Not a valid read name in the blat output: %s", blQ->qName );
+      currUR = arru( blatReads, k, UniqueRead* );
+      stringClear( targetNames );
+      for( j=0; j<arrayMax( blQ->entries ); j++ ) {
+	PslEntry *currE = arrp( blQ->entries, j, PslEntry );           
+	stringAppendf( targetNames, "%s%s", j > 0 ? "," : "", currE->tName );
+      }
+      if( arrayMax( blQ->entries ) == 0 ) 
+	stringCpy( targetNames, "-" );
+      currUR->targetNames = hlr_strdup( string(targetNames) );
     }
-    if( l<arrayMax( toRemove ) )
-      continue;
-
-    GfrEntry* gfrTest;
-    AllocVar( gfrTest );    
-    gfrTest->id = hlr_strdup( string(readID) );
-    int index=-1;
-    arrayFind( gfrEntries, gfrTest, &index, (ARRAYORDERF) sortGfrById);          
-    GfrEntry* currGE = arrp( gfrEntries, index, GfrEntry );
-    int numHits=0;
-    for( j=0; j<arrayMax( blQ->entries ); j++ ) {
-      PslEntry *currE = arrp( blQ->entries, j, PslEntry );           
-      Texta readPos = textFieldtokP( currE->tName, "|");
-      int readNum = atoi( textItem( tok, arrayMax(tok)-2 ) );
-      if( readNum == 1 ) { // found hit for read1 
-	if( strEqual( currGE->chromosomeTranscript2, textItem( readPos, 0 )) && 
-	    currGE->startTranscript2 <= atoi(  textItem( readPos, 1 )) &&
-	    currGE->endTranscript2 >= atoi( textItem( readPos, 2 )) ) { //found a proper hit in the splice junction
-	  numHits++;
-	}
+    blatParser_deInit();
+    metrics_stopSubprocess();
+    // the reads without hits are not reported by blat; the result of a read is given to all its occurrences
+    for( k=0; k<arrayMax( blatReads ); k++ ) {
+      currUR = arru( blatReads, k, UniqueRead* );
+      if( currUR->targetNames == NULL ) 
+	currUR->targetNames = hlr_strdup( "-" );
+      alignmentCache_put( alignmentCache, currUR->read, NULL, currUR->targetNames );
+      for( j=currUR->firstPending; j>=0; j=currPR->next ) {
+	currPR = arrp( pendingReads, j, PendingRead );
+	currGE = arrp( gfrEntries, currPR->entryIndex, GfrEntry );
+	checkSpliceJunctionHits( currGE, currPR->readNum, currUR->targetNames, conf->maxFractionSplices, arrp( toRemove, currPR->entryIndex, int ) );
       }
-      if( readNum == 2 ) {// found hit for read2
-	if( strEqual( currGE->chromosomeTranscript1, textItem( readPos, 0 )) && 
-	    currGE->startTranscript1 <= atoi( textItem(readPos, 1 )) &&
-	    currGE->endTranscript1 >= atoi(textItem( readPos, 2 )) ) { //found a proper hit in the splice junction
-	  numHits++;
-	}
-      }      
-      textDestroy( readPos);
-    }    
-    if (numHits > arrayMax( currGE->interReads ) * strtod(confp_get(conf, "MAX_FRACTION_SPLICES"), NULL))  {
-      textAdd( toRemove, currGE->id);
     }
-    
-    hlr_free( gfrTest->id );
-    freeMem( gfrTest );
-    textDestroy( tok ); 
-    stringDestroy( readID );
   }
-  blatParser_deInit();
-  arraySort( toRemove, (ARRAYORDERF) arrayStrcmp );
-  arraySort( gfrEntries, (ARRAYORDERF) sortGfrByDASPER );
+  HASH_ITER( hh, uniqueReads, currUR, tmp ) {
+    HASH_DEL( uniqueReads, currUR );
+    hlr_free( currUR->targetNames );
+    freeMem( currUR );
+  }
+  arrayDestroy( blatReads );
+  alignmentCache_close( alignmentCache );
+  kmerIndex_destroy( index );
+
+  keptEntries = arrayCreate( arrayMax( gfrEntries ), GfrEntry );
   for (i = 0; i < arrayMax(gfrEntries); i++) {
-    GfrEntry *currGE = arrp( gfrEntries, i, GfrEntry);
-    if( arrayFind( toRemove, &currGE->id, NULL, (ARRAYORDERF) arrayStrcmp ) ) {
+    if( arru( toRemove, i, int ) ) {
       countRemoved++;
     } else {
-      puts( gfr_writeGfrEntry( currGE ) );
-      count++;
+      array( keptEntries, arrayMax( keptEntries ), GfrEntry ) = arru( gfrEntries, i, GfrEntry );
     }
   }
-
-  // removing temporary files
-  stringPrintf (cmd,"rm -rf %s", string(readsFA) );
-  hlr_system( string(cmd) , 0);      
+  arraySort( keptEntries, (ARRAYORDERF) sortGfrByDASPER );
+  puts (gfr_writeHeader ());
+  for (i = 0; i < arrayMax(keptEntries); i++) {
+    puts( gfr_writeGfrEntry( arrp( keptEntries, i, GfrEntry ) ) );
+    count++;
+  }
 
   gfr_deInit ();
+  arrayDestroy ( keptEntries );
   arrayDestroy ( gfrEntries );
   arrayDestroy ( toRemove );
+  arrayDestroy ( pendingReads );
+  if( targets ) arrayDestroy( targets );
   stringDestroy( cmd );
-  stringDestroy( readsFA );
+  stringDestroy( targetNames );
+  subprocess_destroyMemFile( readsFA );
   warn ("%s_spliceJunctionLibrary: %s",argv[0],spliceJunctionLibrary);
   warn ("%s_numRemoved: %d",argv[0],countRemoved);  
   warn ("%s_numGfrEntries: %d",argv[0],count);
-  confp_close(conf);
+  conf_deInit ();
   return 0;
 }
-
@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <bios/log.h>
+#include <bios/format.h>
+
+#include "conf.h"
+#include "annotationPack.h"
+#include "intervalIndex.h"
+#include "kgXrefTable.h"
+#include "treeFamTable.h"
+#include "genePairSet.h"
+
+
+
+/**
+   @file interval2annotationPack.c
+   @brief Compile annotation tracks in interval format into one annotation pack, shared by all the processes of a node.
+   @details Each track is compiled as by interval2intervalIndex (a compiled index is added as is) and stored in the pack under the real path of the file. Set ANNOTATION_PACK_FILENAME (in ANNOTATION_DIR) to the pack: intervalIndex_open() then maps the track from the pack, and the page cache holds one copy of the tables for all the samples running on the node. A track that changes after the pack is written is read from its file again. Without interval files, the tables of .fusionseqrc are packed: the composite model, kgXref (see kgXrefTable.h), TreeFam (see treeFamTable.h), the black list (see genePairSet.h), RepeatMasker and the pseudogenes. The tracks given as arguments of the tools, e.g. the ESTs of gfrESTFilter, are added as interval files, and the gene pair lists, e.g. a white list compiled by genePairs2genePairSet, after -p; these tools read the pack when .fusionseqrc sets it. The file is only valid on machines with the same byte order.
+   @pre Interval files, or a valid .fusionseqrc.
+   @remarks Ex: interval2annotationPack annotation.pack knownGeneAnnotationTranscriptCompositeModel.txt rmsk.interval pseudogenes.interval EST.interval -p whiteList.genePairSet
+ */
+
+
+
+static void addSection (Array sections, char *fileName, void* (*compile) (char*, size_t*))
+{
+  AnnotationPackSection *currSection;
+
+  currSection = arrayp (sections,arrayMax (sections),AnnotationPackSection);
+  currSection->fileName = hlr_strdup (fileName);
+  currSection->data = compile (fileName,&currSection->size);
+}
+
+
+
+int main (int argc, char *argv[])
+{
+  Conf *conf;
+  Array sections;
+  AnnotationPackSection *currSection;
+  int i,isGenePairs;
+
+  if (argc < 2) {
+    usage ("%s <file.pack> [file.interval ...] [-p genePairs.txt ...]",argv[0]);
+  }
+  sections = arrayCreate (10,AnnotationPackSection);
+  if (argc == 2) {
+    conf = conf_init (argv[0],"ANNOTATION_DIR","TRANSCRIPT_COMPOSITE_MODEL_FILENAME",NULL);
+    addSection (sections,conf_getPath (conf->annotationDir,conf->transcriptCompositeModelFilename),intervalIndex_compileInMemory);
+    if (conf->knownGeneXrefFilename != NULL) {
+      addSection (sections,conf_getPath (conf->annotationDir,conf->knownGeneXrefFilename),kgXrefTable_compileInMemory);
+    }
+    if (conf->knownGeneTreeFamFilename != NULL) {
+      addSection (sections,conf_getPath (conf->annotationDir,conf->knownGeneTreeFamFilename),treeFamTable_compileInMemory);
+    }
+    if (conf->blacklistFilename != NULL) {
+      addSection (sections,conf_getPath (conf->annotationDir,conf->blacklistFilename),genePairSet_compileInMemory);
+    }
+    if (conf->repeatMaskerDir != NULL && conf->repeatMaskerFilename != NULL) {
+      addSection (sections,conf_getPath (conf->repeatMaskerDir,conf->repeatMaskerFilename),intervalIndex_compileInMemory);
+    }
+    if (conf->pseudogeneDir != NULL && conf->pseudogeneFilename != NULL) {
+      addSection (sections,conf_getPath (conf->pseudogeneDir,conf->pseudogeneFilename),intervalIndex_compileInMemory);
+    }
+  }
+  isGenePairs = 0;
+  for (i = 2; i < argc; i++) {
+    if (strEqual (argv[i],"-p")) {
+      isGenePairs = 1;
+      continue;
+    }
+    addSection (sections,argv[i],isGenePairs ? genePairSet_compileInMemory : intervalIndex_compileInMemory);
+  }
+  annotationPack_write (argv[1],sections);
+  for (i = 0; i < arrayMax (sections); i++) {
+    currSection = arrp (sections,i,AnnotationPackSection);
+    hlr_free (currSection->fileName);
+    hlr_free (currSection->data);
+  }
+  arrayDestroy (sections);
+  warn ("%s_pack: %s",argv[0],argv[1]);
+  return 0;
+}
@@ -0,0 +1,39 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <bios/log.h>
+#include <bios/format.h>
+
+#include "coverageMap.h"
+
+
+
+/**
+   @file interval2coverageMap.c
+   @brief Compile an annotation track in interval format into a coverage map, one bit per base, e.g. of the repeat-masked bases.
+   @details The map is mapped in memory (mmap) by coverageMap_open(). Set REPEATMASKER_COVERAGE_FILENAME to the map of the RepeatMasker annotation to let gfrRepeatMaskerFilter count the repeat bases of the reads with a popcount instead of an interval search. If the output file is not given, the map is written to file.interval.coverageMap. The file is only valid on machines with the same byte order.
+   @pre An interval file.
+   @remarks Ex: interval2coverageMap rmsk.interval rmsk.coverageMap
+ */
+
+
+
+int main (int argc, char *argv[])
+{
+  Stringa mapFileName;
+
+  if (argc != 2 && argc != 3) {
+    usage ("%s <file.interval> [file.coverageMap]",argv[0]);
+  }
+  mapFileName = stringCreate (100);
+  if (argc == 3) {
+    stringPrintf (mapFileName,"%s",argv[2]);
+  }
+  else {
+    stringPrintf (mapFileName,"%s.coverageMap",argv[1]);
+  }
+  coverageMap_compile (argv[1],string (mapFileName));
+  warn ("%s_map: %s",argv[0],string (mapFileName));
+  stringDestroy (mapFileName);
+  return 0;
+}
@@ -0,0 +1,39 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <bios/log.h>
+#include <bios/format.h>
+
+#include "intervalIndex.h"
+
+
+
+/**
+   @file interval2intervalIndex.c
+   @brief Compile an annotation track in interval format into a binary index.
+   @details The index is mapped in memory (mmap) by intervalIndex_open(), so the tools using the track (gfrRepeatMaskerFilter, gfrPseudogenesFilter, gfrSmallScaleHomologyFilter, gfrClassify, geneFusions) do not need to parse and sort it at every run. By default the index is written next to the interval file, as file.interval.index, where intervalIndex_open() looks for it; it is used as long as it is at least as recent as the interval file. The file is only valid on machines with the same byte order.
+   @pre An annotation track in interval format.
+   @remarks Ex: interval2intervalIndex hg18_repeatMasker.interval
+ */
+
+
+
+int main (int argc, char *argv[])
+{
+  Stringa indexFile;
+
+  if (argc != 2 && argc != 3) {
+    usage ("%s <file.interval> [<file.interval.index>]",argv[0]);
+  }
+  indexFile = stringCreate (100);
+  if (argc == 3) {
+    stringPrintf (indexFile,"%s",argv[2]);
+  }
+  else {
+    stringPrintf (indexFile,"%s.index",argv[1]);
+  }
+  intervalIndex_compile (argv[1],string (indexFile));
+  warn ("%s_index: %s",argv[0],string (indexFile));
+  stringDestroy (indexFile);
+  return 0;
+}
@@ -0,0 +1,550 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <bios/log.h>
+#include <bios/format.h>
+#include <bios/intervalFind.h>
+
+#include "annotationPack.h"
+#include "intervalIndex.h"
+
+
+
+#define INTERVAL_INDEX_MAGIC "FSIVIDX1"
+
+
+
+/**
+   Header of an index, followed by the chromosomes, the intervals, the sub-intervals and the names, each section padded to 8 bytes.
+*/
+typedef struct {
+  char magic[8];
+  uint32_t numChromosomes;
+  uint32_t numIntervals;
+  uint32_t numSubIntervals;
+  uint32_t namesSize;
+} IndexHeader;
+
+
+
+typedef struct {
+  uint32_t name; // offset in the names
+  uint32_t firstInterval;
+  uint32_t numIntervals;
+  uint32_t reserved;
+} IndexChromosome;
+
+
+
+typedef struct {
+  int32_t start;
+  int32_t end;
+  int32_t maxEnd; // maximum end of the intervals of the chromosome up to this one
+  uint32_t name;
+  uint32_t firstSubInterval;
+  uint32_t numSubIntervals;
+  char strand;
+  char reserved[3];
+} IndexInterval;
+
+
+
+typedef struct {
+  int32_t start;
+  int32_t end;
+} IndexSubInterval;
+
+
+
+struct _intervalIndex {
+  unsigned char *data;
+  size_t dataSize;
+  int isMapped;
+  int isBorrowed; // section of the annotation pack
+  IndexHeader *header;
+  IndexChromosome *chromosomes; // sorted by name
+  IndexInterval *intervals; // sorted by chromosome and start
+  IndexSubInterval *subIntervals;
+  char *names;
+  int source;
+  Interval **cache; // the Interval of each index interval, created by the first query returning it
+  Array result;
+  Array sweepQueries; // Array of IntervalQuery*, sorted by chromosome and start
+  Array activeIntervals; // Array of int, intervals of the chromosome that may overlap the next queries
+};
+
+
+
+static size_t intervalIndex_pad (size_t size)
+{
+  return (size + 7) & ~(size_t)7;
+}
+
+
+
+static size_t intervalIndex_getSize (IndexHeader *header)
+{
+  return intervalIndex_pad (sizeof (IndexHeader)) +
+    intervalIndex_pad ((size_t)header->numChromosomes * sizeof (IndexChromosome)) +
+    intervalIndex_pad ((size_t)header->numIntervals * sizeof (IndexInterval)) +
+    intervalIndex_pad ((size_t)header->numSubIntervals * sizeof (IndexSubInterval)) +
+    intervalIndex_pad (header->namesSize);
+}
+
+
+
+static void intervalIndex_setSections (IntervalIndex *index)
+{
+  unsigned char *pos;
+
+  index->header = (IndexHeader*)index->data;
+  pos = index->data + intervalIndex_pad (sizeof (IndexHeader));
+  index->chromosomes = (IndexChromosome*)pos;
+  pos += intervalIndex_pad ((size_t)index->header->numChromosomes * sizeof (IndexChromosome));
+  index->intervals = (IndexInterval*)pos;
+  pos += intervalIndex_pad ((size_t)index->header->numIntervals * sizeof (IndexInterval));
+  index->subIntervals = (IndexSubInterval*)pos;
+  pos += intervalIndex_pad ((size_t)index->header->numSubIntervals * sizeof (IndexSubInterval));
+  index->names = (char*)pos;
+}
+
+
+
+static int sortIntervalsByChromosomeAndStart (Interval *a, Interval *b)
+{
+  int diff;
+
+  diff = strcmp (a->chromosome,b->chromosome);
+  if (diff != 0) {
+    return diff;
+  }
+  if (a->start != b->start) {
+    return a->start < b->start ? -1 : 1;
+  }
+  return a->end < b->end ? -1 : a->end > b->end;
+}
+
+
+
+static uint32_t intervalIndex_addName (IntervalIndex *index, char *name)
+{
+  uint32_t offset;
+
+  offset = index->header->namesSize;
+  strcpy (index->names + offset,name);
+  index->header->namesSize += strlen (name) + 1;
+  return offset;
+}
+
+
+
+static void intervalIndex_build (IntervalIndex *index, char *intervalFile)
+{
+  IndexHeader header;
+  IndexChromosome *currChromosome;
+  IndexInterval *currIndexInterval;
+  IndexSubInterval *currIndexSubInterval;
+  Interval *currInterval;
+  SubInterval *currSubInterval;
+  Array intervals;
+  int i,j;
+
+  intervals = intervalFind_parseFile (intervalFile,index->source);
+  arraySort (intervals,(ARRAYORDERF)sortIntervalsByChromosomeAndStart);
+  memset (&header,0,sizeof (header));
+  memcpy (header.magic,INTERVAL_INDEX_MAGIC,sizeof (header.magic));
+  for (i = 0; i < arrayMax (intervals); i++) {
+    currInterval = arrp (intervals,i,Interval);
+    if (i == 0 || !strEqual (currInterval->chromosome,arrp (intervals,i - 1,Interval)->chromosome)) {
+      header.numChromosomes++;
+      header.namesSize += strlen (currInterval->chromosome) + 1;
+    }
+    header.numSubIntervals += arrayMax (currInterval->subIntervals);
+    header.namesSize += strlen (currInterval->name) + 1;
+  }
+  header.numIntervals = arrayMax (intervals);
+  index->dataSize = intervalIndex_getSize (&header);
+  index->data = (unsigned char*)hlr_calloc (index->dataSize,1);
+  memcpy (index->data,&header,sizeof (header));
+  intervalIndex_setSections (index);
+  index->header->numChromosomes = 0;
+  index->header->numSubIntervals = 0;
+  index->header->namesSize = 0;
+  currChromosome = NULL;
+  for (i = 0; i < arrayMax (intervals); i++) {
+    currInterval = arrp (intervals,i,Interval);
+    if (i == 0 || !strEqual (currInterval->chromosome,arrp (intervals,i - 1,Interval)->chromosome)) {
+      currChromosome = index->chromosomes + index->header->numChromosomes++;
+      currChromosome->name = intervalIndex_addName (index,currInterval->chromosome);
+      currChromosome->firstInterval = i;
+    }
+    currChromosome->numIntervals++;
+    currIndexInterval = index->intervals + i;
+    currIndexInterval->start = currInterval->start;
+    currIndexInterval->end = currInterval->end;
+    currIndexInterval->maxEnd = currChromosome->numIntervals > 1 && (currIndexInterval - 1)->maxEnd > currInterval->end ? (currIndexInterval - 1)->maxEnd : currInterval->end;
+    currIndexInterval->name = intervalIndex_addName (index,currInterval->name);
+    currIndexInterval->strand = currInterval->strand;
+    currIndexInterval->firstSubInterval = index->header->numSubIntervals;
+    currIndexInterval->numSubIntervals = arrayMax (currInterval->subIntervals);
+    for (j = 0; j < arrayMax (currInterval->subIntervals); j++) {
+      currSubInterval = arrp (currInterval->subIntervals,j,SubInterval);
+      currIndexSubInterval = index->subIntervals + index->header->numSubIntervals++;
+      currIndexSubInterval->start = currSubInterval->start;
+      currIndexSubInterval->end = currSubInterval->end;
+    }
+  }
+  // the chromosomes are already sorted by name, as the intervals; the names of the parsed intervals may be shared by intervalFind and are not freed
+  for (i = 0; i < arrayMax (intervals); i++) {
+    arrayDestroy (arrp (intervals,i,Interval)->subIntervals);
+  }
+  arrayDestroy (intervals);
+}
+
+
+
+static int intervalIndex_isCompiled (char *fileName)
+{
+  char magic[8];
+  FILE *fp;
+  int isCompiled;
+
+  if ((fp = fopen (fileName,"r")) == NULL) {
+    die ("Unable to open file: %s",fileName);
+  }
+  isCompiled = fread (magic,1,sizeof (magic),fp) == sizeof (magic) && memcmp (magic,INTERVAL_INDEX_MAGIC,sizeof (magic)) == 0;
+  fclose (fp);
+  return isCompiled;
+}
+
+
+
+static void intervalIndex_check (IntervalIndex *index, char *fileName)
+{
+  if (index->dataSize < sizeof (IndexHeader) || memcmp (index->data,INTERVAL_INDEX_MAGIC,8) != 0 || intervalIndex_getSize ((IndexHeader*)index->data) != index->dataSize) {
+    die ("Not a valid interval index: %s",fileName);
+  }
+  intervalIndex_setSections (index);
+}
+
+
+
+static void intervalIndex_map (IntervalIndex *index, char *fileName)
+{
+  struct stat info;
+  int fd;
+
+  if ((fd = open (fileName,O_RDONLY)) < 0 || fstat (fd,&info) != 0) {
+    die ("Unable to open the interval index: %s",fileName);
+  }
+  index->dataSize = info.st_size;
+  if (index->dataSize < sizeof (IndexHeader)) {
+    die ("Not a valid interval index: %s",fileName);
+  }
+  index->data = (unsigned char*)mmap (NULL,index->dataSize,PROT_READ,MAP_SHARED,fd,0);
+  close (fd);
+  if (index->data == MAP_FAILED) {
+    die ("Unable to map the interval index: %s",fileName);
+  }
+  index->isMapped = 1;
+  intervalIndex_check (index,fileName);
+}
+
+
+
+void* intervalIndex_compileInMemory (char *fileName, size_t *size)
+{
+  IntervalIndex index;
+  unsigned char *data;
+
+  memset (&index,0,sizeof (index));
+  if (!intervalIndex_isCompiled (fileName)) {
+    intervalIndex_build (&index,fileName);
+    *size = index.dataSize;
+    return index.data;
+  }
+  intervalIndex_map (&index,fileName);
+  data = (unsigned char*)hlr_malloc (index.dataSize);
+  memcpy (data,index.data,index.dataSize);
+  munmap (index.data,index.dataSize);
+  *size = index.dataSize;
+  return data;
+}
+
+
+
+void intervalIndex_compile (char *intervalFile, char *indexFile)
+{
+  IntervalIndex index;
+  Stringa tmpFileName;
+  FILE *fp;
+
+  memset (&index,0,sizeof (index));
+  intervalIndex_build (&index,intervalFile);
+  // the index appears under its name only when it is complete
+  tmpFileName = stringCreate (100);
+  stringPrintf (tmpFileName,"%s.tmp",indexFile);
+  if ((fp = fopen (string (tmpFileName),"wb")) == NULL) {
+    die ("Unable to open file: %s",string (tmpFileName));
+  }
+  if (fwrite (index.data,1,index.dataSize,fp) != index.dataSize || fclose (fp) != 0 || rename (string (tmpFileName),indexFile) != 0) {
+    die ("Unable to write the interval index: %s",indexFile);
+  }
+  stringDestroy (tmpFileName);
+  hlr_free (index.data);
+}
+
+
+
+IntervalIndex* intervalIndex_open (char *fileName, int source)
+{
+  IntervalIndex *index;
+  Stringa indexFileName;
+  struct stat textInfo,indexInfo;
+  size_t size;
+
+  AllocVar (index);
+  index->source = source;
+  indexFileName = stringCreate (100);
+  stringPrintf (indexFileName,"%s.index",fileName);
+  if ((index->data = (unsigned char*)annotationPack_getSection (fileName,&size)) != NULL) {
+    index->dataSize = size;
+    index->isBorrowed = 1;
+    intervalIndex_check (index,fileName);
+  }
+  else if (intervalIndex_isCompiled (fileName)) {
+    intervalIndex_map (index,fileName);
+  }
+  else if (stat (fileName,&textInfo) == 0 && stat (string (indexFileName),&indexInfo) == 0 && indexInfo.st_mtime >= textInfo.st_mtime) {
+    intervalIndex_map (index,string (indexFileName));
+  }
+  else {
+    intervalIndex_build (index,fileName);
+  }
+  stringDestroy (indexFileName);
+  index->cache = (Interval**)hlr_calloc (index->header->numIntervals + 1,sizeof (Interval*));
+  index->result = arrayCreate (100,Interval*);
+  index->sweepQueries = arrayCreate (100,IntervalQuery*);
+  index->activeIntervals = arrayCreate (100,int);
+  return index;
+}
+
+
+
+static IndexChromosome* intervalIndex_findChromosome (IntervalIndex *index, char *chromosome)
+{
+  uint32_t low,high,middle;
+  int diff;
+
+  low = 0;
+  high = index->header->numChromosomes;
+  while (low < high) {
+    middle = low + (high - low) / 2;
+    diff = strcmp (index->names + index->chromosomes[middle].name,chromosome);
+    if (diff == 0) {
+      return index->chromosomes + middle;
+    }
+    if (diff < 0) {
+      low = middle + 1;
+    }
+    else {
+      high = middle;
+    }
+  }
+  return NULL;
+}
+
+
+
+static Interval* intervalIndex_getInterval (IntervalIndex *index, IndexChromosome *currChromosome, uint32_t i)
+{
+  Interval *currInterval;
+  IndexInterval *currIndexInterval;
+  SubInterval *currSubInterval;
+  uint32_t j;
+
+  if (index->cache[i] != NULL) {
+    return index->cache[i];
+  }
+  currIndexInterval = index->intervals + i;
+  AllocVar (currInterval);
+  currInterval->source = index->source;
+  currInterval->name = index->names + currIndexInterval->name;
+  currInterval->chromosome = index->names + currChromosome->name;
+  currInterval->strand = currIndexInterval->strand;
+  currInterval->start = currIndexInterval->start;
+  currInterval->end = currIndexInterval->end;
+  currInterval->subIntervalCount = currIndexInterval->numSubIntervals;
+  currInterval->subIntervals = arrayCreate (currIndexInterval->numSubIntervals,SubInterval);
+  for (j = 0; j < currIndexInterval->numSubIntervals; j++) {
+    currSubInterval = arrayp (currInterval->subIntervals,j,SubInterval);
+    currSubInterval->start = index->subIntervals[currIndexInterval->firstSubInterval + j].start;
+    currSubInterval->end = index->subIntervals[currIndexInterval->firstSubInterval + j].end;
+  }
+  index->cache[i] = currInterval;
+  return currInterval;
+}
+
+
+
+Array intervalIndex_getOverlappingIntervals (IntervalIndex *index, char *chromosome, int start, int end)
+{
+  IndexChromosome *currChromosome;
+  IndexInterval *intervals;
+  Interval *tmp;
+  uint32_t low,high,middle;
+  int i,j;
+
+  arrayClear (index->result);
+  if ((currChromosome = intervalIndex_findChromosome (index,chromosome)) == NULL) {
+    return index->result;
+  }
+  intervals = index->intervals + currChromosome->firstInterval;
+  // the intervals starting at or before end
+  low = 0;
+  high = currChromosome->numIntervals;
+  while (low < high) {
+    middle = low + (high - low) / 2;
+    if (intervals[middle].start <= end) {
+      low = middle + 1;
+    }
+    else {
+      high = middle;
+    }
+  }
+  // walking back until no earlier interval can reach start
+  for (i = (int)low - 1; i >= 0 && intervals[i].maxEnd >= start; i--) {
+    if (intervals[i].end >= start) {
+      array (index->result,arrayMax (index->result),Interval*) = intervalIndex_getInterval (index,currChromosome,currChromosome->firstInterval + i);
+    }
+  }
+  for (i = 0, j = arrayMax (index->result) - 1; i < j; i++, j--) {
+    tmp = arru (index->result,i,Interval*);
+    arru (index->result,i,Interval*) = arru (index->result,j,Interval*);
+    arru (index->result,j,Interval*) = tmp;
+  }
+  return index->result;
+}
+
+
+
+static int sortQueryPointersByChromosomeAndStart (IntervalQuery **a, IntervalQuery **b)
+{
+  int diff;
+
+  diff = strcmp ((*a)->chromosome,(*b)->chromosome);
+  if (diff != 0) {
+    return diff;
+  }
+  return (*a)->start < (*b)->start ? -1 : (*a)->start > (*b)->start;
+}
+
+
+
+static void intervalIndex_sweepChromosome (IntervalIndex *index, IndexChromosome *currChromosome, int firstQuery, int lastQuery, IntervalSweepFunc func)
+{
+  IndexInterval *intervals;
+  IntervalQuery *currQuery;
+  uint32_t next,low,high,middle;
+  int i,j,k,a;
+
+  intervals = index->intervals + currChromosome->firstInterval;
+  arrayClear (index->activeIntervals);
+  next = 0;
+  for (i = firstQuery; i < lastQuery; i++) {
+    currQuery = arru (index->sweepQueries,i,IntervalQuery*);
+    // the intervals ending before this query cannot overlap the next ones, which start later
+    k = 0;
+    for (j = 0; j < arrayMax (index->activeIntervals); j++) {
+      a = arru (index->activeIntervals,j,int);
+      if (intervals[a].end >= currQuery->start) {
+        arru (index->activeIntervals,k++,int) = a;
+      }
+    }
+    arrayMax (index->activeIntervals) = k;
+    // jumping over the intervals that all end before this query
+    if (next < currChromosome->numIntervals && intervals[next].maxEnd < currQuery->start) {
+      low = next;
+      high = currChromosome->numIntervals;
+      while (low < high) {
+        middle = low + (high - low) / 2;
+        if (intervals[middle].maxEnd < currQuery->start) {
+          low = middle + 1;
+        }
+        else {
+          high = middle;
+        }
+      }
+      next = low;
+    }
+    while (next < currChromosome->numIntervals && intervals[next].start <= currQuery->end) {
+      if (intervals[next].end >= currQuery->start) {
+        array (index->activeIntervals,arrayMax (index->activeIntervals),int) = next;
+      }
+      next++;
+    }
+    for (j = 0; j < arrayMax (index->activeIntervals); j++) {
+      a = arru (index->activeIntervals,j,int);
+      if (intervals[a].start <= currQuery->end) {
+        func (currQuery,intervalIndex_getInterval (index,currChromosome,currChromosome->firstInterval + a));
+      }
+    }
+  }
+}
+
+
+
+void intervalIndex_sweep (IntervalIndex *index, Array queries, IntervalSweepFunc func)
+{
+  IndexChromosome *currChromosome;
+  char *chromosome;
+  int i,j;
+
+  arrayClear (index->sweepQueries);
+  for (i = 0; i < arrayMax (queries); i++) {
+    array (index->sweepQueries,i,IntervalQuery*) = arrp (queries,i,IntervalQuery);
+  }
+  arraySort (index->sweepQueries,(ARRAYORDERF)sortQueryPointersByChromosomeAndStart);
+  for (i = 0; i < arrayMax (index->sweepQueries); i = j) {
+    chromosome = arru (index->sweepQueries,i,IntervalQuery*)->chromosome;
+    for (j = i + 1; j < arrayMax (index->sweepQueries) && strEqual (arru (index->sweepQueries,j,IntervalQuery*)->chromosome,chromosome); j++) {
+    }
+    if ((currChromosome = intervalIndex_findChromosome (index,chromosome)) != NULL) {
+      intervalIndex_sweepChromosome (index,currChromosome,i,j,func);
+    }
+  }
+}
+
+
+
+void intervalIndex_close (IntervalIndex *index)
+{
+  uint32_t i;
+
+  if (index == NULL) {
+    return;
+  }
+  for (i = 0; i < index->header->numIntervals; i++) {
+    if (index->cache[i] != NULL) {
+      arrayDestroy (index->cache[i]->subIntervals);
+      freeMem (index->cache[i]);
+    }
+  }
+  hlr_free (index->cache);
+  arrayDestroy (index->result);
+  arrayDestroy (index->sweepQueries);
+  arrayDestroy (index->activeIntervals);
+  if (index->isMapped) {
+    munmap (index->data,index->dataSize);
+  }
+  else if (!index->isBorrowed) {
+    hlr_free (index->data);
+  }
+  freeMem (index);
+}
@@ -0,0 +1,55 @@
+#ifndef DEF_INTERVAL_INDEX_H
+#define DEF_INTERVAL_INDEX_H
+
+#include <bios/format.h>
+#include <bios/intervalFind.h>
+
+
+
+/**
+   @file intervalIndex.h
+   @brief Binary index of an annotation track in interval format, mapped in memory (mmap).
+   @details intervalFind_addIntervalsToSearchSpace() parses the text file, allocates every Interval and sorts them at every run. The index is compiled once by interval2intervalIndex into a pointer-free file: one table per chromosome with the intervals sorted by start, each with the running maximum of the ends, followed by the sub-intervals and the names. Opening the index only maps the file; the Interval structures are created when they are first returned by a query, and the same Interval* is returned for the same interval in later queries.
+   intervalIndex_open() of a file.interval uses its section of the annotation pack (see annotationPack.h) if there is one, then file.interval.index if it is at least as recent as the text file, otherwise it builds the same index in memory from the text file, so the tools work with or without a compiled index.
+   The overlap semantics are those of intervalFind_getOverlappingIntervals(): the coordinates are inclusive and an interval overlaps the query if start <= interval end and end >= interval start.
+ */
+
+
+
+typedef struct _intervalIndex IntervalIndex;
+
+
+
+/**
+   Query of intervalIndex_sweep().
+*/
+typedef struct {
+  char* chromosome;
+  int start;
+  int end;
+  int result; //!< free for the caller, e.g. updated by the IntervalSweepFunc
+} IntervalQuery;
+
+
+
+/** called by intervalIndex_sweep() for each interval overlapping a query. */
+typedef void (*IntervalSweepFunc) (IntervalQuery* query, Interval* interval);
+
+
+
+/** compile an interval file into an index file. @remark the integers are in the byte order of this machine. */
+extern void intervalIndex_compile (char* intervalFile, char* indexFile);
+/** @return the compiled index of an interval file, or the content of a compiled index, e.g. to be added to an annotation pack. @remark to be freed with hlr_free(). */
+extern void* intervalIndex_compileInMemory (char* fileName, size_t* size);
+/** open the index of an interval file, or a compiled index. @remark the program dies if the file cannot be read. */
+extern IntervalIndex* intervalIndex_open (char* fileName, int source /**< [in] source of the intervals, as in intervalFind_addIntervalsToSearchSpace() */);
+/** @return Array of Interval*, the intervals overlapping chromosome:start-end sorted by start. @remark the Array is reused by the next query, use arrayCopy() to keep it. */
+extern Array intervalIndex_getOverlappingIntervals (IntervalIndex* index, char* chromosome, int start, int end);
+/** find the overlaps of a batch of queries, e.g. all the read blocks of a candidate, with a sort-merge sweep: the queries are sorted by chromosome and start and swept in one pass against the sorted intervals. func is called for each pair of a query and an overlapping interval; for a query the intervals come in the order of intervalIndex_getOverlappingIntervals(). @remark the order of queries is not changed. */
+extern void intervalIndex_sweep (IntervalIndex* index, Array queries /**< [in,out] Array of IntervalQuery */, IntervalSweepFunc func);
+/** unmap the index and free the intervals returned by the queries. */
+extern void intervalIndex_close (IntervalIndex* index);
+
+
+
+#endif
@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <bios/log.h>
+#include <bios/format.h>
+
+#include "kgXrefTable.h"
+
+
+
+/**
+   @file kgXref2kgXrefTable.c
+   @brief Compile kgXref.txt into a kgXref table.
+   @details The table is mapped in memory (mmap) by kgXrefTable_open(), so gfrAddInfo accepts the compiled file as KNOWN_GENE_XREF_FILENAME and does not need to parse the text file and intern the gene symbols and descriptions at every run. The file is only valid on machines with the same byte order.
+   @pre kgXref.txt, as downloaded from the UCSC genome browser.
+   @remarks Ex: kgXref2kgXrefTable kgXref.txt kgXref.kgXrefTable
+ */
+
+
+
+int main (int argc, char *argv[])
+{
+  Stringa tmpFileName;
+  FILE *fp;
+  void *data;
+  size_t size;
+
+  if (argc != 3) {
+    usage ("%s <kgXref.txt> <kgXref.kgXrefTable>",argv[0]);
+  }
+  data = kgXrefTable_compileInMemory (argv[1],&size);
+  // the table appears under its name only when it is complete
+  tmpFileName = stringCreate (100);
+  stringPrintf (tmpFileName,"%s.tmp",argv[2]);
+  if ((fp = fopen (string (tmpFileName),"wb")) == NULL) {
+    die ("Unable to open file: %s",string (tmpFileName));
+  }
+  if (fwrite (data,1,size,fp) != size || fclose (fp) != 0 || rename (string (tmpFileName),argv[2]) != 0) {
+    die ("Unable to write the kgXref table: %s",argv[2]);
+  }
+  stringDestroy (tmpFileName);
+  hlr_free (data);
+  warn ("%s_table: %s",argv[0],argv[2]);
+  return 0;
+}
@@ -0,0 +1,330 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <bios/log.h>
+#include <bios/format.h>
+
+#include "annotationPack.h"
+#include "kgXrefTable.h"
+#include "util.h"
+#include "uthash.h"
+
+
+
+#define KG_XREF_TABLE_MAGIC "FSKGXRF1"
+
+
+
+/**
+   Header of a table, followed by the entries, the slots and the strings, each section padded to 8 bytes.
+*/
+typedef struct {
+  char magic[8];
+  uint32_t numEntries;
+  uint32_t numSlots; // power of 2
+  uint32_t stringsSize;
+  uint32_t reserved;
+} TableHeader;
+
+
+
+typedef struct {
+  uint32_t transcriptName; // offsets in the strings
+  uint32_t geneSymbol;
+  uint32_t description;
+  uint32_t length; // of the transcript name
+} TableEntry;
+
+
+
+typedef struct {
+  char *string;
+  uint32_t offset;
+  UT_hash_handle hh;
+} InternedString;
+
+
+
+struct _kgXrefTable {
+  unsigned char *data;
+  size_t dataSize;
+  int isMapped;
+  int isBorrowed; // section of the annotation pack
+  TableHeader *header;
+  TableEntry *entries;
+  uint32_t *slots; // index of the entry + 1, 0 if empty
+  char *strings;
+};
+
+
+
+static size_t kgXrefTable_pad (size_t size)
+{
+  return (size + 7) & ~(size_t)7;
+}
+
+
+
+static size_t kgXrefTable_getSize (TableHeader *header)
+{
+  return kgXrefTable_pad (sizeof (TableHeader)) +
+    kgXrefTable_pad ((size_t)header->numEntries * sizeof (TableEntry)) +
+    kgXrefTable_pad ((size_t)header->numSlots * sizeof (uint32_t)) +
+    kgXrefTable_pad (header->stringsSize);
+}
+
+
+
+static void kgXrefTable_setSections (KgXrefTable *table)
+{
+  unsigned char *pos;
+
+  table->header = (TableHeader*)table->data;
+  pos = table->data + kgXrefTable_pad (sizeof (TableHeader));
+  table->entries = (TableEntry*)pos;
+  pos += kgXrefTable_pad ((size_t)table->header->numEntries * sizeof (TableEntry));
+  table->slots = (uint32_t*)pos;
+  pos += kgXrefTable_pad ((size_t)table->header->numSlots * sizeof (uint32_t));
+  table->strings = (char*)pos;
+}
+
+
+
+static void kgXrefTable_check (KgXrefTable *table, char *fileName)
+{
+  if (table->dataSize < sizeof (TableHeader) || memcmp (table->data,KG_XREF_TABLE_MAGIC,8) != 0 || kgXrefTable_getSize ((TableHeader*)table->data) != table->dataSize) {
+    die ("Not a valid kgXref table: %s",fileName);
+  }
+  kgXrefTable_setSections (table);
+}
+
+
+
+static uint32_t kgXrefTable_hash (char *key, int length)
+{
+  uint32_t hash;
+  int i;
+
+  // FNV-1a
+  hash = 2166136261u;
+  for (i = 0; i < length; i++) {
+    hash ^= (unsigned char)key[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+
+
+static uint32_t kgXrefTable_intern (InternedString **interned, Array strings, char *string)
+{
+  InternedString *currString;
+  char *pos;
+
+  HASH_FIND_STR (*interned,string,currString);
+  if (currString == NULL) {
+    AllocVar (currString);
+    currString->string = string;
+    currString->offset = arrayMax (strings);
+    pos = string;
+    do {
+      array (strings,arrayMax (strings),char) = *pos;
+    } while (*pos++ != '\0');
+    HASH_ADD_KEYPTR (hh,*interned,currString->string,strlen (currString->string),currString);
+  }
+  return currString->offset;
+}
+
+
+
+static TableEntry* kgXrefTable_find (KgXrefTable *table, char *transcriptName, int length)
+{
+  TableEntry *currEntry;
+  uint32_t slot,mask;
+
+  mask = table->header->numSlots - 1;
+  for (slot = kgXrefTable_hash (transcriptName,length) & mask; table->slots[slot] != 0; slot = (slot + 1) & mask) {
+    currEntry = table->entries + table->slots[slot] - 1;
+    if (currEntry->length == (uint32_t)length && strncmp (table->strings + currEntry->transcriptName,transcriptName,length) == 0) {
+      return currEntry;
+    }
+  }
+  return NULL;
+}
+
+
+
+int kgXrefTable_isCompiled (char *fileName)
+{
+  char magic[8];
+  FILE *fp;
+  int isCompiled;
+
+  if ((fp = fopen (fileName,"r")) == NULL) {
+    die ("Unable to open file: %s",fileName);
+  }
+  isCompiled = fread (magic,1,sizeof (magic),fp) == sizeof (magic) && memcmp (magic,KG_XREF_TABLE_MAGIC,sizeof (magic)) == 0;
+  fclose (fp);
+  return isCompiled;
+}
+
+
+
+static void kgXrefTable_map (KgXrefTable *table, char *fileName)
+{
+  struct stat info;
+  int fd;
+
+  if ((fd = open (fileName,O_RDONLY)) < 0 || fstat (fd,&info) != 0) {
+    die ("Unable to open the kgXref table: %s",fileName);
+  }
+  table->dataSize = info.st_size;
+  table->data = (unsigned char*)mmap (NULL,table->dataSize,PROT_READ,MAP_SHARED,fd,0);
+  close (fd);
+  if (table->data == MAP_FAILED) {
+    die ("Unable to map the kgXref table: %s",fileName);
+  }
+  table->isMapped = 1;
+  kgXrefTable_check (table,fileName);
+}
+
+
+
+void* kgXrefTable_compileInMemory (char *fileName, size_t *size)
+{
+  KgXrefTable table;
+  TableHeader header;
+  TableEntry *currEntry;
+  InternedString *interned,*currString,*tmp;
+  Array kgXrefs;
+  KgXref *currKgXref;
+  Array strings;
+  unsigned char *data;
+  uint32_t slot,transcriptName;
+  int i;
+
+  if (kgXrefTable_isCompiled (fileName)) {
+    memset (&table,0,sizeof (table));
+    kgXrefTable_map (&table,fileName);
+    data = (unsigned char*)hlr_malloc (table.dataSize);
+    memcpy (data,table.data,table.dataSize);
+    munmap (table.data,table.dataSize);
+    *size = table.dataSize;
+    return data;
+  }
+  kgXrefs = util_readKnownGeneXrefs (fileName);
+  interned = NULL;
+  strings = arrayCreate (1000000,char);
+  memset (&header,0,sizeof (header));
+  memcpy (header.magic,KG_XREF_TABLE_MAGIC,sizeof (header.magic));
+  for (header.numSlots = 1; header.numSlots < 2 * (uint32_t)arrayMax (kgXrefs) + 1; header.numSlots *= 2) {
+  }
+  // all the strings are interned first, so that the size of the table is known
+  for (i = 0; i < arrayMax (kgXrefs); i++) {
+    currKgXref = arrp (kgXrefs,i,KgXref);
+    kgXrefTable_intern (&interned,strings,currKgXref->transcriptName);
+    kgXrefTable_intern (&interned,strings,currKgXref->geneSymbol);
+    kgXrefTable_intern (&interned,strings,currKgXref->refseqDescription);
+  }
+  header.stringsSize = arrayMax (strings);
+  header.numEntries = arrayMax (kgXrefs);
+  memset (&table,0,sizeof (table));
+  table.dataSize = kgXrefTable_getSize (&header);
+  table.data = (unsigned char*)hlr_calloc (table.dataSize,1);
+  memcpy (table.data,&header,sizeof (header));
+  kgXrefTable_setSections (&table);
+  memcpy (table.strings,arrp (strings,0,char),header.stringsSize);
+  for (i = 0, table.header->numEntries = 0; i < arrayMax (kgXrefs); i++) {
+    currKgXref = arrp (kgXrefs,i,KgXref);
+    // the first line of a transcript is kept
+    if (kgXrefTable_find (&table,currKgXref->transcriptName,strlen (currKgXref->transcriptName)) != NULL) {
+      continue;
+    }
+    transcriptName = kgXrefTable_intern (&interned,strings,currKgXref->transcriptName);
+    currEntry = table.entries + table.header->numEntries++;
+    currEntry->transcriptName = transcriptName;
+    currEntry->geneSymbol = kgXrefTable_intern (&interned,strings,currKgXref->geneSymbol);
+    currEntry->description = kgXrefTable_intern (&interned,strings,currKgXref->refseqDescription);
+    currEntry->length = strlen (currKgXref->transcriptName);
+    for (slot = kgXrefTable_hash (currKgXref->transcriptName,currEntry->length) & (header.numSlots - 1); table.slots[slot] != 0; slot = (slot + 1) & (header.numSlots - 1)) {
+    }
+    table.slots[slot] = table.header->numEntries;
+  }
+  table.header->numEntries = arrayMax (kgXrefs); // the entries left for the duplicated transcripts stay empty
+  HASH_ITER (hh,interned,currString,tmp) {
+    HASH_DEL (interned,currString);
+    freeMem (currString);
+  }
+  arrayDestroy (strings);
+  for (i = 0; i < arrayMax (kgXrefs); i++) {
+    currKgXref = arrp (kgXrefs,i,KgXref);
+    hlr_free (currKgXref->transcriptName);
+    hlr_free (currKgXref->swissProt);
+    hlr_free (currKgXref->uniprotId);
+    hlr_free (currKgXref->geneSymbol);
+    hlr_free (currKgXref->refseqId);
+    hlr_free (currKgXref->refseqDescription);
+  }
+  arrayDestroy (kgXrefs);
+  *size = table.dataSize;
+  return table.data;
+}
+
+
+
+KgXrefTable* kgXrefTable_open (char *fileName)
+{
+  KgXrefTable *table;
+  size_t size;
+
+  AllocVar (table);
+  if ((table->data = (unsigned char*)annotationPack_getSection (fileName,&size)) != NULL) {
+    table->dataSize = size;
+    table->isBorrowed = 1;
+    kgXrefTable_check (table,fileName);
+  }
+  else if (kgXrefTable_isCompiled (fileName)) {
+    kgXrefTable_map (table,fileName);
+  }
+  else {
+    table->data = (unsigned char*)kgXrefTable_compileInMemory (fileName,&table->dataSize);
+    kgXrefTable_check (table,fileName);
+  }
+  return table;
+}
+
+
+
+int kgXrefTable_lookup (KgXrefTable *table, char *transcriptName, int length, char **geneSymbol, char **description)
+{
+  TableEntry *currEntry;
+
+  if ((currEntry = kgXrefTable_find (table,transcriptName,length)) == NULL) {
+    return 0;
+  }
+  *geneSymbol = table->strings + currEntry->geneSymbol;
+  *description = table->strings + currEntry->description;
+  return 1;
+}
+
+
+
+void kgXrefTable_close (KgXrefTable *table)
+{
+  if (table == NULL) {
+    return;
+  }
+  if (table->isMapped) {
+    munmap (table->data,table->dataSize);
+  }
+  else if (!table->isBorrowed) {
+    hlr_free (table->data);
+  }
+  freeMem (table);
+}
@@ -0,0 +1,35 @@
+#ifndef DEF_KG_XREF_TABLE_H
+#define DEF_KG_XREF_TABLE_H
+
+#include <stddef.h>
+
+
+
+/**
+   @file kgXrefTable.h
+   @brief Hash table of kgXref.txt: transcript name to gene symbol and description.
+   @details The table is pointer-free: an open-addressing hash (linear probing) on the transcript names, pointing to entries whose strings are interned, i.e. the gene symbols and descriptions shared by the isoforms of a gene are stored once and the same string is always returned for them. The lookups return borrowed pointers into the table and do not allocate.
+   kgXrefTable_open() uses the section of the file in the annotation pack (see annotationPack.h) if there is one, maps the file if it was compiled by kgXref2kgXrefTable, otherwise it builds the same table in memory from the text file.
+ */
+
+
+
+typedef struct _kgXrefTable KgXrefTable;
+
+
+
+/** @return the compiled table of a kgXref file, or a copy of an already compiled one, e.g. to be added to an annotation pack. @remark to be freed with hlr_free(). */
+extern void* kgXrefTable_compileInMemory (char* fileName, size_t* size);
+/** @return 1 if the file is a table compiled by kgXref2kgXrefTable, 0 if it is a text file. */
+extern int kgXrefTable_isCompiled (char* fileName);
+/** open the table of a kgXref file, in text or compiled form. @remark the program dies if the file cannot be read. */
+extern KgXrefTable* kgXrefTable_open (char* fileName);
+/** look up a transcript, given by length characters of transcriptName, so that it can be a token of a longer string.
+    @return 1 if found, 0 otherwise. @remark geneSymbol and description are owned by the table; interned strings can be compared by pointer. */
+extern int kgXrefTable_lookup (KgXrefTable* table, char* transcriptName, int length, char** geneSymbol, char** description);
+/** close the table. */
+extern void kgXrefTable_close (KgXrefTable* table);
+
+
+
+#endif
@@ -0,0 +1,445 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <bios/log.h>
+#include <bios/format.h>
+
+#include "twoBit.h"
+#include "kmerIndex.h"
+
+
+
+#define KMER_SIZE 11
+#define NUM_KMERS (1 << (2 * KMER_SIZE))
+#define MAX_HITS_PER_KMER 256 // k-mers more frequent than this are not used as seeds
+#define X_DROP 8
+#define MAX_SEEDS 64 // number of extended seeds remembered to skip the hits on the same diagonal
+#define KMER_INDEX_MAGIC "FSKMIDX1"
+
+
+
+struct _kmerIndex {
+  char *reference; // all the sequences in upper case, separated by N
+  uint32_t size;
+  uint32_t *offsets; // offsets[k] .. offsets[k+1]-1 are the positions of k-mer k
+  uint32_t *positions;
+  uint32_t numSequences;
+  uint32_t *sequenceStarts; // sequence i starts at sequenceStarts[i]; sequenceStarts[numSequences] is size
+  uint32_t *nameOffsets; // name of sequence i at names + nameOffsets[i]
+  char *names;
+  uint32_t namesSize;
+  unsigned char *data; // the mapped file, NULL if the index was created in memory
+  size_t dataSize;
+};
+
+
+
+/**
+   Header of an index file, followed by the arrays of the index in the order of the struct, each padded to 8 bytes.
+   The integers are in the byte order of the machine that wrote the file.
+*/
+typedef struct {
+  char magic[8];
+  uint32_t kmerSize;
+  uint32_t size;
+  uint32_t numKmers;
+  uint32_t numSequences;
+  uint32_t namesSize;
+  uint32_t reserved;
+} KmerIndexHeader;
+
+
+
+static int kmerIndex_encode (char c)
+{
+  switch (c) {
+  case 'A': return 0;
+  case 'C': return 1;
+  case 'G': return 2;
+  case 'T': return 3;
+  }
+  return -1;
+}
+
+
+
+KmerIndex* kmerIndex_create (char *twoBitFile)
+{
+  KmerIndex *index;
+  Array sequences;
+  TwoBitSequence *currSeq;
+  uint32_t i,j,code,run,numKmers;
+  int base;
+
+  sequences = twoBit_readSequences (twoBitFile);
+  AllocVar (index);
+  index->size = 0;
+  index->namesSize = 0;
+  for (i = 0; i < arrayMax (sequences); i++) {
+    currSeq = arrp (sequences,i,TwoBitSequence);
+    index->size += currSeq->size + 1;
+    index->namesSize += strlen (currSeq->name) + 1;
+  }
+  index->numSequences = arrayMax (sequences);
+  index->reference = (char*)hlr_malloc (index->size + 1);
+  index->sequenceStarts = (uint32_t*)hlr_malloc ((index->numSequences + 1) * sizeof (uint32_t));
+  index->nameOffsets = (uint32_t*)hlr_malloc ((index->numSequences + 1) * sizeof (uint32_t));
+  index->names = (char*)hlr_malloc (index->namesSize + 1);
+  index->size = 0;
+  index->namesSize = 0;
+  for (i = 0; i < arrayMax (sequences); i++) {
+    currSeq = arrp (sequences,i,TwoBitSequence);
+    index->sequenceStarts[i] = index->size;
+    for (j = 0; j < currSeq->size; j++) {
+      index->reference[index->size++] = toupper (currSeq->sequence[j]);
+    }
+    index->reference[index->size++] = 'N';
+    index->nameOffsets[i] = index->namesSize;
+    strcpy (index->names + index->namesSize,currSeq->name);
+    index->namesSize += strlen (currSeq->name) + 1;
+  }
+  index->sequenceStarts[index->numSequences] = index->size;
+  index->reference[index->size] = '\0';
+  twoBit_freeSequences (sequences);
+
+  // counting the k-mers, then placing their positions
+  index->offsets = (uint32_t*)hlr_calloc (NUM_KMERS + 1,sizeof (uint32_t));
+  code = 0;
+  run = 0;
+  numKmers = 0;
+  for (i = 0; i < index->size; i++) {
+    if ((base = kmerIndex_encode (index->reference[i])) < 0) {
+      run = 0;
+      continue;
+    }
+    code = ((code << 2) | base) & (NUM_KMERS - 1);
+    if (++run >= KMER_SIZE) {
+      index->offsets[code + 1]++;
+      numKmers++;
+    }
+  }
+  for (i = 1; i <= NUM_KMERS; i++) {
+    index->offsets[i] += index->offsets[i - 1];
+  }
+  index->positions = (uint32_t*)hlr_malloc ((numKmers + 1) * sizeof (uint32_t));
+  code = 0;
+  run = 0;
+  for (i = 0; i < index->size; i++) {
+    if ((base = kmerIndex_encode (index->reference[i])) < 0) {
+      run = 0;
+      continue;
+    }
+    code = ((code << 2) | base) & (NUM_KMERS - 1);
+    if (++run >= KMER_SIZE) {
+      index->positions[index->offsets[code]++] = i + 1 - KMER_SIZE;
+    }
+  }
+  // offsets[k] now points to the end of k-mer k, shifting them back
+  for (i = NUM_KMERS; i > 0; i--) {
+    index->offsets[i] = index->offsets[i - 1];
+  }
+  index->offsets[0] = 0;
+  return index;
+}
+
+
+static void kmerIndex_writeSection (FILE *fp, const void *data, size_t size, char *fileName)
+{
+  static const char padding[8] = {0};
+
+  if (size > 0 && fwrite (data,1,size,fp) != size) {
+    die ("Unable to write the k-mer index: %s",fileName);
+  }
+  if (size % 8 != 0 && fwrite (padding,1,8 - size % 8,fp) != 8 - size % 8) {
+    die ("Unable to write the k-mer index: %s",fileName);
+  }
+}
+
+
+
+void kmerIndex_write (KmerIndex *index, char *fileName)
+{
+  KmerIndexHeader header;
+  Stringa tmpFileName;
+  FILE *fp;
+
+  memset (&header,0,sizeof (header));
+  memcpy (header.magic,KMER_INDEX_MAGIC,sizeof (header.magic));
+  header.kmerSize = KMER_SIZE;
+  header.size = index->size;
+  header.numKmers = index->offsets[NUM_KMERS];
+  header.numSequences = index->numSequences;
+  header.namesSize = index->namesSize;
+  // the index appears under its name only when it is complete
+  tmpFileName = stringCreate (100);
+  stringPrintf (tmpFileName,"%s.tmp",fileName);
+  if ((fp = fopen (string (tmpFileName),"wb")) == NULL) {
+    die ("Unable to open file: %s",string (tmpFileName));
+  }
+  kmerIndex_writeSection (fp,&header,sizeof (header),fileName);
+  kmerIndex_writeSection (fp,index->reference,index->size + 1,fileName);
+  kmerIndex_writeSection (fp,index->offsets,(NUM_KMERS + 1) * sizeof (uint32_t),fileName);
+  kmerIndex_writeSection (fp,index->positions,header.numKmers * sizeof (uint32_t),fileName);
+  kmerIndex_writeSection (fp,index->sequenceStarts,(index->numSequences + 1) * sizeof (uint32_t),fileName);
+  kmerIndex_writeSection (fp,index->nameOffsets,index->numSequences * sizeof (uint32_t),fileName);
+  kmerIndex_writeSection (fp,index->names,index->namesSize,fileName);
+  if (fclose (fp) != 0 || rename (string (tmpFileName),fileName) != 0) {
+    die ("Unable to write the k-mer index: %s",fileName);
+  }
+  stringDestroy (tmpFileName);
+}
+
+
+
+static void* kmerIndex_mapSection (KmerIndex *index, size_t *offset, size_t size, char *fileName)
+{
+  void *section;
+
+  if (*offset + size > index->dataSize) {
+    die ("Unexpected end of the k-mer index: %s",fileName);
+  }
+  section = index->data + *offset;
+  *offset += (size + 7) & ~(size_t)7;
+  return section;
+}
+
+
+
+KmerIndex* kmerIndex_open (char *fileName)
+{
+  KmerIndex *index;
+  KmerIndexHeader header;
+  struct stat info;
+  size_t offset;
+  int fd;
+
+  if ((fd = open (fileName,O_RDONLY)) < 0 || fstat (fd,&info) != 0) {
+    die ("Unable to open the k-mer index: %s",fileName);
+  }
+  AllocVar (index);
+  index->dataSize = info.st_size;
+  if (index->dataSize < sizeof (header)) {
+    die ("Not a valid k-mer index: %s",fileName);
+  }
+  index->data = (unsigned char*)mmap (NULL,index->dataSize,PROT_READ,MAP_SHARED,fd,0);
+  close (fd);
+  if (index->data == MAP_FAILED) {
+    die ("Unable to map the k-mer index: %s",fileName);
+  }
+  memcpy (&header,index->data,sizeof (header));
+  if (memcmp (header.magic,KMER_INDEX_MAGIC,sizeof (header.magic)) != 0) {
+    die ("Not a valid k-mer index: %s",fileName);
+  }
+  if (header.kmerSize != KMER_SIZE) {
+    die ("The k-mer index %s has %d-mers instead of %d-mers, please rebuild it",fileName,header.kmerSize,KMER_SIZE);
+  }
+  index->size = header.size;
+  index->numSequences = header.numSequences;
+  index->namesSize = header.namesSize;
+  offset = sizeof (header);
+  index->reference = (char*)kmerIndex_mapSection (index,&offset,index->size + 1,fileName);
+  index->offsets = (uint32_t*)kmerIndex_mapSection (index,&offset,(NUM_KMERS + 1) * sizeof (uint32_t),fileName);
+  index->positions = (uint32_t*)kmerIndex_mapSection (index,&offset,header.numKmers * sizeof (uint32_t),fileName);
+  index->sequenceStarts = (uint32_t*)kmerIndex_mapSection (index,&offset,(index->numSequences + 1) * sizeof (uint32_t),fileName);
+  index->nameOffsets = (uint32_t*)kmerIndex_mapSection (index,&offset,index->numSequences * sizeof (uint32_t),fileName);
+  index->names = (char*)kmerIndex_mapSection (index,&offset,index->namesSize,fileName);
+  if (index->offsets[NUM_KMERS] != header.numKmers || index->sequenceStarts[index->numSequences] != index->size ||
+      (index->namesSize > 0 && index->names[index->namesSize - 1] != '\0')) {
+    die ("Not a valid k-mer index: %s",fileName);
+  }
+  return index;
+}
+
+
+
+static int kmerIndex_score (char *query, char *reference)
+{
+  return *query == *reference && *reference != 'N' ? 1 : -1;
+}
+
+
+
+static int kmerIndex_findSequence (KmerIndex *index, uint32_t position)
+{
+  uint32_t low,high,middle;
+
+  // the last sequence starting at or before position
+  low = 0;
+  high = index->numSequences;
+  while (high - low > 1) {
+    middle = low + (high - low) / 2;
+    if (index->sequenceStarts[middle] <= position) {
+      low = middle;
+    }
+    else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+
+
+static int kmerIndex_alignStrand (KmerIndex *index, char *query, int length, int minScore, Array targets)
+{
+  int64_t seedDiagonals[MAX_SEEDS],diagonal;
+  int seedEnds[MAX_SEEDS];
+  uint32_t code,run,h,position;
+  int q,i,s,r,base,numSeeds,isExtended;
+  int score,bestScore,leftScore,qStart,qEnd,best;
+
+  best = 0;
+  numSeeds = 0;
+  code = 0;
+  run = 0;
+  for (q = 0; q < length; q++) {
+    if ((base = kmerIndex_encode (query[q])) < 0) {
+      run = 0;
+      continue;
+    }
+    code = ((code << 2) | base) & (NUM_KMERS - 1);
+    if (++run < KMER_SIZE || index->offsets[code + 1] - index->offsets[code] > MAX_HITS_PER_KMER) {
+      continue;
+    }
+    for (h = index->offsets[code]; h < index->offsets[code + 1]; h++) {
+      position = index->positions[h];
+      diagonal = (int64_t)position - (q + 1 - KMER_SIZE);
+      isExtended = 0;
+      for (s = 0; s < numSeeds && s < MAX_SEEDS; s++) {
+        if (seedDiagonals[s] == diagonal && seedEnds[s] > q) {
+          isExtended = 1;
+          break;
+        }
+      }
+      if (isExtended) {
+        continue;
+      }
+      // extension to the left of the seed
+      score = 0;
+      bestScore = 0;
+      qStart = q + 1 - KMER_SIZE;
+      for (i = qStart - 1, r = (int)position - 1; i >= 0 && r >= 0; i--, r--) {
+        score += kmerIndex_score (query + i,index->reference + r);
+        if (score > bestScore) {
+          bestScore = score;
+          qStart = i;
+        }
+        else if (bestScore - score >= X_DROP) {
+          break;
+        }
+      }
+      leftScore = bestScore;
+      // extension to the right of the seed
+      score = 0;
+      bestScore = 0;
+      qEnd = q + 1;
+      for (i = q + 1, r = (int)position + KMER_SIZE; i < length && r < index->size; i++, r++) {
+        score += kmerIndex_score (query + i,index->reference + r);
+        if (score > bestScore) {
+          bestScore = score;
+          qEnd = i + 1;
+        }
+        else if (bestScore - score >= X_DROP) {
+          break;
+        }
+      }
+      seedDiagonals[numSeeds % MAX_SEEDS] = diagonal;
+      seedEnds[numSeeds % MAX_SEEDS] = qEnd;
+      numSeeds++;
+      if (KMER_SIZE + leftScore + bestScore < minScore) {
+        continue;
+      }
+      if (qEnd - qStart > best) {
+        best = qEnd - qStart;
+      }
+      if (targets != NULL) {
+        array (targets,arrayMax (targets),int) = kmerIndex_findSequence (index,position);
+      }
+    }
+  }
+  return best;
+}
+
+
+
+static int kmerIndex_alignRead (KmerIndex *index, char *read, int minScore, Array targets)
+{
+  char *forward,*reverse;
+  int i,length,best,bestReverse;
+
+  length = strlen (read);
+  forward = (char*)hlr_malloc (2 * (length + 1));
+  reverse = forward + length + 1;
+  for (i = 0; i < length; i++) {
+    forward[i] = toupper (read[i]);
+    switch (forward[i]) {
+    case 'A': reverse[length - 1 - i] = 'T'; break;
+    case 'C': reverse[length - 1 - i] = 'G'; break;
+    case 'G': reverse[length - 1 - i] = 'C'; break;
+    case 'T': reverse[length - 1 - i] = 'A'; break;
+    default: reverse[length - 1 - i] = 'N';
+    }
+  }
+  forward[length] = '\0';
+  reverse[length] = '\0';
+  best = kmerIndex_alignStrand (index,forward,length,minScore,targets);
+  bestReverse = kmerIndex_alignStrand (index,reverse,length,minScore,targets);
+  hlr_free (forward);
+  return best > bestReverse ? best : bestReverse;
+}
+
+
+
+int kmerIndex_align (KmerIndex *index, char *read, int minScore)
+{
+  int span;
+
+  span = kmerIndex_alignRead (index,read,minScore,NULL);
+  return span > 0 ? span + 1 : 0; // qEnd - qStart + 1 of a PSL entry, where qEnd is exclusive
+}
+
+
+
+int kmerIndex_getTargets (KmerIndex *index, char *read, int minScore, Array targets)
+{
+  arrayClear (targets);
+  kmerIndex_alignRead (index,read,minScore,targets);
+  arraySort (targets,(ARRAYORDERF)arrayIntcmp);
+  arrayUniq (targets,NULL,(ARRAYORDERF)arrayIntcmp);
+  return arrayMax (targets);
+}
+
+
+
+char* kmerIndex_getSequenceName (KmerIndex *index, int i)
+{
+  return index->names + index->nameOffsets[i];
+}
+
+
+
+void kmerIndex_destroy (KmerIndex *index)
+{
+  if (index == NULL) {
+    return;
+  }
+  if (index->data != NULL) {
+    munmap (index->data,index->dataSize);
+  }
+  else {
+    hlr_free (index->reference);
+    hlr_free (index->offsets);
+    hlr_free (index->positions);
+    hlr_free (index->sequenceStarts);
+    hlr_free (index->nameOffsets);
+    hlr_free (index->names);
+  }
+  freeMem (index);
+}
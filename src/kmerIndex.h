@@ -0,0 +1,41 @@
+#ifndef DEF_KMER_INDEX_H
+#define DEF_KMER_INDEX_H
+
+#include <bios/format.h>
+
+
+
+/**
+   @file kmerIndex.h
+   @brief K-mer index of a reference, used to screen reads for contaminant sequences and for splice junctions.
+   @details All the k-mers of the reference (2bit format) are stored in a direct-address table. The k-mers of a read (and of its reverse complement) are looked up in the table and each seed is extended without gaps, with an X-drop, in both directions. The result is the overlap of the longest alignment that reaches the minimum score in the convention of getNucleotideOverlap() on the gfClient output: qEnd - qStart + 1 of the PSL entry, whose qEnd is exclusive, i.e. the number of aligned read bases + 1.
+   The index of a large reference (e.g. a splice junction library) can be built once with kmerIndex_write() and mapped in memory (mmap) with kmerIndex_open(), so a run does not need to index it again; see twoBit2kmerIndex.
+   The index is read-only after kmerIndex_create() or kmerIndex_open(), so kmerIndex_align() can be called from several threads.
+ */
+
+
+
+typedef struct _kmerIndex KmerIndex;
+
+
+
+/** create the index of all the sequences of a 2bit file. */
+extern KmerIndex* kmerIndex_create (char* twoBitFile);
+/** write the index to a file that can be mapped with kmerIndex_open(). @remark the integers are in the byte order of this machine. */
+extern void kmerIndex_write (KmerIndex* index, char* fileName);
+/** map an index written by kmerIndex_write(). @remark the program dies if the file is not a valid index. */
+extern KmerIndex* kmerIndex_open (char* fileName);
+/** align a read against the index, on both strands.
+    @return the number of read bases covered by the longest ungapped alignment with score (matches - mismatches) of at least minScore + 1, as getNucleotideOverlap(); 0 if there is none. */
+extern int kmerIndex_align (KmerIndex* index, char* read, int minScore);
+/** find the sequences of the index hit by a read, on both strands.
+    @return the number of sequences with an ungapped alignment of score of at least minScore; targets is filled with their numbers, sorted. */
+extern int kmerIndex_getTargets (KmerIndex* index, char* read, int minScore, Array targets /**< [out] Array of int, cleared first */);
+/** @return the name of sequence i, as in the 2bit file. */
+extern char* kmerIndex_getSequenceName (KmerIndex* index, int i);
+/** de-allocate, or unmap, the index. */
+extern void kmerIndex_destroy (KmerIndex* index);
+
+
+
+#endif
@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <bios/log.h>
+#include <bios/format.h>
+#include <bios/linestream.h>
+
+#include "kvStore.h"
+#include "uthash.h"
+
+
+
+typedef struct {
+  char *key;
+  char *value;
+  UT_hash_handle hh;
+} KvEntry;
+
+
+
+struct _kvStore {
+  int fd;
+  KvEntry *entries;
+};
+
+
+
+static void kvStore_set (KvStore *store, char *key, char *value)
+{
+  KvEntry *currEntry;
+
+  HASH_FIND_STR (store->entries,key,currEntry);
+  if (currEntry != NULL) {
+    hlr_free (currEntry->value);
+    currEntry->value = hlr_strdup (value);
+    return;
+  }
+  AllocVar (currEntry);
+  currEntry->key = hlr_strdup (key);
+  currEntry->value = hlr_strdup (value);
+  HASH_ADD_KEYPTR (hh,store->entries,currEntry->key,strlen (currEntry->key),currEntry);
+}
+
+
+
+KvStore* kvStore_open (char *fileName)
+{
+  KvStore *store;
+  LineStream ls;
+  Texta tokens;
+  char *line;
+
+  AllocVar (store);
+  store->entries = NULL;
+  if ((store->fd = open (fileName,O_WRONLY | O_APPEND | O_CREAT,0644)) < 0) {
+    freeMem (store);
+    return NULL;
+  }
+  ls = ls_createFromFile (fileName);
+  while (line = ls_nextLine (ls)) {
+    tokens = textFieldtokP (line,"\t");
+    if (arrayMax (tokens) == 3 && strEqual (textItem (tokens,2),".")) {
+      kvStore_set (store,textItem (tokens,0),textItem (tokens,1));
+    }
+    textDestroy (tokens);
+  }
+  ls_destroy (ls);
+  return store;
+}
+
+
+
+void kvStore_close (KvStore *store)
+{
+  KvEntry *currEntry,*tmp;
+
+  if (store == NULL) {
+    return;
+  }
+  HASH_ITER (hh,store->entries,currEntry,tmp) {
+    HASH_DEL (store->entries,currEntry);
+    hlr_free (currEntry->key);
+    hlr_free (currEntry->value);
+    freeMem (currEntry);
+  }
+  close (store->fd);
+  freeMem (store);
+}
+
+
+
+char* kvStore_get (KvStore *store, char *key)
+{
+  KvEntry *currEntry;
+
+  HASH_FIND_STR (store->entries,key,currEntry);
+  return currEntry != NULL ? currEntry->value : NULL;
+}
+
+
+
+void kvStore_put (KvStore *store, char *key, char *value)
+{
+  static Stringa buffer = NULL;
+
+  stringCreateClear (buffer,100);
+  stringPrintf (buffer,"%s\t%s\t.\n",key,value);
+  if (write (store->fd,string (buffer),stringLen (buffer)) != stringLen (buffer)) {
+    warn ("Unable to write to the key-value store: %s",key);
+  }
+  kvStore_set (store,key,value);
+}
+
+
+
+int kvStore_count (KvStore *store)
+{
+  return HASH_COUNT (store->entries);
+}
+
+
+
+char* kvStore_hash (char *data, int size)
+{
+  static char hash[33];
+  uint64_t h1,h2;
+  int i;
+
+  // two 64-bit FNV-1a hashes with different offset basis; the second one also mixes in the position
+  h1 = 0xcbf29ce484222325ULL;
+  h2 = 0x84222325cbf29ce4ULL;
+  for (i = 0; i < size; i++) {
+    h1 = (h1 ^ (unsigned char)data[i]) * 0x100000001b3ULL;
+    h2 = (h2 ^ ((unsigned char)data[i] + (uint64_t)i * 0x9e3779b97f4a7c15ULL)) * 0x100000001b3ULL;
+  }
+  sprintf (hash,"%016llx%016llx",(unsigned long long)h1,(unsigned long long)h2);
+  return hash;
+}
@@ -0,0 +1,33 @@
+#ifndef DEF_KV_STORE_H
+#define DEF_KV_STORE_H
+
+
+
+/**
+   @file kvStore.h
+   @brief Local on-disk key-value store.
+   @details Append-only log of tab-delimited records (key, value, '.'), indexed in memory by a hash table when the store is opened. A later record with the same key supersedes the earlier ones. Each record is appended with a single write(), so several processes can share the same store; incomplete records (e.g. after a crash) are ignored. Keys and values must not contain tabs or newlines.
+ */
+
+
+
+typedef struct _kvStore KvStore;
+
+
+
+/** open (and create if needed) a key-value store. @return NULL if the file cannot be opened. */
+extern KvStore* kvStore_open (char* fileName /**< [in] path of the log file */);
+/** close the key-value store and free the index. */
+extern void kvStore_close (KvStore* store);
+/** retrieve the value of a key. @return the value or NULL if the key is not present. @remark the value is owned by the store. */
+extern char* kvStore_get (KvStore* store, char* key);
+/** add or replace the value of a key. */
+extern void kvStore_put (KvStore* store, char* key, char* value);
+/** number of keys in the store. */
+extern int kvStore_count (KvStore* store);
+/** 128-bit hash of a buffer. @return the hash as 32 hexadecimal digits in a static buffer. */
+extern char* kvStore_hash (char* data, int size);
+
+
+
+#endif
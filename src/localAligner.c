@@ -0,0 +1,430 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <bios/log.h>
+#include <bios/format.h>
+
+#include "localAligner.h"
+
+
+
+#define SEED_SIZE 12
+#define MAX_HITS_PER_SEED 256 // seeds more frequent than this are not used
+#define MAX_WINDOWS 64 // windows aligned per strand
+#define BAND 16 // slack around the diagonals of a window, for the gaps
+#define MATCH 1
+#define MISMATCH 1
+#define GAP_OPEN 3 // penalty of the first base of a gap
+#define GAP_EXTENSION 1
+#define PADDING -64 // score of the lanes beyond the end of the query
+
+
+
+typedef struct {
+  uint32_t code;
+  int position;
+} Seed;
+
+
+
+struct _localAligner {
+  char *target; // upper case
+  int size;
+  Array seeds; // Array of Seed, sorted by code
+};
+
+
+
+static int localAligner_encode (char c)
+{
+  switch (c) {
+  case 'A': return 0;
+  case 'C': return 1;
+  case 'G': return 2;
+  case 'T': return 3;
+  }
+  return -1;
+}
+
+
+
+static int sortSeedsByCode (Seed *a, Seed *b)
+{
+  if (a->code != b->code) {
+    return a->code < b->code ? -1 : 1;
+  }
+  return a->position - b->position;
+}
+
+
+
+LocalAligner* localAligner_create (char *target)
+{
+  LocalAligner *aligner;
+  Seed *currSeed;
+  uint32_t code,run;
+  int i,base;
+
+  AllocVar (aligner);
+  aligner->size = strlen (target);
+  aligner->target = (char*)hlr_malloc (aligner->size + 1);
+  for (i = 0; i <= aligner->size; i++) {
+    aligner->target[i] = toupper (target[i]);
+  }
+  aligner->seeds = arrayCreate (aligner->size + 1,Seed);
+  code = 0;
+  run = 0;
+  for (i = 0; i < aligner->size; i++) {
+    if ((base = localAligner_encode (aligner->target[i])) < 0) {
+      run = 0;
+      continue;
+    }
+    code = ((code << 2) | base) & ((1 << (2 * SEED_SIZE)) - 1);
+    if (++run >= SEED_SIZE) {
+      currSeed = arrayp (aligner->seeds,arrayMax (aligner->seeds),Seed);
+      currSeed->code = code;
+      currSeed->position = i + 1 - SEED_SIZE;
+    }
+  }
+  arraySort (aligner->seeds,(ARRAYORDERF)sortSeedsByCode);
+  return aligner;
+}
+
+
+
+static int localAligner_findFirstSeed (LocalAligner *aligner, uint32_t code)
+{
+  int low,high,middle;
+
+  low = 0;
+  high = arrayMax (aligner->seeds);
+  while (low < high) {
+    middle = low + (high - low) / 2;
+    if (arrp (aligner->seeds,middle,Seed)->code < code) {
+      low = middle + 1;
+    }
+    else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+
+
+static int localAligner_score (int queryCode, char targetBase)
+{
+  return queryCode >= 0 && queryCode == localAligner_encode (targetBase) ? MATCH : -MISMATCH;
+}
+
+
+
+#if defined(__SSE2__)
+
+static __m128i* localAligner_allocVectors (int numVectors)
+{
+  void *vectors;
+
+  if (posix_memalign (&vectors,16,numVectors * sizeof (__m128i)) != 0) {
+    die ("Unable to allocate the alignment vectors");
+  }
+  memset (vectors,0,numVectors * sizeof (__m128i));
+  return (__m128i*)vectors;
+}
+
+
+
+/**
+   Striped Smith-Waterman (Farrar, Bioinformatics 2007), 8 lanes of 16 bits.
+   @return the best score; qEnd and tEnd are the last positions of the best alignment.
+ */
+static int localAligner_smithWatermanStriped (const char *query, int qLen, const char *target, int tLen, int *qEnd, int *tEnd)
+{
+  static const char bases[5] = {'A','C','G','T','N'};
+  __m128i *profile,*hStore,*hLoad,*e,*swap,*currProfile;
+  __m128i vZero,vGapOpen,vGapExtension,vH,vF,vMax;
+  int16_t lanes[8];
+  int segLen,i,j,k,c,position,best,columnBest;
+
+  segLen = (qLen + 7) / 8;
+  profile = localAligner_allocVectors (5 * segLen);
+  hStore = localAligner_allocVectors (segLen);
+  hLoad = localAligner_allocVectors (segLen);
+  e = localAligner_allocVectors (segLen);
+  // lane k of the vector j of the profile of base c is the score of query[k * segLen + j] against c
+  for (c = 0; c < 5; c++) {
+    for (j = 0; j < segLen; j++) {
+      for (k = 0; k < 8; k++) {
+        position = k * segLen + j;
+        lanes[k] = position < qLen ? localAligner_score (localAligner_encode (query[position]),bases[c]) : PADDING;
+      }
+      profile[c * segLen + j] = _mm_loadu_si128 ((__m128i*)lanes);
+    }
+  }
+  vZero = _mm_setzero_si128 ();
+  vGapOpen = _mm_set1_epi16 (GAP_OPEN);
+  vGapExtension = _mm_set1_epi16 (GAP_EXTENSION);
+  best = 0;
+  *qEnd = -1;
+  *tEnd = -1;
+  for (i = 0; i < tLen; i++) {
+    c = localAligner_encode (target[i]);
+    currProfile = profile + (c < 0 ? 4 : c) * segLen;
+    vF = vZero;
+    vH = _mm_slli_si128 (hStore[segLen - 1],2);
+    swap = hLoad;
+    hLoad = hStore;
+    hStore = swap;
+    for (j = 0; j < segLen; j++) {
+      vH = _mm_adds_epi16 (vH,currProfile[j]);
+      vH = _mm_max_epi16 (vH,e[j]);
+      vH = _mm_max_epi16 (vH,vF);
+      vH = _mm_max_epi16 (vH,vZero);
+      hStore[j] = vH;
+      vH = _mm_subs_epu16 (vH,vGapOpen);
+      e[j] = _mm_max_epi16 (_mm_subs_epu16 (e[j],vGapExtension),vH);
+      vF = _mm_max_epi16 (_mm_subs_epu16 (vF,vGapExtension),vH);
+      vH = hLoad[j];
+    }
+    // lazy F loop: the vertical gaps crossing the segments
+    for (k = 0; k < 8; k++) {
+      vF = _mm_slli_si128 (vF,2);
+      for (j = 0; j < segLen; j++) {
+        hStore[j] = _mm_max_epi16 (hStore[j],vF);
+        vH = _mm_subs_epu16 (hStore[j],vGapOpen);
+        vF = _mm_subs_epu16 (vF,vGapExtension);
+        if (_mm_movemask_epi8 (_mm_cmpgt_epi16 (vF,vH)) == 0) {
+          goto endOfColumn;
+        }
+      }
+    }
+  endOfColumn:
+    vMax = hStore[0];
+    for (j = 1; j < segLen; j++) {
+      vMax = _mm_max_epi16 (vMax,hStore[j]);
+    }
+    _mm_storeu_si128 ((__m128i*)lanes,vMax);
+    columnBest = lanes[0];
+    for (k = 1; k < 8; k++) {
+      if (lanes[k] > columnBest) {
+        columnBest = lanes[k];
+      }
+    }
+    if (columnBest > best) {
+      best = columnBest;
+      *tEnd = i;
+      *qEnd = -1;
+      for (j = 0; j < segLen; j++) {
+        _mm_storeu_si128 ((__m128i*)lanes,hStore[j]);
+        for (k = 0; k < 8; k++) {
+          position = k * segLen + j;
+          if (lanes[k] == best && position < qLen && (*qEnd < 0 || position < *qEnd)) {
+            *qEnd = position;
+          }
+        }
+      }
+    }
+  }
+  free (profile);
+  free (hStore);
+  free (hLoad);
+  free (e);
+  return best;
+}
+
+#endif
+
+
+
+/**
+   Smith-Waterman with affine gaps (Gotoh), the reference of the striped version.
+   @return the best score; qEnd and tEnd are the last positions of the best alignment.
+ */
+static int localAligner_smithWatermanScalar (const char *query, int qLen, const char *target, int tLen, int *qEnd, int *tEnd)
+{
+  int *h,*e;
+  int i,j,diagonal,f,score,best;
+
+  h = (int*)hlr_calloc (qLen + 1,sizeof (int));
+  e = (int*)hlr_calloc (qLen + 1,sizeof (int));
+  best = 0;
+  *qEnd = -1;
+  *tEnd = -1;
+  for (i = 0; i < tLen; i++) {
+    diagonal = 0;
+    f = 0;
+    for (j = 1; j <= qLen; j++) {
+      e[j] = MAX (e[j] - GAP_EXTENSION,h[j] - GAP_OPEN);
+      f = MAX (f - GAP_EXTENSION,h[j - 1] - GAP_OPEN);
+      score = diagonal + localAligner_score (localAligner_encode (query[j - 1]),target[i]);
+      score = MAX (MAX (score,0),MAX (e[j],f));
+      diagonal = h[j];
+      h[j] = score;
+      if (score > best) {
+        best = score;
+        *qEnd = j - 1;
+        *tEnd = i;
+      }
+    }
+  }
+  hlr_free (h);
+  hlr_free (e);
+  return best;
+}
+
+
+
+static int localAligner_smithWaterman (const char *query, int qLen, const char *target, int tLen, int *qEnd, int *tEnd)
+{
+#if defined(__SSE2__)
+  return localAligner_smithWatermanStriped (query,qLen,target,tLen,qEnd,tEnd);
+#else
+  return localAligner_smithWatermanScalar (query,qLen,target,tLen,qEnd,tEnd);
+#endif
+}
+
+
+
+/// overlap of the best local alignment in a window of the target, i.e. the aligned read bases + 1 (see localAligner_align()), 0 if its score is below minScore
+static int localAligner_alignWindow (LocalAligner *aligner, char *query, int qLen, int tStart, int tEnd, int minScore)
+{
+  char *reverseQuery,*reverseTarget;
+  int i,score,qEnd,tLast,qFirst,tFirst;
+
+  score = localAligner_smithWaterman (query,qLen,aligner->target + tStart,tEnd - tStart,&qEnd,&tLast);
+  if (score < minScore || qEnd < 0) {
+    return 0;
+  }
+  // the start of the alignment is the end of the alignment of the reversed sequences
+  reverseQuery = (char*)hlr_malloc (qEnd + 1);
+  reverseTarget = (char*)hlr_malloc (tLast + 1);
+  for (i = 0; i <= qEnd; i++) {
+    reverseQuery[i] = query[qEnd - i];
+  }
+  for (i = 0; i <= tLast; i++) {
+    reverseTarget[i] = aligner->target[tStart + tLast - i];
+  }
+  localAligner_smithWaterman (reverseQuery,qEnd + 1,reverseTarget,tLast + 1,&qFirst,&tFirst);
+  hlr_free (reverseQuery);
+  hlr_free (reverseTarget);
+  return qFirst + 2; // qEnd - qStart + 1 of a PSL entry, where qEnd is exclusive
+}
+
+
+
+static int sortIntegers (int *a, int *b)
+{
+  return *a - *b;
+}
+
+
+
+static int localAligner_alignStrand (LocalAligner *aligner, char *query, int qLen, int minScore)
+{
+  Array diagonals;
+  uint32_t code,run;
+  int q,h,first,base,best,span,numWindows,windowStart,windowEnd,i;
+
+  // diagonals of the seeds
+  diagonals = arrayCreate (100,int);
+  code = 0;
+  run = 0;
+  for (q = 0; q < qLen; q++) {
+    if ((base = localAligner_encode (query[q])) < 0) {
+      run = 0;
+      continue;
+    }
+    code = ((code << 2) | base) & ((1 << (2 * SEED_SIZE)) - 1);
+    if (++run < SEED_SIZE) {
+      continue;
+    }
+    first = localAligner_findFirstSeed (aligner,code);
+    for (h = first; h < arrayMax (aligner->seeds) && arrp (aligner->seeds,h,Seed)->code == code; h++) {
+      if (h - first >= MAX_HITS_PER_SEED) {
+        break;
+      }
+      array (diagonals,arrayMax (diagonals),int) = arrp (aligner->seeds,h,Seed)->position - (q + 1 - SEED_SIZE);
+    }
+  }
+  arraySort (diagonals,(ARRAYORDERF)sortIntegers);
+  // the seeds on nearby diagonals share the same window
+  best = 0;
+  numWindows = 0;
+  i = 0;
+  while (i < arrayMax (diagonals) && numWindows < MAX_WINDOWS) {
+    windowStart = arru (diagonals,i,int);
+    windowEnd = windowStart;
+    while (i < arrayMax (diagonals) && arru (diagonals,i,int) - windowEnd <= BAND) {
+      windowEnd = arru (diagonals,i,int);
+      i++;
+    }
+    windowStart = MAX (windowStart - BAND,0);
+    windowEnd = MIN (windowEnd + qLen + BAND,aligner->size);
+    span = localAligner_alignWindow (aligner,query,qLen,windowStart,windowEnd,minScore);
+    if (span > best) {
+      best = span;
+    }
+    numWindows++;
+  }
+  arrayDestroy (diagonals);
+  return best;
+}
+
+
+
+int localAligner_align (LocalAligner *aligner, char *read, int minScore)
+{
+  char *forward,*reverse;
+  int i,length,best,bestReverse;
+
+  length = strlen (read);
+  if (length == 0) {
+    return 0;
+  }
+  forward = (char*)hlr_malloc (2 * (length + 1));
+  reverse = forward + length + 1;
+  for (i = 0; i < length; i++) {
+    forward[i] = toupper (read[i]);
+    switch (forward[i]) {
+    case 'A': reverse[length - 1 - i] = 'T'; break;
+    case 'C': reverse[length - 1 - i] = 'G'; break;
+    case 'G': reverse[length - 1 - i] = 'C'; break;
+    case 'T': reverse[length - 1 - i] = 'A'; break;
+    default: reverse[length - 1 - i] = 'N';
+    }
+  }
+  forward[length] = '\0';
+  reverse[length] = '\0';
+  best = localAligner_alignStrand (aligner,forward,length,minScore);
+  bestReverse = localAligner_alignStrand (aligner,reverse,length,minScore);
+  hlr_free (forward);
+  return MAX (best,bestReverse);
+}
+
+
+
+int localAligner_computeScore (char *query, char *target, int scalar, int *qEnd, int *tEnd)
+{
+  if (scalar) {
+    return localAligner_smithWatermanScalar (query,strlen (query),target,strlen (target),qEnd,tEnd);
+  }
+  return localAligner_smithWaterman (query,strlen (query),target,strlen (target),qEnd,tEnd);
+}
+
+
+
+void localAligner_destroy (LocalAligner *aligner)
+{
+  if (aligner == NULL) {
+    return;
+  }
+  hlr_free (aligner->target);
+  arrayDestroy (aligner->seeds);
+  freeMem (aligner);
+}
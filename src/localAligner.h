@@ -0,0 +1,33 @@
+#ifndef DEF_LOCAL_ALIGNER_H
+#define DEF_LOCAL_ALIGNER_H
+
+
+
+/**
+   @file localAligner.h
+   @brief In-process local alignment of short reads against a genomic region, e.g. the partner transcript of a fusion candidate.
+   @details The region is indexed with its 12-mers. The 12-mers of a read (and of its reverse complement) are looked up in the index, and the seeds on nearby diagonals are grouped into windows. Each window is aligned with a banded Smith-Waterman (match 1, mismatch -1, gap open 3, gap extension 1; approximately the blat score). With SSE2 the kernel is the striped algorithm of Farrar on 8 lanes of 16 bits; otherwise a scalar version is used.
+   The result is the overlap of the best alignment with a score of at least minScore, in the convention of getNucleotideOverlap() on the blat output: qEnd - qStart + 1 of the PSL entry, whose qEnd is exclusive, i.e. the number of aligned read bases + 1. It is compared with readSize * MAX_OVERLAP_ALLOWED as before, so the thresholds keep their meaning (e.g. a 37 bp hit of a 50 bp read is over 0.75).
+   The aligner is read-only after localAligner_create(), so a read can be aligned from several threads.
+ */
+
+
+
+typedef struct _localAligner LocalAligner;
+
+
+
+/** create the aligner of a target sequence. @remark the sequence is copied. */
+extern LocalAligner* localAligner_create (char* target);
+/** align a read against the target, on both strands.
+    @return the number of read bases covered by the best local alignment with a score of at least minScore + 1, as getNucleotideOverlap(); 0 if there is none. */
+extern int localAligner_align (LocalAligner* aligner, char* read, int minScore);
+/** Smith-Waterman of the whole query against the whole target, with the kernel of localAligner_align() or, if scalar is 1, with the scalar kernel it is checked against (see localAlignerValidate).
+    @return the best score; qEnd and tEnd are the last positions of the best alignment, -1 if the score is 0. */
+extern int localAligner_computeScore (char* query, char* target, int scalar, int* qEnd, int* tEnd);
+/** de-allocate the aligner. */
+extern void localAligner_destroy (LocalAligner* aligner);
+
+
+
+#endif
@@ -0,0 +1,184 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <bios/log.h>
+#include <bios/format.h>
+
+#include "metrics.h"
+
+
+
+static Metrics metrics;
+static int initialized = 0;
+static double startTime = 0.0;
+static double subprocessStartTime = 0.0;
+
+
+
+static double metrics_getTime (void)
+{
+  struct timeval tv;
+
+  gettimeofday (&tv,NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+
+
+static double metrics_getSeconds (struct timeval *tv)
+{
+  return tv->tv_sec + tv->tv_usec / 1e6;
+}
+
+
+
+static char* metrics_getBaseName (char *path)
+{
+  char *pos;
+
+  pos = strrchr (path,'/');
+  return pos != NULL ? pos + 1 : path;
+}
+
+
+
+static void metrics_write (void)
+{
+  struct rusage usageSelf,usageChildren;
+  FILE *fp;
+  char *fileName;
+  int isJson;
+  int size;
+  double wallTime,userTime,systemTime,childrenTime;
+
+  if ((fileName = getenv ("FUSIONSEQ_METRICS")) == NULL || fileName[0] == '\0') {
+    return;
+  }
+  if (subprocessStartTime > 0.0) {
+    metrics_stopSubprocess ();
+  }
+  wallTime = metrics_getTime () - startTime;
+  getrusage (RUSAGE_SELF,&usageSelf);
+  getrusage (RUSAGE_CHILDREN,&usageChildren);
+  userTime = metrics_getSeconds (&usageSelf.ru_utime);
+  systemTime = metrics_getSeconds (&usageSelf.ru_stime);
+  childrenTime = metrics_getSeconds (&usageChildren.ru_utime) + metrics_getSeconds (&usageChildren.ru_stime);
+  size = strlen (fileName);
+  isJson = size > 5 && strEqual (fileName + size - 5,".json");
+  if (!(fp = fopen (fileName,"a"))) {
+    warn ("Unable to open metrics file: %s",fileName);
+    return;
+  }
+  if (isJson) {
+    fprintf (fp,"{\"program\": \"%s\", \"pid\": %d, \"entriesIn\": %lld, \"entriesOut\": %lld, \"readsFlagged\": %lld, "
+             "\"wallTime\": %.3f, \"userTime\": %.3f, \"systemTime\": %.3f, \"peakRSSKb\": %ld, "
+             "\"bytesRead\": %lld, \"bytesWritten\": %lld, \"numSubprocesses\": %d, \"subprocessTime\": %.3f, \"subprocessCpuTime\": %.3f}\n",
+             metrics.program,(int)getpid (),metrics.entriesIn,metrics.entriesOut,metrics.readsFlagged,
+             wallTime,userTime,systemTime,usageSelf.ru_maxrss,
+             metrics.bytesRead,metrics.bytesWritten,metrics.numSubprocesses,metrics.subprocessTime,childrenTime);
+  }
+  else {
+    if (ftell (fp) == 0) {
+      fprintf (fp,"program\tpid\tentriesIn\tentriesOut\treadsFlagged\twallTime\tuserTime\tsystemTime\tpeakRSSKb\t"
+               "bytesRead\tbytesWritten\tnumSubprocesses\tsubprocessTime\tsubprocessCpuTime\n");
+    }
+    fprintf (fp,"%s\t%d\t%lld\t%lld\t%lld\t%.3f\t%.3f\t%.3f\t%ld\t%lld\t%lld\t%d\t%.3f\t%.3f\n",
+             metrics.program,(int)getpid (),metrics.entriesIn,metrics.entriesOut,metrics.readsFlagged,
+             wallTime,userTime,systemTime,usageSelf.ru_maxrss,
+             metrics.bytesRead,metrics.bytesWritten,metrics.numSubprocesses,metrics.subprocessTime,childrenTime);
+  }
+  fclose (fp);
+}
+
+
+
+void metrics_init (char *programName)
+{
+  if (initialized == 0) {
+    initialized = 1;
+    startTime = metrics_getTime ();
+    atexit (metrics_write);
+  }
+  if (metrics.program == NULL) {
+    metrics.program = hlr_strdup (metrics_getBaseName (programName != NULL ? programName : program_invocation_name));
+  }
+}
+
+
+
+void metrics_addEntriesIn (int count)
+{
+  metrics.entriesIn += count;
+}
+
+
+
+void metrics_addEntriesOut (int count)
+{
+  metrics.entriesOut += count;
+}
+
+
+
+void metrics_addReadsFlagged (int count)
+{
+  metrics.readsFlagged += count;
+}
+
+
+
+void metrics_addBytesRead (long long count)
+{
+  metrics.bytesRead += count;
+}
+
+
+
+void metrics_addBytesWritten (long long count)
+{
+  metrics.bytesWritten += count;
+}
+
+
+
+void metrics_startSubprocess (void)
+{
+  metrics_init (NULL);
+  subprocessStartTime = metrics_getTime ();
+  metrics.numSubprocesses++;
+}
+
+
+
+void metrics_stopSubprocess (void)
+{
+  if (subprocessStartTime > 0.0) {
+    metrics.subprocessTime += metrics_getTime () - subprocessStartTime;
+    subprocessStartTime = 0.0;
+  }
+}
+
+
+
+int metrics_system (char *cmd, int nonZeroOK)
+{
+  int ret;
+
+  metrics_startSubprocess ();
+  ret = hlr_system (cmd,nonZeroOK);
+  metrics_stopSubprocess ();
+  return ret;
+}
+
+
+
+Metrics* metrics_get (void)
+{
+  metrics_init (NULL);
+  return &metrics;
+}
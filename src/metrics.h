@@ -0,0 +1,50 @@
+#ifndef DEF_METRICS_H
+#define DEF_METRICS_H
+
+
+
+/**
+   @file metrics.h
+   @brief Per-tool metrics (entries, reads flagged, timings, memory, I/O).
+   @details The metrics are written when the program exits and only if the environment variable FUSIONSEQ_METRICS is set to the path of the metrics file. One record per program run is appended to the file: JSON (one object per line) if the path ends with ".json", tab-delimited otherwise (with a header line if the file is empty).
+ */
+
+
+
+typedef struct {
+  char *program;
+  long long entriesIn; /**< number of GFR/BP entries read */
+  long long entriesOut; /**< number of GFR/BP entries written */
+  long long readsFlagged; /**< number of inter-transcript reads flagged and removed from the output */
+  long long bytesRead; /**< number of bytes of GFR/BP read */
+  long long bytesWritten; /**< number of bytes of GFR/BP written */
+  int numSubprocesses; /**< number of external processes run through metrics_system() or timed with metrics_startSubprocess() */
+  double subprocessTime; /**< wall time (seconds) spent waiting for external processes */
+} Metrics;
+
+
+
+/** initialization of the metrics module. @remark it is called by gfr_init() and bp_init(); calling it again only sets the program name if it is not set yet. */
+extern void metrics_init (char* programName /**< [in] name of the program, usually argv[0]; NULL to use the name of the running executable */);
+/** add the number of GFR/BP entries read. */
+extern void metrics_addEntriesIn (int count);
+/** add the number of GFR/BP entries written. */
+extern void metrics_addEntriesOut (int count);
+/** add the number of inter-transcript reads flagged. */
+extern void metrics_addReadsFlagged (int count);
+/** add the number of bytes read. */
+extern void metrics_addBytesRead (long long count);
+/** add the number of bytes written. */
+extern void metrics_addBytesWritten (long long count);
+/** start the timer of an external process, e.g. around a pipe read through blatParser_initFromPipe(). */
+extern void metrics_startSubprocess (void);
+/** stop the timer of an external process. @pre metrics_startSubprocess() has been called. */
+extern void metrics_stopSubprocess (void);
+/** drop-in replacement of hlr_system() that also times the external process. */
+extern int metrics_system (char* cmd /**< [in] the command line */, int nonZeroOK /**< [in] if 0 a non-zero exit status is fatal */);
+/** get a pointer to the current metrics. */
+extern Metrics* metrics_get (void);
+
+
+
+#endif
@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include <bios/log.h>
+#include <bios/format.h>
+
+#include "conf.h"
+#include "subprocess.h"
+
+
+
+struct _memFile {
+  FILE *fp;
+  char path[32];
+};
+
+
+
+static int subprocess_createAnonymousFile (char *name)
+{
+  Stringa fileName;
+  char *tmpDir;
+  int fd;
+
+#if defined(__linux__) && defined(SYS_memfd_create)
+  if ((fd = syscall (SYS_memfd_create,name,0)) >= 0) {
+    return fd;
+  }
+#endif
+  // fallback: a file that is unlinked as soon as it is created
+  tmpDir = conf_get ()->tmpDir != NULL ? conf_get ()->tmpDir : "/tmp";
+  fileName = stringCreate (100);
+  stringPrintf (fileName,"%s/%s_XXXXXX",tmpDir,name);
+  if ((fd = mkstemp (string (fileName))) < 0) {
+    die ("Unable to create the temporary file: %s",string (fileName));
+  }
+  unlink (string (fileName));
+  stringDestroy (fileName);
+  return fd;
+}
+
+
+
+MemFile* subprocess_createMemFile (char *name)
+{
+  MemFile *memFile;
+  int fd;
+
+  fd = subprocess_createAnonymousFile (name);
+  AllocVar (memFile);
+  if ((memFile->fp = fdopen (fd,"w+")) == NULL) {
+    die ("Unable to open the in-memory file: %s",name);
+  }
+  sprintf (memFile->path,"/dev/fd/%d",fd);
+  return memFile;
+}
+
+
+
+FILE* subprocess_getStream (MemFile *memFile)
+{
+  return memFile->fp;
+}
+
+
+
+char* subprocess_getPath (MemFile *memFile)
+{
+  fflush (memFile->fp);
+  return memFile->path;
+}
+
+
+
+void subprocess_destroyMemFile (MemFile *memFile)
+{
+  if (memFile == NULL) {
+    return;
+  }
+  fclose (memFile->fp);
+  freeMem (memFile);
+}
+
+
+
+void subprocess_unlink (char *fileName)
+{
+  if (unlink (fileName) != 0 && errno != ENOENT) {
+    warn ("Unable to remove the file: %s",fileName);
+  }
+}
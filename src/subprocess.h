@@ -0,0 +1,33 @@
+#ifndef DEF_SUBPROCESS_H
+#define DEF_SUBPROCESS_H
+
+#include <stdio.h>
+
+
+
+/**
+   @file subprocess.h
+   @brief Plumbing of the inputs and outputs of the external tools without named temporary files.
+   @details The inputs of a tool (e.g. the reads in FASTA format) and the output files that it insists on writing (e.g. the PSL of gfClient) are anonymous in-memory files created with memfd_create(). They are passed on the command line as /dev/fd/N, which is valid both in this process and in the subprocesses that inherit the descriptor; the outputs written on stdout are read from a pipe (e.g. blatParser_initFromPipe()). Where memfd_create() is not available, the file is created in TMP_DIR (or /tmp) and unlinked right away. Nothing is left on disk and no shell is needed for the cleanup.
+ */
+
+
+
+typedef struct _memFile MemFile;
+
+
+
+/** create an anonymous in-memory file. @remark the program dies if the file cannot be created. */
+extern MemFile* subprocess_createMemFile (char* name /**< [in] name of the file, only for debugging */);
+/** @return the stream to write the file. */
+extern FILE* subprocess_getStream (MemFile* memFile);
+/** flush the stream and return the path of the file, /dev/fd/N. @return the path, valid until memFile is destroyed. */
+extern char* subprocess_getPath (MemFile* memFile);
+/** close and free the file. */
+extern void subprocess_destroyMemFile (MemFile* memFile);
+/** remove a file, without a shell. @remark a missing file is not an error. */
+extern void subprocess_unlink (char* fileName);
+
+
+
+#endif
@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#include <bios/log.h>
+#include <bios/format.h>
+
+#include "termMatcher.h"
+
+
+
+#define ALPHABET_SIZE 256
+
+
+
+struct _termMatcher {
+  int numStates;
+  int rootTransitions[ALPHABET_SIZE]; // the root is the most visited state: its transitions are complete
+  Array firstChild; // of int per state: child with the smallest character, -1 if none
+  Array nextSibling; // of int per state: next child of the parent, by increasing character, -1 if none
+  Array label; // of unsigned char per state: character of the edge from the parent
+  Array failure; // of int per state: longest proper suffix state
+  Array firstTerm; // of int per state: first term ending at the state, -1 if none
+  Array dictionaryLink; // of int per state: longest proper suffix state where a term ends, -1 if none
+  Array nextTerm; // of int per term: next term ending at the same state (duplicated terms), -1 if none
+  Array seen; // of int per term: last scan reporting the term
+  int scan;
+};
+
+
+
+static int termMatcher_addState (TermMatcher *matcher, unsigned char c)
+{
+  array (matcher->firstChild,matcher->numStates,int) = -1;
+  array (matcher->nextSibling,matcher->numStates,int) = -1;
+  array (matcher->label,matcher->numStates,unsigned char) = c;
+  array (matcher->failure,matcher->numStates,int) = 0;
+  array (matcher->firstTerm,matcher->numStates,int) = -1;
+  array (matcher->dictionaryLink,matcher->numStates,int) = -1;
+  return matcher->numStates++;
+}
+
+
+
+/**
+   @return the child of state on c, -1 if none.
+*/
+static int termMatcher_getChild (TermMatcher *matcher, int state, unsigned char c)
+{
+  int child;
+
+  for (child = arru (matcher->firstChild,state,int); child >= 0 && arru (matcher->label,child,unsigned char) < c; child = arru (matcher->nextSibling,child,int)) {
+  }
+  return child >= 0 && arru (matcher->label,child,unsigned char) == c ? child : -1;
+}
+
+
+
+/**
+   @return the state after reading c in state, following the failure links.
+*/
+static int termMatcher_next (TermMatcher *matcher, int state, unsigned char c)
+{
+  int child;
+
+  for (; state != 0; state = arru (matcher->failure,state,int)) {
+    if ((child = termMatcher_getChild (matcher,state,c)) >= 0) {
+      return child;
+    }
+  }
+  return matcher->rootTransitions[c];
+}
+
+
+
+TermMatcher* termMatcher_create (Texta terms)
+{
+  TermMatcher *matcher;
+  Array queue;
+  unsigned char *pos;
+  unsigned char c;
+  int i,state,next,previous,head;
+
+  AllocVar (matcher);
+  matcher->firstChild = arrayCreate (1000,int);
+  matcher->nextSibling = arrayCreate (1000,int);
+  matcher->label = arrayCreate (1000,unsigned char);
+  matcher->failure = arrayCreate (1000,int);
+  matcher->firstTerm = arrayCreate (1000,int);
+  matcher->dictionaryLink = arrayCreate (1000,int);
+  matcher->nextTerm = arrayCreate (arrayMax (terms) + 1,int);
+  matcher->seen = arrayCreate (arrayMax (terms) + 1,int);
+  termMatcher_addState (matcher,'\0');
+  // trie of the case-folded terms, the children of a state are kept sorted by character
+  for (i = 0; i < arrayMax (terms); i++) {
+    state = 0;
+    for (pos = (unsigned char*)textItem (terms,i); *pos != '\0'; pos++) {
+      c = tolower (*pos);
+      previous = -1;
+      for (next = arru (matcher->firstChild,state,int); next >= 0 && arru (matcher->label,next,unsigned char) < c; next = arru (matcher->nextSibling,next,int)) {
+        previous = next;
+      }
+      if (next < 0 || arru (matcher->label,next,unsigned char) != c) {
+        next = termMatcher_addState (matcher,c);
+        if (previous < 0) {
+          arru (matcher->nextSibling,next,int) = arru (matcher->firstChild,state,int);
+          arru (matcher->firstChild,state,int) = next;
+        }
+        else {
+          arru (matcher->nextSibling,next,int) = arru (matcher->nextSibling,previous,int);
+          arru (matcher->nextSibling,previous,int) = next;
+        }
+      }
+      state = next;
+    }
+    array (matcher->nextTerm,i,int) = arru (matcher->firstTerm,state,int);
+    arru (matcher->firstTerm,state,int) = i;
+    array (matcher->seen,i,int) = 0;
+  }
+  for (i = 0; i < ALPHABET_SIZE; i++) {
+    matcher->rootTransitions[i] = 0;
+  }
+  // failure links, breadth first: those of the shallower states are known
+  queue = arrayCreate (matcher->numStates,int);
+  for (next = arru (matcher->firstChild,0,int); next >= 0; next = arru (matcher->nextSibling,next,int)) {
+    matcher->rootTransitions[arru (matcher->label,next,unsigned char)] = next;
+    array (queue,arrayMax (queue),int) = next;
+  }
+  for (head = 0; head < arrayMax (queue); head++) {
+    state = arru (queue,head,int);
+    for (next = arru (matcher->firstChild,state,int); next >= 0; next = arru (matcher->nextSibling,next,int)) {
+      arru (matcher->failure,next,int) = termMatcher_next (matcher,arru (matcher->failure,state,int),arru (matcher->label,next,unsigned char));
+      arru (matcher->dictionaryLink,next,int) = arru (matcher->firstTerm,arru (matcher->failure,next,int),int) >= 0 ? arru (matcher->failure,next,int) : arru (matcher->dictionaryLink,arru (matcher->failure,next,int),int);
+      array (queue,arrayMax (queue),int) = next;
+    }
+  }
+  arrayDestroy (queue);
+  return matcher;
+}
+
+
+
+static void termMatcher_report (TermMatcher *matcher, int state, Array matches)
+{
+  int term;
+
+  if (arru (matcher->firstTerm,state,int) < 0) {
+    state = arru (matcher->dictionaryLink,state,int);
+  }
+  for (; state >= 0; state = arru (matcher->dictionaryLink,state,int)) {
+    for (term = arru (matcher->firstTerm,state,int); term >= 0; term = arru (matcher->nextTerm,term,int)) {
+      if (arru (matcher->seen,term,int) != matcher->scan) {
+        arru (matcher->seen,term,int) = matcher->scan;
+        array (matches,arrayMax (matches),int) = term;
+      }
+    }
+  }
+}
+
+
+
+int termMatcher_findAll (TermMatcher *matcher, char *text, Array matches)
+{
+  unsigned char *pos;
+  int state;
+
+  arrayClear (matches);
+  matcher->scan++;
+  state = 0;
+  termMatcher_report (matcher,state,matches); // the empty terms
+  for (pos = (unsigned char*)text; *pos != '\0'; pos++) {
+    state = termMatcher_next (matcher,state,tolower (*pos));
+    if (arru (matcher->firstTerm,state,int) >= 0 || arru (matcher->dictionaryLink,state,int) >= 0) {
+      termMatcher_report (matcher,state,matches);
+    }
+  }
+  arraySort (matches,(ARRAYORDERF)arrayIntcmp);
+  return arrayMax (matches);
+}
+
+
+
+void termMatcher_destroy (TermMatcher *matcher)
+{
+  if (matcher == NULL) {
+    return;
+  }
+  arrayDestroy (matcher->firstChild);
+  arrayDestroy (matcher->nextSibling);
+  arrayDestroy (matcher->label);
+  arrayDestroy (matcher->failure);
+  arrayDestroy (matcher->firstTerm);
+  arrayDestroy (matcher->dictionaryLink);
+  arrayDestroy (matcher->nextTerm);
+  arrayDestroy (matcher->seen);
+  freeMem (matcher);
+}
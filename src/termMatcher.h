@@ -0,0 +1,29 @@
+#ifndef DEF_TERM_MATCHER_H
+#define DEF_TERM_MATCHER_H
+
+#include <bios/format.h>
+
+
+
+/**
+   @file termMatcher.h
+   @brief Case-insensitive search of many terms at once in a text, e.g. the gene descriptions.
+   @details The terms are compiled into an Aho-Corasick automaton, whose states keep only their own transitions, as sorted lists, so that the memory grows with the total length of the terms (about 20 bytes per character) and not with the alphabet; only the root has a complete transition table. A text is scanned once whatever the number of terms, and every term found in it is reported. The matching is the one of strCaseStr(): ASCII letters are compared case-insensitively and an empty term is found in any text.
+ */
+
+
+
+typedef struct _termMatcher TermMatcher;
+
+
+
+/** compile the terms into a matcher. */
+extern TermMatcher* termMatcher_create (Texta terms);
+/** @return the number of different terms found in text; matches is filled with their indices in the Texta of termMatcher_create(), sorted. */
+extern int termMatcher_findAll (TermMatcher* matcher, char* text, Array matches /**< [out] Array of int, cleared first */);
+/** de-allocate the matcher. */
+extern void termMatcher_destroy (TermMatcher* matcher);
+
+
+
+#endif
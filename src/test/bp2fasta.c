@@ -9,6 +9,7 @@
 #include <bios/stringUtil.h>
 
 #include "bp.h"
+#include "metrics.h"
 
 static config *Conf = NULL;
 
@@ -51,7 +52,7 @@ static char* getBreakPointSequence (char *tileCoordinate1, char *tileCoordinate2
   }
   arrayDestroy (targetSeqs);
   stringPrintf (buffer,"rm -rf %s",string (targetsFile));
-  hlr_system (string (buffer),0);
+  metrics_system (string (buffer),0);
   stringDestroy (targetsFile);
   stringDestroy (buffer);
   return string (sequence);
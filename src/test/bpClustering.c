@@ -1,14 +1,14 @@
 #include <stdlib.h>
 #include <unistd.h>
 
-#include <bios/confp.h>
 #include <bios/log.h>
 #include <bios/format.h>
 #include <bios/bowtieParser.h>
 #include <bios/common.h>
-#include <bios/fasta.h>
 
+#include "conf.h"
 #include "bp.h"
+#include "twoBit.h"
 
 typedef struct {
   char* chromosome1;  
@@ -19,49 +19,26 @@ typedef struct {
   int end2; 
 } BreakPointJunction;
 
-static config *Conf = NULL;
+static Conf *conf = NULL;
+static TwoBit *twoBit = NULL;
 
 static char* getBreakPointSequence (char *tileCoordinate1, char *tileCoordinate2)
 {
-  Stringa buffer;
-  Stringa targetsFile;
-  FILE *fp;
-  Array targetSeqs;
-  int i;
-  Seq *currSeq;
   static Stringa sequence = NULL;
+  char *tileSequence;
+  char *tileCoordinates[2];
+  int i;
 
-  buffer = stringCreate (100);
-  targetsFile = stringCreate (100);
-  stringPrintf (targetsFile,"targets_%d.txt",getpid ());
-  if (!(fp = fopen (string (targetsFile),"w")) ){
-    die ("Unable to open target file: %s",string (targetsFile));
-  }
-  fprintf (fp,"%s\n%s",tileCoordinate1,tileCoordinate2);
-  fclose (fp);
-  stringPrintf (buffer,"%s %s/%s stdout -noMask -seqList=%s",
-		confp_get(Conf, "BLAT_TWO_BIT_TO_FA"),
-		confp_get(Conf, "BLAT_DATA_DIR"),
-		confp_get(Conf, "BLAT_TWO_BIT_DATA_FILENAME"),
-		string (targetsFile));
-  fasta_initFromPipe (string (buffer));
-  targetSeqs = fasta_readAllSequences (0);
-  fasta_deInit ();
-  if (arrayMax (targetSeqs) != 2) {
-    die ("Expected only two target sequences");
-  } 
+  tileCoordinates[0] = tileCoordinate1;
+  tileCoordinates[1] = tileCoordinate2;
   stringCreateClear (sequence,100);
-  for (i = 0; i < arrayMax (targetSeqs); i++) {
-    currSeq = arrp (targetSeqs,i,Seq);
-    stringAppendf (sequence,"%s",currSeq->sequence);
-    hlr_free (currSeq->name);
-    hlr_free (currSeq->sequence);
+  for (i = 0; i < 2; i++) {
+    if (!(tileSequence = twoBit_getCoordinates (twoBit,tileCoordinates[i],1))) {
+      die ("Unable to extract the tile from the 2bit file: %s",tileCoordinates[i]);
+    }
+    stringAppendf (sequence,"%s",tileSequence);
+    hlr_free (tileSequence);
   }
-  arrayDestroy (targetSeqs);
-  stringPrintf (buffer,"rm -rf %s",string (targetsFile));
-  hlr_system (string (buffer),0);
-  stringDestroy (targetsFile);
-  stringDestroy (buffer);
   return string (sequence);
 }
 
@@ -108,8 +85,8 @@ int main (int argc, char *argv[])
   BreakPointJunction *currBPJ;
   int i,j;
 
-  if ((Conf = confp_open(getenv("FUSIONSEQ_CONFPATH"))) == NULL)
-    return EXIT_FAILURE;
+  conf = conf_init (argv[0], "BLAT_DATA_DIR", "BLAT_TWO_BIT_DATA_FILENAME", NULL);
+  twoBit = twoBit_open (conf_getPath (conf->blatDataDir,conf->blatTwoBitDataFilename));
 
   bowtieParser_initFromFile ("-");
   bowtieQueries = bowtieParser_getAllQueries ();
@@ -163,7 +140,8 @@ int main (int argc, char *argv[])
     stringDestroy( tileCoordinate2 );
   }
   warn("bpClustering: Number of breakpoint junctions:\t%d",--i);
-  confp_close(Conf);
+  twoBit_close (twoBit);
+  conf_deInit ();
 
   return EXIT_SUCCESS;
 }
@@ -12,9 +12,12 @@
 #include <bios/linestream.h>
 #include <bios/fasta.h>
 
+#include "conf.h"
+#include "metrics.h"
 
 
-#define TWO_BIT_FILE "/home1/lh372/DATA/blat/hg18.2bit"
+
+static Conf *conf = NULL;
 
 
 
@@ -214,13 +217,17 @@ static void simulateReads (Array fusions, int readLength, double millionsOfMappe
     textDestroy (tokens);
   }
   fclose (fp);
-  stringPrintf (buffer,"twoBitToFa %s stdout -noMask -seqList=%s",TWO_BIT_FILE,string (targetsFile));
+  stringPrintf (buffer,"%s %s/%s stdout -noMask -seqList=%s",
+                conf->blatTwoBitToFa,
+                conf->blatDataDir,
+                conf->blatTwoBitDataFilename,
+                string (targetsFile));
   fasta_initFromPipe (string (buffer));
   targetSeqs = fasta_readAllSequences (0);
   fasta_deInit ();
   warn ("Done obtaining read sequences...");
   stringPrintf (buffer,"rm -rf %s",string (targetsFile));
-  hlr_system (string (buffer),0);
+  metrics_system (string (buffer),0);
   fprintf (fp1,"AlignmentBlocks\tSequence\n");
   index = 0;
   for (j = 0; j < arrayMax (readsA); j++) {
@@ -254,6 +261,7 @@ int main (int argc, char *argv[])
   if (argc != 9) {
     usage ("%s <file.interval> <file.expression> <expressionCutoff> <readLength> <millionsOfMappedReads> <fusionFactor> <numFusionsToSimulate> <outputPrefix>",argv[0]);
   }
+  conf = conf_init (argv[0], "BLAT_TWO_BIT_TO_FA", "BLAT_DATA_DIR", "BLAT_TWO_BIT_DATA_FILENAME", NULL);
   srand (time (0));
   intervalFind_addIntervalsToSearchSpace (argv[1],0);
   intervals = intervalFind_parseFile (argv[1],0);
@@ -321,6 +329,7 @@ int main (int argc, char *argv[])
   simulateReads (fusions,readLength,millionsOfMappedReads,fusionFactor,fp1,fp2);
   fclose (fp1);
   fclose (fp2);
+  conf_deInit ();
   return 0;
 }
 
@@ -0,0 +1,247 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <bios/log.h>
+#include <bios/format.h>
+#include <bios/intervalFind.h>
+#include <bios/fasta.h>
+
+#include "gfr.h"
+#include "metrics.h"
+
+/**
+   @file gfrSimulation.c
+   @brief Synthetic GFR and bowtie generator for benchmarking.
+   @details It generates numCandidates fusion candidates between random pairs of transcripts of the annotation, each supported by readsPerCandidate inter-transcript reads. The GFR has the same columns as the output of geneFusions. It also writes the bowtie alignments of the reads against the breakpoint junctions, to be used as input of bowtie2bp.
+   @version 0.8
+   @pre The annotation and the genome, e.g. as generated by mrfSimulation.
+   @param [in] file.interval the annotation in interval format
+   @param [in] file.fa the genome sequence
+   @param [in] numCandidates number of fusion candidates
+   @param [in] readsPerCandidate number of inter-transcript reads per candidate
+   @param [in] readLength read length
+   @param [in] prefix it writes prefix.gfr and prefix.bowtie
+   @param [in] seed (optional) seed of the random number generator, default 1
+ */
+
+
+
+static int sortSeqsByName (Seq *a, Seq *b)
+{
+  return strcmp (a->name,b->name);
+}
+
+
+
+static char* getChromosomeSequence (Array seqs, char *chromosome)
+{
+  Seq testSeq;
+  int index;
+
+  testSeq.name = chromosome;
+  if (!arrayFind (seqs,&testSeq,&index,(ARRAYORDERF)sortSeqsByName)) {
+    die ("Unable to find chromosome: %s",chromosome);
+  }
+  return arrp (seqs,index,Seq)->sequence;
+}
+
+
+
+static int isSameGene (Interval *a, Interval *b)
+{
+  char *pos;
+
+  if (a == b) {
+    return 1;
+  }
+  pos = strchr (a->name,'.');
+  if (pos == NULL) {
+    return strEqual (a->name,b->name);
+  }
+  return strncmp (a->name,b->name,pos - a->name + 1) == 0;
+}
+
+
+
+static SubInterval* chooseExon (Interval *interval, int readLength, int *number)
+{
+  SubInterval *currSI;
+  int i;
+
+  for (i = 0; i < 100; i++) {
+    *number = rand () % arrayMax (interval->subIntervals);
+    currSI = arrp (interval->subIntervals,*number,SubInterval);
+    if ((currSI->end - currSI->start) > readLength) {
+      return currSI;
+    }
+  }
+  return NULL;
+}
+
+
+
+static char* exonCoordinates2string (Array subIntervals)
+{
+  static Stringa buffer = NULL;
+  SubInterval *currSI;
+  int i;
+
+  stringCreateClear (buffer,100);
+  for (i = 0; i < arrayMax (subIntervals); i++) {
+    currSI = arrp (subIntervals,i,SubInterval);
+    stringAppendf (buffer,"%d,%d%s",currSI->start,currSI->end,i < arrayMax (subIntervals) - 1 ? "|" : "");
+  }
+  return string (buffer);
+}
+
+
+
+static void writeHeader (FILE *fp)
+{
+  fprintf (fp,"%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n",
+           GFR_COLUMN_NAME_NUM_INTER,
+           GFR_COLUMN_NAME_INTER_MEAN_AB,
+           GFR_COLUMN_NAME_INTER_MEAN_BA,
+           GFR_COLUMN_NAME_PVALUE_AB,
+           GFR_COLUMN_NAME_PVALUE_BA,
+           GFR_COLUMN_NAME_NUM_INTRA1,
+           GFR_COLUMN_NAME_NUM_INTRA2,
+           GFR_COLUMN_NAME_FUSION_TYPE,
+           GFR_COLUMN_NAME_NAME_TRANSCRIPT1,
+           GFR_COLUMN_NAME_NUM_EXONS_TRANSCRIPT1,
+           GFR_COLUMN_NAME_EXON_COORDINATES_TRANSCRIPT1,
+           GFR_COLUMN_NAME_CHROMOSOME_TRANSCRIPT1,
+           GFR_COLUMN_NAME_STRAND_TRANSCRIPT1,
+           GFR_COLUMN_NAME_START_TRANSCRIPT1,
+           GFR_COLUMN_NAME_END_TRANSCRIPT1,
+           GFR_COLUMN_NAME_NAME_TRANSCRIPT2,
+           GFR_COLUMN_NAME_NUM_EXONS_TRANSCRIPT2,
+           GFR_COLUMN_NAME_EXON_COORDINATES_TRANSCRIPT2,
+           GFR_COLUMN_NAME_CHROMOSOME_TRANSCRIPT2,
+           GFR_COLUMN_NAME_STRAND_TRANSCRIPT2,
+           GFR_COLUMN_NAME_START_TRANSCRIPT2,
+           GFR_COLUMN_NAME_END_TRANSCRIPT2,
+           GFR_COLUMN_NAME_INTER_READS,
+           GFR_COLUMN_NAME_ID,
+           GFR_COLUMN_NAME_READS_TRANSCRIPT1,
+           GFR_COLUMN_NAME_READS_TRANSCRIPT2);
+}
+
+
+
+static void writeTranscript (FILE *fp, Interval *currInterval)
+{
+  fprintf (fp,"%s\t%d\t%s\t%s\t%c\t%d\t%d\t",
+           currInterval->name,
+           arrayMax (currInterval->subIntervals),
+           exonCoordinates2string (currInterval->subIntervals),
+           currInterval->chromosome,
+           currInterval->strand,
+           currInterval->start,
+           currInterval->end);
+}
+
+
+
+int main (int argc, char *argv[])
+{
+  Array intervals,seqs;
+  Interval *transcript1,*transcript2;
+  SubInterval *exon1,*exon2;
+  Stringa buffer,interReads,reads1,reads2,qualities;
+  FILE *fpGfr,*fpBowtie;
+  char *sequence1,*sequence2;
+  int numCandidates,readsPerCandidate,readLength;
+  int number1,number2,start1,start2,offset;
+  int i,j;
+
+  if (argc != 7 && argc != 8) {
+    usage ("%s <file.interval> <file.fa> <numCandidates> <readsPerCandidate> <readLength> <prefix> [seed]",argv[0]);
+  }
+  metrics_init (argv[0]);
+  numCandidates = atoi (argv[3]);
+  readsPerCandidate = atoi (argv[4]);
+  readLength = atoi (argv[5]);
+  srand (argc == 8 ? atoi (argv[7]) : 1);
+  intervals = intervalFind_parseFile (argv[1],0);
+  if (arrayMax (intervals) < 2) {
+    die ("Expected at least two transcripts: %s",argv[1]);
+  }
+  fasta_initFromFile (argv[2]);
+  seqs = fasta_readAllSequences (1);
+  fasta_deInit ();
+  arraySort (seqs,(ARRAYORDERF)sortSeqsByName);
+  buffer = stringCreate (100);
+  stringPrintf (buffer,"%s.gfr",argv[6]);
+  if (!(fpGfr = fopen (string (buffer),"w"))) {
+    die ("Unable to open file: %s",string (buffer));
+  }
+  stringPrintf (buffer,"%s.bowtie",argv[6]);
+  if (!(fpBowtie = fopen (string (buffer),"w"))) {
+    die ("Unable to open file: %s",string (buffer));
+  }
+  interReads = stringCreate (1000);
+  reads1 = stringCreate (1000);
+  reads2 = stringCreate (1000);
+  qualities = stringCreate (readLength + 1);
+  for (j = 0; j < readLength; j++) {
+    stringCatChar (qualities,'I');
+  }
+  writeHeader (fpGfr);
+  i = 0;
+  while (i < numCandidates) {
+    transcript1 = arrp (intervals,rand () % arrayMax (intervals),Interval);
+    transcript2 = arrp (intervals,rand () % arrayMax (intervals),Interval);
+    if (isSameGene (transcript1,transcript2)) {
+      continue;
+    }
+    exon1 = chooseExon (transcript1,readLength,&number1);
+    exon2 = chooseExon (transcript2,readLength,&number2);
+    if (exon1 == NULL || exon2 == NULL) {
+      continue;
+    }
+    sequence1 = getChromosomeSequence (seqs,transcript1->chromosome);
+    sequence2 = getChromosomeSequence (seqs,transcript2->chromosome);
+    stringClear (interReads);
+    stringClear (reads1);
+    stringClear (reads2);
+    for (j = 0; j < readsPerCandidate; j++) {
+      start1 = exon1->start + rand () % (exon1->end - exon1->start - readLength + 1);
+      start2 = exon2->start + rand () % (exon2->end - exon2->start - readLength + 1);
+      stringAppendf (interReads,"%s%d,%d,%d,%d,%d,%d,%d",j > 0 ? "|" : "",GFR_PAIR_TYPE_EXONIC_EXONIC,number1,number2,
+                     start1,start1 + readLength - 1,start2,start2 + readLength - 1);
+      stringAppendf (reads1,"%s%.*s",j > 0 ? "|" : "",readLength,sequence1 + start1 - 1);
+      stringAppendf (reads2,"%s%.*s",j > 0 ? "|" : "",readLength,sequence2 + start2 - 1);
+      // junction read: the end of exon1 followed by the beginning of exon2
+      offset = 1 + rand () % (readLength - 1);
+      fprintf (fpBowtie,"%s_%05d_%d\t+\t%s:%d-%d|%s:%d-%d\t%d\t%.*s%.*s\t%s\t0\t\n",
+               argv[6],i + 1,j,
+               transcript1->chromosome,exon1->end - readLength,exon1->end,
+               transcript2->chromosome,exon2->start - 1,exon2->start - 1 + readLength,
+               readLength - offset,
+               offset,sequence1 + exon1->end - offset,
+               readLength - offset,sequence2 + exon2->start - 1,
+               string (qualities));
+    }
+    fprintf (fpGfr,"%.2f\t%.2f\t%.2f\t%.5f\t%.5f\t%.2f\t%.2f\t%s\t",
+             (double)readsPerCandidate,
+             100.0 + rand () % 200,100.0 + rand () % 200,
+             (double)rand () / RAND_MAX,(double)rand () / RAND_MAX,
+             (double)(rand () % 1000),(double)(rand () % 1000),
+             strEqual (transcript1->chromosome,transcript2->chromosome) ? "cis" : "trans");
+    writeTranscript (fpGfr,transcript1);
+    writeTranscript (fpGfr,transcript2);
+    fprintf (fpGfr,"%s\t%s_%05d\t%s\t%s\n",string (interReads),argv[6],i + 1,string (reads1),string (reads2));
+    metrics_addEntriesOut (1);
+    i++;
+  }
+  fclose (fpGfr);
+  fclose (fpBowtie);
+  stringDestroy (buffer);
+  stringDestroy (interReads);
+  stringDestroy (reads1);
+  stringDestroy (reads2);
+  stringDestroy (qualities);
+  warn ("%s_numGfrEntries: %d",argv[0],numCandidates);
+  return 0;
+}
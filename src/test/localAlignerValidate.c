@@ -0,0 +1,129 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <bios/log.h>
+#include <bios/format.h>
+
+#include "localAligner.h"
+
+/**
+   @file localAlignerValidate.c
+   @brief Check of the Smith-Waterman kernel of localAligner against the scalar one.
+   @details It generates numCases pairs of sequences and aligns each of them with the kernel used by localAligner_align() (the striped SSE2 one when available) and with the scalar Gotoh kernel. The pairs are of three kinds, in turn: unrelated random sequences; a read taken from the target with mismatches and Ns; a read taken from the target with insertions and deletions of 1 to 8 bases, which exercise the vertical gaps of the lazy F loop. The pairs with different scores or end positions are printed, one per line: kind, score, scalar score, query, target.
+   @version 0.8
+   @pre none
+   @param [in] numCases number of pairs
+   @param [in] seed (optional) seed of the random number generator, default 1
+   @remarks WARNings summarize the results; the exit status is 1 if a pair differs.
+ */
+
+
+
+#define MAX_READ_SIZE 150
+#define MAX_TARGET_SIZE 400
+#define MAX_GAP_SIZE 8
+
+
+
+static char randomNucleotide (void)
+{
+  static const char nucleotides[] = "ACGT";
+
+  return nucleotides[rand () % 4];
+}
+
+
+
+static int randomRange (int min, int max)
+{
+  return min + rand () % (max - min + 1);
+}
+
+
+
+static void randomSequence (Stringa sequence, int size)
+{
+  int i;
+
+  stringClear (sequence);
+  for (i = 0; i < size; i++) {
+    stringCatChar (sequence,randomNucleotide ());
+  }
+}
+
+
+
+/// read of about readSize bases from a random position of the target, with mismatches and Ns, and with indels if gapped is 1
+static void mutatedRead (Stringa read, char *target, int readSize, int gapped)
+{
+  int start,i,j,numEdits;
+
+  stringClear (read);
+  start = rand () % (strlen (target) - readSize + 1);
+  numEdits = randomRange (0,readSize / 10);
+  for (i = start; i < start + readSize; i++) {
+    if (gapped && rand () % readSize < numEdits) {
+      if (rand () % 2) {
+        i += randomRange (1,MAX_GAP_SIZE) - 1; // deletion from the read
+        continue;
+      }
+      for (j = randomRange (1,MAX_GAP_SIZE); j > 0; j--) {
+        stringCatChar (read,randomNucleotide ()); // insertion in the read
+      }
+    }
+    if (!gapped && rand () % readSize < numEdits) {
+      stringCatChar (read,rand () % 5 == 0 ? 'N' : randomNucleotide ());
+      continue;
+    }
+    stringCatChar (read,target[i]);
+  }
+  if (stringLen (read) == 0) {
+    stringCatChar (read,target[start]);
+  }
+}
+
+
+
+int main (int argc, char *argv[])
+{
+  Stringa read,target;
+  int numCases,kind,i;
+  int score,scalarScore,qEnd,tEnd,scalarQEnd,scalarTEnd;
+  int countDifferent,countGapped;
+
+  if (argc < 2) {
+    usage ("%s <numCases> [seed]",argv[0]);
+  }
+  numCases = atoi (argv[1]);
+  srand (argc > 2 ? atoi (argv[2]) : 1);
+  read = stringCreate (MAX_READ_SIZE);
+  target = stringCreate (MAX_TARGET_SIZE);
+  countDifferent = 0;
+  countGapped = 0;
+  for (i = 0; i < numCases; i++) {
+    kind = i % 3;
+    randomSequence (target,randomRange (MAX_READ_SIZE,MAX_TARGET_SIZE));
+    if (kind == 0) {
+      randomSequence (read,randomRange (1,MAX_READ_SIZE));
+    }
+    else {
+      mutatedRead (read,string (target),randomRange (20,MAX_READ_SIZE),kind == 2);
+    }
+    score = localAligner_computeScore (string (read),string (target),0,&qEnd,&tEnd);
+    scalarScore = localAligner_computeScore (string (read),string (target),1,&scalarQEnd,&scalarTEnd);
+    if (kind == 2 && strstr (string (target),string (read)) == NULL) {
+      countGapped++;
+    }
+    if (score != scalarScore || qEnd != scalarQEnd || tEnd != scalarTEnd) {
+      printf ("%s\t%d\t%d\t%s\t%s\n",kind == 0 ? "random" : kind == 1 ? "mismatches" : "gaps",score,scalarScore,string (read),string (target));
+      countDifferent++;
+    }
+  }
+  stringDestroy (read);
+  stringDestroy (target);
+  warn ("%s_numCases: %d",argv[0],numCases);
+  warn ("%s_numGappedCases: %d",argv[0],countGapped);
+  warn ("%s_numDifferent: %d",argv[0],countDifferent);
+  return countDifferent > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -5,6 +5,13 @@
 #include <bios/intervalFind.h>
 #include <mrf/mrf.h>
 
+#include "intervalIndex.h"
+#include "conf.h"
+
+
+
+static IntervalIndex *pseudogeneIndex = NULL;
+
 
 
 static int readIsContainedInPseudogene (MrfRead *currMrfRead)
@@ -18,7 +25,7 @@ static int readIsContainedInPseudogene (MrfRead *currMrfRead)
     die ("Expected only one alignment block for each end of paired-end read!");
   }
   currMrfBlock = arrp (currMrfRead->blocks,0,MrfBlock);
-  intervals = intervalFind_getOverlappingIntervals (currMrfBlock->targetName,currMrfBlock->targetStart,currMrfBlock->targetEnd);
+  intervals = intervalIndex_getOverlappingIntervals (pseudogeneIndex,currMrfBlock->targetName,currMrfBlock->targetStart,currMrfBlock->targetEnd);
   for (i = 0; i < arrayMax (intervals); i++) {
     currInterval = arru (intervals,i,Interval*);
     if (currInterval->start <= currMrfBlock->targetStart && currMrfBlock->targetEnd <= currInterval->end) {
@@ -49,7 +56,8 @@ int main (int argc, char *argv[])
     die ("Unable to open output files");
   }
   i = 0;
-  intervalFind_addIntervalsToSearchSpace (argv[2],0);
+  conf_initOptional (argv[0]); // only for the annotation pack, if any
+  pseudogeneIndex = intervalIndex_open (argv[2],0);
   mrf_init ("-");
   while (currMrfEntry = mrf_nextEntry ()) {
     if (readIsContainedInPseudogene (&currMrfEntry->read1) || readIsContainedInPseudogene (&currMrfEntry->read2)) {
@@ -66,8 +74,10 @@ int main (int argc, char *argv[])
     }
   }
   mrf_deInit ();
+  intervalIndex_close (pseudogeneIndex);
   stringDestroy (buffer);
   fclose (fp1);
   fclose (fp2);
+  conf_deInit ();
   return 0;
 }
@@ -0,0 +1,339 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <bios/log.h>
+#include <bios/format.h>
+
+#include "metrics.h"
+
+/**
+   @file mrfSimulation.c
+   @brief Synthetic genome, annotation and MRF generator for benchmarking.
+   @details It generates a random genome with numGenes genes (numIsoforms transcripts per gene, obtained by exon skipping), the corresponding annotation in interval format and numPairs paired-end reads in MRF format. A fraction chimericFraction of the pairs connects two different genes. No real data is needed: the output can be used as TRANSCRIPT_COMPOSITE_MODEL_FILENAME and as input of geneFusions.
+   @version 0.8
+   @pre none
+   @param [in] numGenes number of genes
+   @param [in] numIsoforms number of transcripts per gene
+   @param [in] numPairs number of paired-end reads
+   @param [in] chimericFraction fraction of inter-gene pairs
+   @param [in] readLength read length
+   @param [in] prefix it writes prefix.fa, prefix.interval and prefix.mrf
+   @param [in] seed (optional) seed of the random number generator, default 1
+ */
+
+
+
+#define GENES_PER_CHROMOSOME 500
+#define INTERGENIC_SIZE 5000
+#define FRAGMENT_SIZE 300
+
+
+
+typedef struct {
+  int start;
+  int end;
+} Exon;
+
+
+
+typedef struct {
+  int chromosome;
+  char strand;
+  Array exons; // of type Exon
+  Array transcripts; // of type Array of Exon
+} Gene;
+
+
+
+static char randomNucleotide (void)
+{
+  static char nucleotides[] = "ACGT";
+
+  return nucleotides[rand () % 4];
+}
+
+
+
+static int randomRange (int min, int max)
+{
+  return min + rand () % (max - min + 1);
+}
+
+
+
+static char complement (char c)
+{
+  switch (c) {
+  case 'A': return 'T';
+  case 'C': return 'G';
+  case 'G': return 'C';
+  case 'T': return 'A';
+  }
+  return 'N';
+}
+
+
+
+static Array generateGenes (int numGenes, int numIsoforms, Texta chromosomes)
+{
+  Array genes;
+  Gene *currGene;
+  Exon *currExon;
+  Array transcript;
+  Stringa sequence;
+  int i,j,k,numExons,skip,pos;
+
+  genes = arrayCreate (numGenes,Gene);
+  sequence = NULL;
+  pos = 0;
+  for (i = 0; i < numGenes; i++) {
+    if (i % GENES_PER_CHROMOSOME == 0) {
+      if (sequence != NULL) {
+        textAdd (chromosomes,string (sequence));
+        stringDestroy (sequence);
+      }
+      sequence = stringCreate (GENES_PER_CHROMOSOME * INTERGENIC_SIZE * 4);
+      pos = 0;
+    }
+    currGene = arrayp (genes,arrayMax (genes),Gene);
+    currGene->chromosome = arrayMax (chromosomes);
+    currGene->strand = rand () % 2 ? '+' : '-';
+    currGene->exons = arrayCreate (10,Exon);
+    pos += randomRange (INTERGENIC_SIZE / 2,INTERGENIC_SIZE);
+    numExons = randomRange (3,10);
+    for (j = 0; j < numExons; j++) {
+      if (j > 0) {
+        pos += randomRange (200,2000);
+      }
+      currExon = arrayp (currGene->exons,arrayMax (currGene->exons),Exon);
+      currExon->start = pos + 1;
+      pos += randomRange (100,300);
+      currExon->end = pos;
+    }
+    while (stringLen (sequence) < pos + INTERGENIC_SIZE) {
+      stringCatChar (sequence,randomNucleotide ());
+    }
+    currGene->transcripts = arrayCreate (numIsoforms,Array);
+    for (k = 0; k < numIsoforms; k++) {
+      transcript = arrayCreate (numExons,Exon);
+      skip = k == 0 ? -1 : randomRange (1,numExons - 2);
+      for (j = 0; j < numExons; j++) {
+        if (j != skip) {
+          array (transcript,arrayMax (transcript),Exon) = arru (currGene->exons,j,Exon);
+        }
+      }
+      array (currGene->transcripts,arrayMax (currGene->transcripts),Array) = transcript;
+    }
+  }
+  if (sequence != NULL) {
+    textAdd (chromosomes,string (sequence));
+    stringDestroy (sequence);
+  }
+  return genes;
+}
+
+
+
+static void writeGenome (Texta chromosomes, char *prefix)
+{
+  Stringa buffer;
+  FILE *fp;
+  char *sequence;
+  int i,j;
+
+  buffer = stringCreate (100);
+  stringPrintf (buffer,"%s.fa",prefix);
+  if (!(fp = fopen (string (buffer),"w"))) {
+    die ("Unable to open file: %s",string (buffer));
+  }
+  for (i = 0; i < arrayMax (chromosomes); i++) {
+    fprintf (fp,">chrS%d\n",i + 1);
+    sequence = textItem (chromosomes,i);
+    for (j = 0; sequence[j] != '\0'; j += 60) {
+      fprintf (fp,"%.60s\n",sequence + j);
+    }
+  }
+  fclose (fp);
+  stringDestroy (buffer);
+}
+
+
+
+static void writeAnnotation (Array genes, char *prefix)
+{
+  Stringa buffer;
+  FILE *fp;
+  Gene *currGene;
+  Array transcript;
+  int i,j,k;
+
+  buffer = stringCreate (100);
+  stringPrintf (buffer,"%s.interval",prefix);
+  if (!(fp = fopen (string (buffer),"w"))) {
+    die ("Unable to open file: %s",string (buffer));
+  }
+  for (i = 0; i < arrayMax (genes); i++) {
+    currGene = arrp (genes,i,Gene);
+    for (k = 0; k < arrayMax (currGene->transcripts); k++) {
+      transcript = arru (currGene->transcripts,k,Array);
+      fprintf (fp,"bench%d.%d\tchrS%d\t%c\t%d\t%d\t%d\t",i + 1,k + 1,currGene->chromosome + 1,currGene->strand,
+               arrp (transcript,0,Exon)->start,arrp (transcript,arrayMax (transcript) - 1,Exon)->end,arrayMax (transcript));
+      for (j = 0; j < arrayMax (transcript); j++) {
+        fprintf (fp,"%d%s",arrp (transcript,j,Exon)->start,j < arrayMax (transcript) - 1 ? "," : "\t");
+      }
+      for (j = 0; j < arrayMax (transcript); j++) {
+        fprintf (fp,"%d%s",arrp (transcript,j,Exon)->end,j < arrayMax (transcript) - 1 ? "," : "\n");
+      }
+    }
+  }
+  fclose (fp);
+  stringDestroy (buffer);
+}
+
+
+
+static int getTranscriptLength (Array transcript)
+{
+  int i,length;
+
+  length = 0;
+  for (i = 0; i < arrayMax (transcript); i++) {
+    length += arrp (transcript,i,Exon)->end - arrp (transcript,i,Exon)->start + 1;
+  }
+  return length;
+}
+
+
+
+/**
+   Converts a read starting at offset (0-based, transcript coordinates) into MRF blocks and the read sequence.
+ */
+static void addRead (Stringa blocks, Stringa sequence, Array transcript, int chromosome, char *chromosomeSequence, int offset, int readLength, char strand)
+{
+  Exon *currExon;
+  int i,start,size,queryStart,first;
+  Stringa forward;
+
+  forward = stringCreate (readLength + 1);
+  queryStart = 1;
+  first = 1;
+  for (i = 0; i < arrayMax (transcript) && queryStart <= readLength; i++) {
+    currExon = arrp (transcript,i,Exon);
+    size = currExon->end - currExon->start + 1;
+    if (offset >= size) {
+      offset -= size;
+      continue;
+    }
+    start = currExon->start + offset;
+    size = MIN (currExon->end - start + 1,readLength - queryStart + 1);
+    stringAppendf (blocks,"%schrS%d:%c:%d:%d:%d:%d",first ? "" : ",",chromosome + 1,strand,start,start + size - 1,queryStart,queryStart + size - 1);
+    stringAppendf (forward,"%.*s",size,chromosomeSequence + start - 1);
+    queryStart += size;
+    offset = 0;
+    first = 0;
+  }
+  if (strand == '+') {
+    stringAppendf (sequence,"%s",string (forward));
+  }
+  else {
+    for (i = stringLen (forward) - 1; i >= 0; i--) {
+      stringCatChar (sequence,complement (string (forward)[i]));
+    }
+  }
+  stringDestroy (forward);
+}
+
+
+
+static void writeReads (Array genes, Texta chromosomes, int numPairs, double chimericFraction, int readLength, char *prefix)
+{
+  Stringa buffer,blocks,sequences;
+  FILE *fp;
+  Gene *geneA,*geneB;
+  Array transcriptA,transcriptB;
+  int i,lengthA,lengthB,offset;
+
+  buffer = stringCreate (100);
+  blocks = stringCreate (100);
+  sequences = stringCreate (100);
+  stringPrintf (buffer,"%s.mrf",prefix);
+  if (!(fp = fopen (string (buffer),"w"))) {
+    die ("Unable to open file: %s",string (buffer));
+  }
+  fprintf (fp,"AlignmentBlocks\tSequence\n");
+  i = 0;
+  while (i < numPairs) {
+    geneA = arrp (genes,rand () % arrayMax (genes),Gene);
+    transcriptA = arru (geneA->transcripts,rand () % arrayMax (geneA->transcripts),Array);
+    lengthA = getTranscriptLength (transcriptA);
+    if ((double)rand () / RAND_MAX < chimericFraction) {
+      geneB = arrp (genes,rand () % arrayMax (genes),Gene);
+      if (geneA == geneB) {
+        continue;
+      }
+      transcriptB = arru (geneB->transcripts,rand () % arrayMax (geneB->transcripts),Array);
+      lengthB = getTranscriptLength (transcriptB);
+      if (lengthA < readLength || lengthB < readLength) {
+        continue;
+      }
+      stringClear (blocks);
+      stringClear (sequences);
+      addRead (blocks,sequences,transcriptA,geneA->chromosome,textItem (chromosomes,geneA->chromosome),randomRange (0,lengthA - readLength),readLength,'+');
+      stringCatChar (blocks,'|');
+      stringCatChar (sequences,'|');
+      addRead (blocks,sequences,transcriptB,geneB->chromosome,textItem (chromosomes,geneB->chromosome),randomRange (0,lengthB - readLength),readLength,'-');
+    }
+    else {
+      if (lengthA < FRAGMENT_SIZE) {
+        continue;
+      }
+      offset = randomRange (0,lengthA - FRAGMENT_SIZE);
+      stringClear (blocks);
+      stringClear (sequences);
+      addRead (blocks,sequences,transcriptA,geneA->chromosome,textItem (chromosomes,geneA->chromosome),offset,readLength,'+');
+      stringCatChar (blocks,'|');
+      stringCatChar (sequences,'|');
+      addRead (blocks,sequences,transcriptA,geneA->chromosome,textItem (chromosomes,geneA->chromosome),offset + FRAGMENT_SIZE - readLength,readLength,'-');
+    }
+    fprintf (fp,"%s\t%s\n",string (blocks),string (sequences));
+    metrics_addEntriesOut (1);
+    i++;
+  }
+  fclose (fp);
+  stringDestroy (buffer);
+  stringDestroy (blocks);
+  stringDestroy (sequences);
+}
+
+
+
+int main (int argc, char *argv[])
+{
+  Array genes;
+  Texta chromosomes;
+  int numGenes,numIsoforms,numPairs,readLength;
+  double chimericFraction;
+
+  if (argc != 7 && argc != 8) {
+    usage ("%s <numGenes> <numIsoforms> <numPairs> <chimericFraction> <readLength> <prefix> [seed]",argv[0]);
+  }
+  metrics_init (argv[0]);
+  numGenes = atoi (argv[1]);
+  numIsoforms = atoi (argv[2]);
+  numPairs = atoi (argv[3]);
+  chimericFraction = atof (argv[4]);
+  readLength = atoi (argv[5]);
+  if (numGenes < 2 || numIsoforms < 1 || readLength < 10 || readLength > FRAGMENT_SIZE / 2) {
+    die ("Invalid arguments: numGenes >= 2, numIsoforms >= 1, 10 <= readLength <= %d",FRAGMENT_SIZE / 2);
+  }
+  srand (argc == 8 ? atoi (argv[7]) : 1);
+  chromosomes = textCreate (numGenes / GENES_PER_CHROMOSOME + 1);
+  genes = generateGenes (numGenes,numIsoforms,chromosomes);
+  writeGenome (chromosomes,argv[6]);
+  writeAnnotation (genes,argv[6]);
+  writeReads (genes,chromosomes,numPairs,chimericFraction,readLength,argv[6]);
+  warn ("%s_numGenes: %d",argv[0],numGenes);
+  warn ("%s_numChromosomes: %d",argv[0],arrayMax (chromosomes));
+  warn ("%s_numPairs: %d",argv[0],numPairs);
+  return 0;
+}
@@ -10,7 +10,7 @@
 
 int main (int argc, char *argv[])
 {
-	Array kgXrefs;
+	KgXrefTable *kgXrefs;
 	Stringa buffer;
 	LineStream ls;
 	int count=0;
@@ -29,8 +29,7 @@ int main (int argc, char *argv[])
 	stringPrintf (buffer,"%s/%s",
 		      confp_get(conf, "ANNOTATION_DIR"),
 		      confp_get(conf, "KNOWN_GENE_XREF_FILENAME"));
-	kgXrefs = util_readKnownGeneXrefs (string (buffer));
-	arraySort (kgXrefs,(ARRAYORDERF)sortKgXrefsByTranscriptName);
+	kgXrefs = kgXrefTable_open (string (buffer));
 	stringDestroy (buffer);
 
 	//  gfr_init ("-");
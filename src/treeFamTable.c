@@ -0,0 +1,347 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <bios/log.h>
+#include <bios/format.h>
+
+#include "annotationPack.h"
+#include "treeFamTable.h"
+#include "util.h"
+#include "uthash.h"
+
+
+
+#define TREE_FAM_TABLE_MAGIC "FSTRFAM1"
+
+
+
+/**
+   Header of a table, followed by the entries, the slots and the transcript names, each section padded to 8 bytes.
+*/
+typedef struct {
+  char magic[8];
+  uint32_t numEntries;
+  uint32_t numSlots; // power of 2
+  uint32_t numFamilies;
+  uint32_t namesSize;
+} TableHeader;
+
+
+
+typedef struct {
+  uint32_t transcriptName; // offset in the names
+  uint32_t length; // of the transcript name
+  int32_t family;
+  uint32_t reserved;
+} TableEntry;
+
+
+
+typedef struct {
+  char *treeFamId;
+  int family;
+  UT_hash_handle hh;
+} FamilyNumber;
+
+
+
+struct _treeFamTable {
+  unsigned char *data;
+  size_t dataSize;
+  int isMapped;
+  int isBorrowed; // section of the annotation pack
+  TableHeader *header;
+  TableEntry *entries;
+  uint32_t *slots; // index of the entry + 1, 0 if empty
+  char *names;
+};
+
+
+
+static size_t treeFamTable_pad (size_t size)
+{
+  return (size + 7) & ~(size_t)7;
+}
+
+
+
+static size_t treeFamTable_getSize (TableHeader *header)
+{
+  return treeFamTable_pad (sizeof (TableHeader)) +
+    treeFamTable_pad ((size_t)header->numEntries * sizeof (TableEntry)) +
+    treeFamTable_pad ((size_t)header->numSlots * sizeof (uint32_t)) +
+    treeFamTable_pad (header->namesSize);
+}
+
+
+
+static void treeFamTable_setSections (TreeFamTable *table)
+{
+  unsigned char *pos;
+
+  table->header = (TableHeader*)table->data;
+  pos = table->data + treeFamTable_pad (sizeof (TableHeader));
+  table->entries = (TableEntry*)pos;
+  pos += treeFamTable_pad ((size_t)table->header->numEntries * sizeof (TableEntry));
+  table->slots = (uint32_t*)pos;
+  pos += treeFamTable_pad ((size_t)table->header->numSlots * sizeof (uint32_t));
+  table->names = (char*)pos;
+}
+
+
+
+static void treeFamTable_check (TreeFamTable *table, char *fileName)
+{
+  if (table->dataSize < sizeof (TableHeader) || memcmp (table->data,TREE_FAM_TABLE_MAGIC,8) != 0 || treeFamTable_getSize ((TableHeader*)table->data) != table->dataSize) {
+    die ("Not a valid TreeFam table: %s",fileName);
+  }
+  treeFamTable_setSections (table);
+}
+
+
+
+static uint32_t treeFamTable_hash (char *key, int length)
+{
+  uint32_t hash;
+  int i;
+
+  // FNV-1a
+  hash = 2166136261u;
+  for (i = 0; i < length; i++) {
+    hash ^= (unsigned char)key[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+
+
+static TableEntry* treeFamTable_find (TreeFamTable *table, char *transcriptName, int length)
+{
+  TableEntry *currEntry;
+  uint32_t slot,mask;
+
+  mask = table->header->numSlots - 1;
+  for (slot = treeFamTable_hash (transcriptName,length) & mask; table->slots[slot] != 0; slot = (slot + 1) & mask) {
+    currEntry = table->entries + table->slots[slot] - 1;
+    if (currEntry->length == (uint32_t)length && strncmp (table->names + currEntry->transcriptName,transcriptName,length) == 0) {
+      return currEntry;
+    }
+  }
+  return NULL;
+}
+
+
+
+int treeFamTable_isCompiled (char *fileName)
+{
+  char magic[8];
+  FILE *fp;
+  int isCompiled;
+
+  if ((fp = fopen (fileName,"r")) == NULL) {
+    die ("Unable to open file: %s",fileName);
+  }
+  isCompiled = fread (magic,1,sizeof (magic),fp) == sizeof (magic) && memcmp (magic,TREE_FAM_TABLE_MAGIC,sizeof (magic)) == 0;
+  fclose (fp);
+  return isCompiled;
+}
+
+
+
+static void treeFamTable_map (TreeFamTable *table, char *fileName)
+{
+  struct stat info;
+  int fd;
+
+  if ((fd = open (fileName,O_RDONLY)) < 0 || fstat (fd,&info) != 0) {
+    die ("Unable to open the TreeFam table: %s",fileName);
+  }
+  table->dataSize = info.st_size;
+  table->data = (unsigned char*)mmap (NULL,table->dataSize,PROT_READ,MAP_SHARED,fd,0);
+  close (fd);
+  if (table->data == MAP_FAILED) {
+    die ("Unable to map the TreeFam table: %s",fileName);
+  }
+  table->isMapped = 1;
+  treeFamTable_check (table,fileName);
+}
+
+
+
+void* treeFamTable_compileInMemory (char *fileName, size_t *size)
+{
+  TreeFamTable table;
+  TableHeader header;
+  TableEntry *currEntry;
+  FamilyNumber *familyNumbers,*currFamily,*tmp;
+  Array kgTreeFams;
+  KgTreeFam *currKgTreeFam;
+  unsigned char *data;
+  uint32_t slot;
+  int i;
+
+  if (treeFamTable_isCompiled (fileName)) {
+    memset (&table,0,sizeof (table));
+    treeFamTable_map (&table,fileName);
+    data = (unsigned char*)hlr_malloc (table.dataSize);
+    memcpy (data,table.data,table.dataSize);
+    munmap (table.data,table.dataSize);
+    *size = table.dataSize;
+    return data;
+  }
+  kgTreeFams = util_readKnownGeneTreeFams (fileName);
+  memset (&header,0,sizeof (header));
+  memcpy (header.magic,TREE_FAM_TABLE_MAGIC,sizeof (header.magic));
+  header.numEntries = arrayMax (kgTreeFams);
+  for (header.numSlots = 1; header.numSlots < 2 * header.numEntries + 1; header.numSlots *= 2) {
+  }
+  for (i = 0; i < arrayMax (kgTreeFams); i++) {
+    header.namesSize += strlen (arrp (kgTreeFams,i,KgTreeFam)->transcriptName) + 1;
+  }
+  memset (&table,0,sizeof (table));
+  table.dataSize = treeFamTable_getSize (&header);
+  table.data = (unsigned char*)hlr_calloc (table.dataSize,1);
+  memcpy (table.data,&header,sizeof (header));
+  treeFamTable_setSections (&table);
+  table.header->numEntries = 0;
+  table.header->namesSize = 0;
+  familyNumbers = NULL;
+  for (i = 0; i < arrayMax (kgTreeFams); i++) {
+    currKgTreeFam = arrp (kgTreeFams,i,KgTreeFam);
+    // the first line of a transcript is kept
+    if (treeFamTable_find (&table,currKgTreeFam->transcriptName,strlen (currKgTreeFam->transcriptName)) != NULL) {
+      continue;
+    }
+    HASH_FIND_STR (familyNumbers,currKgTreeFam->treeFamId,currFamily);
+    if (currFamily == NULL) {
+      AllocVar (currFamily);
+      currFamily->treeFamId = currKgTreeFam->treeFamId;
+      currFamily->family = table.header->numFamilies++;
+      HASH_ADD_KEYPTR (hh,familyNumbers,currFamily->treeFamId,strlen (currFamily->treeFamId),currFamily);
+    }
+    currEntry = table.entries + table.header->numEntries++;
+    currEntry->transcriptName = table.header->namesSize;
+    currEntry->length = strlen (currKgTreeFam->transcriptName);
+    currEntry->family = currFamily->family;
+    strcpy (table.names + table.header->namesSize,currKgTreeFam->transcriptName);
+    table.header->namesSize += currEntry->length + 1;
+    for (slot = treeFamTable_hash (currKgTreeFam->transcriptName,currEntry->length) & (header.numSlots - 1); table.slots[slot] != 0; slot = (slot + 1) & (header.numSlots - 1)) {
+    }
+    table.slots[slot] = table.header->numEntries;
+  }
+  // the sizes of the sections stay as allocated: the entries and names left for the duplicated transcripts are empty
+  table.header->numEntries = header.numEntries;
+  table.header->namesSize = header.namesSize;
+  HASH_ITER (hh,familyNumbers,currFamily,tmp) {
+    HASH_DEL (familyNumbers,currFamily);
+    freeMem (currFamily);
+  }
+  for (i = 0; i < arrayMax (kgTreeFams); i++) {
+    currKgTreeFam = arrp (kgTreeFams,i,KgTreeFam);
+    hlr_free (currKgTreeFam->transcriptName);
+    hlr_free (currKgTreeFam->treeFamId);
+  }
+  arrayDestroy (kgTreeFams);
+  *size = table.dataSize;
+  return table.data;
+}
+
+
+
+TreeFamTable* treeFamTable_open (char *fileName)
+{
+  TreeFamTable *table;
+  size_t size;
+
+  AllocVar (table);
+  if ((table->data = (unsigned char*)annotationPack_getSection (fileName,&size)) != NULL) {
+    table->dataSize = size;
+    table->isBorrowed = 1;
+    treeFamTable_check (table,fileName);
+  }
+  else if (treeFamTable_isCompiled (fileName)) {
+    treeFamTable_map (table,fileName);
+  }
+  else {
+    table->data = (unsigned char*)treeFamTable_compileInMemory (fileName,&table->dataSize);
+    treeFamTable_check (table,fileName);
+  }
+  return table;
+}
+
+
+
+int treeFamTable_lookup (TreeFamTable *table, char *transcriptName, int length)
+{
+  TableEntry *currEntry;
+
+  if ((currEntry = treeFamTable_find (table,transcriptName,length)) == NULL) {
+    return -1;
+  }
+  return currEntry->family;
+}
+
+
+
+void treeFamTable_getFamilies (TreeFamTable *table, char *transcriptNames, Array families)
+{
+  char *token,*end;
+  int family;
+
+  arrayClear (families);
+  for (token = transcriptNames; token != NULL; token = *end == '|' ? end + 1 : NULL) {
+    for (end = token; *end != '|' && *end != '\0'; end++) {
+    }
+    if ((family = treeFamTable_lookup (table,token,end - token)) >= 0) {
+      array (families,arrayMax (families),int) = family;
+    }
+  }
+  arraySort (families,(ARRAYORDERF)arrayIntcmp);
+  arrayUniq (families,NULL,(ARRAYORDERF)arrayIntcmp);
+}
+
+
+
+int treeFamTable_haveCommonFamily (Array families1, Array families2)
+{
+  int i,j;
+
+  // merge of the two sorted Arrays
+  i = 0;
+  j = 0;
+  while (i < arrayMax (families1) && j < arrayMax (families2)) {
+    if (arru (families1,i,int) == arru (families2,j,int)) {
+      return 1;
+    }
+    if (arru (families1,i,int) < arru (families2,j,int)) {
+      i++;
+    }
+    else {
+      j++;
+    }
+  }
+  return 0;
+}
+
+
+
+void treeFamTable_close (TreeFamTable *table)
+{
+  if (table == NULL) {
+    return;
+  }
+  if (table->isMapped) {
+    munmap (table->data,table->dataSize);
+  }
+  else if (!table->isBorrowed) {
+    hlr_free (table->data);
+  }
+  freeMem (table);
+}
@@ -0,0 +1,40 @@
+#ifndef DEF_TREE_FAM_TABLE_H
+#define DEF_TREE_FAM_TABLE_H
+
+#include <stddef.h>
+#include <bios/format.h>
+
+
+
+/**
+   @file treeFamTable.h
+   @brief Hash table of knownToTreefam.txt: transcript name to TreeFam family.
+   @details The families are numbered densely (0, 1, ...) when the table is built, so the homology check between two transcripts compares small integers instead of strings. The table is pointer-free: an open-addressing hash (linear probing) on the transcript names, pointing to entries with the family number; the lookups do not allocate. If a transcript is listed more than once, the first family is kept.
+   treeFamTable_open() uses the section of the file in the annotation pack (see annotationPack.h) if there is one, maps the file if it was compiled by knownToTreefam2treeFamTable, otherwise it builds the same table in memory from the text file.
+ */
+
+
+
+typedef struct _treeFamTable TreeFamTable;
+
+
+
+/** @return the compiled table of a knownToTreefam file, or a copy of an already compiled one, e.g. to be added to an annotation pack. @remark to be freed with hlr_free(). */
+extern void* treeFamTable_compileInMemory (char* fileName, size_t* size);
+/** @return 1 if the file is a table compiled by knownToTreefam2treeFamTable, 0 if it is a text file. */
+extern int treeFamTable_isCompiled (char* fileName);
+/** open the table of a knownToTreefam file, in text or compiled form. @remark the program dies if the file cannot be read. */
+extern TreeFamTable* treeFamTable_open (char* fileName);
+/** look up a transcript, given by length characters of transcriptName, so that it can be a token of a longer string.
+    @return the number of the family, -1 if the transcript is not in the table. */
+extern int treeFamTable_lookup (TreeFamTable* table, char* transcriptName, int length);
+/** @return the families of the transcripts in transcriptNames, separated by '|', sorted and without duplicates, in families. */
+extern void treeFamTable_getFamilies (TreeFamTable* table, char* transcriptNames, Array families /**< [out] Array of int, cleared first */);
+/** @return 1 if the sorted Arrays of families have a family in common, 0 otherwise. */
+extern int treeFamTable_haveCommonFamily (Array families1, Array families2);
+/** close the table. */
+extern void treeFamTable_close (TreeFamTable* table);
+
+
+
+#endif
@@ -0,0 +1,302 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <bios/log.h>
+#include <bios/format.h>
+
+#include "twoBit.h"
+
+
+
+#define TWO_BIT_SIGNATURE 0x1A412743
+#define TWO_BIT_SIGNATURE_SWAPPED 0x4327411A
+
+
+
+typedef struct {
+  char *name;
+  uint32_t size;
+  uint32_t numNBlocks;
+  const unsigned char *nBlocks; // block starts followed by block sizes
+  uint32_t numMaskBlocks;
+  const unsigned char *maskBlocks;
+  const unsigned char *packed; // four nucleotides per byte
+} TwoBitIndex;
+
+
+
+struct _twoBit {
+  char *fileName;
+  unsigned char *data;
+  size_t dataSize;
+  int isSwapped;
+  Array sequences; // Array of TwoBitIndex, sorted by name
+};
+
+
+
+static int sortTwoBitIndexesByName (TwoBitIndex *a, TwoBitIndex *b)
+{
+  return strcmp (a->name,b->name);
+}
+
+
+
+static uint32_t twoBit_getInt (TwoBit *twoBit, const unsigned char *pos)
+{
+  uint32_t value;
+
+  if (pos < twoBit->data || pos + sizeof (value) > twoBit->data + twoBit->dataSize) {
+    die ("Unexpected end of the 2bit file: %s",twoBit->fileName);
+  }
+  memcpy (&value,pos,sizeof (value)); // the integers are not aligned
+  if (twoBit->isSwapped) {
+    value = ((value & 0xff) << 24) | ((value & 0xff00) << 8) | ((value >> 8) & 0xff00) | (value >> 24);
+  }
+  return value;
+}
+
+
+
+static void twoBit_readHeader (TwoBit *twoBit, TwoBitIndex *currIndex, uint32_t offset)
+{
+  const unsigned char *pos;
+
+  pos = twoBit->data + offset;
+  currIndex->size = twoBit_getInt (twoBit,pos);
+  pos += 4;
+  currIndex->numNBlocks = twoBit_getInt (twoBit,pos);
+  currIndex->nBlocks = pos + 4;
+  pos += 4 + 8 * (size_t)currIndex->numNBlocks;
+  currIndex->numMaskBlocks = twoBit_getInt (twoBit,pos);
+  currIndex->maskBlocks = pos + 4;
+  pos += 4 + 8 * (size_t)currIndex->numMaskBlocks;
+  currIndex->packed = pos + 4; // after the reserved word
+  if (currIndex->packed + (currIndex->size + 3) / 4 > twoBit->data + twoBit->dataSize) {
+    die ("Unexpected end of the 2bit file: %s",twoBit->fileName);
+  }
+}
+
+
+
+TwoBit* twoBit_open (char *fileName)
+{
+  TwoBit *twoBit;
+  TwoBitIndex *currIndex;
+  struct stat info;
+  const unsigned char *pos;
+  uint32_t signature,numSequences,i;
+  int fd,nameSize;
+
+  if ((fd = open (fileName,O_RDONLY)) < 0 || fstat (fd,&info) != 0) {
+    die ("Unable to open the 2bit file: %s",fileName);
+  }
+  AllocVar (twoBit);
+  twoBit->fileName = hlr_strdup (fileName);
+  twoBit->dataSize = info.st_size;
+  if (twoBit->dataSize < 16) {
+    die ("Not a valid 2bit file: %s",fileName);
+  }
+  twoBit->data = (unsigned char*)mmap (NULL,twoBit->dataSize,PROT_READ,MAP_SHARED,fd,0);
+  close (fd);
+  if (twoBit->data == MAP_FAILED) {
+    die ("Unable to map the 2bit file: %s",fileName);
+  }
+  memcpy (&signature,twoBit->data,sizeof (signature));
+  if (signature != TWO_BIT_SIGNATURE && signature != TWO_BIT_SIGNATURE_SWAPPED) {
+    die ("Not a valid 2bit file: %s",fileName);
+  }
+  twoBit->isSwapped = signature == TWO_BIT_SIGNATURE_SWAPPED;
+  if (twoBit_getInt (twoBit,twoBit->data + 4) != 0) {
+    die ("Unsupported version of the 2bit file, only version 0 (32-bit offsets) is read: %s",fileName);
+  }
+  numSequences = twoBit_getInt (twoBit,twoBit->data + 8);
+  twoBit->sequences = arrayCreate (numSequences,TwoBitIndex);
+  pos = twoBit->data + 16;
+  for (i = 0; i < numSequences; i++) {
+    if (pos >= twoBit->data + twoBit->dataSize) {
+      die ("Unexpected end of the 2bit file: %s",fileName);
+    }
+    nameSize = *pos++;
+    if (pos + nameSize > twoBit->data + twoBit->dataSize) {
+      die ("Unexpected end of the 2bit file: %s",fileName);
+    }
+    currIndex = arrayp (twoBit->sequences,i,TwoBitIndex);
+    currIndex->name = (char*)hlr_malloc (nameSize + 1);
+    memcpy (currIndex->name,pos,nameSize);
+    currIndex->name[nameSize] = '\0';
+    pos += nameSize;
+    twoBit_readHeader (twoBit,currIndex,twoBit_getInt (twoBit,pos));
+    pos += 4;
+  }
+  arraySort (twoBit->sequences,(ARRAYORDERF)sortTwoBitIndexesByName);
+  return twoBit;
+}
+
+
+
+static TwoBitIndex* twoBit_findSequence (TwoBit *twoBit, char *seqName)
+{
+  TwoBitIndex testIndex;
+  int index;
+
+  testIndex.name = seqName;
+  if (!arrayFind (twoBit->sequences,&testIndex,&index,(ARRAYORDERF)sortTwoBitIndexesByName)) {
+    return NULL;
+  }
+  return arrp (twoBit->sequences,index,TwoBitIndex);
+}
+
+
+
+int twoBit_getSequenceSize (TwoBit *twoBit, char *seqName)
+{
+  TwoBitIndex *currIndex;
+
+  currIndex = twoBit_findSequence (twoBit,seqName);
+  return currIndex != NULL ? (int)currIndex->size : -1;
+}
+
+
+
+static void twoBit_applyBlocks (TwoBit *twoBit, const unsigned char *blocks, uint32_t numBlocks, char *region, uint32_t start, uint32_t end, int isMask)
+{
+  uint32_t low,high,middle,blockStart,blockEnd,j;
+
+  // the blocks are sorted and do not overlap: binary search of the first one ending after start
+  low = 0;
+  high = numBlocks;
+  while (low < high) {
+    middle = low + (high - low) / 2;
+    blockEnd = twoBit_getInt (twoBit,blocks + 4 * (size_t)middle) + twoBit_getInt (twoBit,blocks + 4 * ((size_t)numBlocks + middle));
+    if (blockEnd <= start) {
+      low = middle + 1;
+    }
+    else {
+      high = middle;
+    }
+  }
+  for (; low < numBlocks; low++) {
+    blockStart = twoBit_getInt (twoBit,blocks + 4 * (size_t)low);
+    if (blockStart >= end) {
+      break;
+    }
+    blockEnd = blockStart + twoBit_getInt (twoBit,blocks + 4 * ((size_t)numBlocks + low));
+    for (j = blockStart > start ? blockStart : start; j < blockEnd && j < end; j++) {
+      region[j - start] = isMask ? tolower (region[j - start]) : 'N';
+    }
+  }
+}
+
+
+
+char* twoBit_getRegion (TwoBit *twoBit, char *seqName, int start, int end, int noMask)
+{
+  static const char bases[4] = {'T','C','A','G'};
+  TwoBitIndex *currIndex;
+  char *region;
+  uint32_t i;
+
+  if ((currIndex = twoBit_findSequence (twoBit,seqName)) == NULL) {
+    return NULL;
+  }
+  if (start < 0) {
+    start = 0;
+  }
+  if (end > (int)currIndex->size || end < 0) {
+    end = currIndex->size;
+  }
+  if (end < start) {
+    end = start;
+  }
+  region = (char*)hlr_malloc (end - start + 1);
+  for (i = start; i < end; i++) {
+    region[i - start] = bases[(currIndex->packed[i / 4] >> (6 - 2 * (i % 4))) & 3];
+  }
+  region[end - start] = '\0';
+  twoBit_applyBlocks (twoBit,currIndex->nBlocks,currIndex->numNBlocks,region,start,end,0);
+  if (!noMask) {
+    twoBit_applyBlocks (twoBit,currIndex->maskBlocks,currIndex->numMaskBlocks,region,start,end,1);
+  }
+  return region;
+}
+
+
+
+char* twoBit_getCoordinates (TwoBit *twoBit, char *coordinates, int noMask)
+{
+  char seqName[256]; // the names are at most 255 characters long
+  char *pos;
+  int start,end;
+
+  pos = strrchr (coordinates,':');
+  if (pos == NULL || pos - coordinates > 255 || sscanf (pos + 1,"%d-%d",&start,&end) != 2) {
+    return twoBit_getRegion (twoBit,coordinates,0,-1,noMask);
+  }
+  memcpy (seqName,coordinates,pos - coordinates);
+  seqName[pos - coordinates] = '\0';
+  return twoBit_getRegion (twoBit,seqName,start,end,noMask);
+}
+
+
+
+void twoBit_close (TwoBit *twoBit)
+{
+  int i;
+
+  if (twoBit == NULL) {
+    return;
+  }
+  munmap (twoBit->data,twoBit->dataSize);
+  for (i = 0; i < arrayMax (twoBit->sequences); i++) {
+    hlr_free (arrp (twoBit->sequences,i,TwoBitIndex)->name);
+  }
+  arrayDestroy (twoBit->sequences);
+  hlr_free (twoBit->fileName);
+  freeMem (twoBit);
+}
+
+
+
+Array twoBit_readSequences (char *fileName)
+{
+  TwoBit *twoBit;
+  TwoBitIndex *currIndex;
+  TwoBitSequence *currSeq;
+  Array sequences;
+  int i;
+
+  twoBit = twoBit_open (fileName);
+  sequences = arrayCreate (arrayMax (twoBit->sequences),TwoBitSequence);
+  for (i = 0; i < arrayMax (twoBit->sequences); i++) {
+    currIndex = arrp (twoBit->sequences,i,TwoBitIndex);
+    currSeq = arrayp (sequences,i,TwoBitSequence);
+    currSeq->name = hlr_strdup (currIndex->name);
+    currSeq->size = currIndex->size;
+    currSeq->sequence = twoBit_getRegion (twoBit,currIndex->name,0,currIndex->size,0);
+  }
+  twoBit_close (twoBit);
+  return sequences;
+}
+
+
+
+void twoBit_freeSequences (Array sequences)
+{
+  TwoBitSequence *currSeq;
+  int i;
+
+  for (i = 0; i < arrayMax (sequences); i++) {
+    currSeq = arrp (sequences,i,TwoBitSequence);
+    hlr_free (currSeq->name);
+    hlr_free (currSeq->sequence);
+  }
+  arrayDestroy (sequences);
+}
@@ -0,0 +1,51 @@
+#ifndef DEF_TWO_BIT_H
+#define DEF_TWO_BIT_H
+
+#include <bios/format.h>
+
+
+
+/**
+   @file twoBit.h
+   @brief Reader of sequence files in the UCSC 2bit format.
+   @details The file is mapped in memory (mmap) once and the regions are decoded on request directly from the mapping, so a whole genome can be opened without reading it. N-blocks are returned as 'N' and the masked blocks in lower case, as twoBitToFa does; the coordinates are zero-based, half-open, as in the seqList of twoBitToFa.
+   The TwoBit handle is read-only after twoBit_open(), so the regions can be extracted from several threads.
+ */
+
+
+
+typedef struct _twoBit TwoBit;
+
+
+
+/**
+   Sequence of a 2bit file.
+*/
+typedef struct {
+  char* name; //!< name of the sequence
+  char* sequence; //!< sequence, null-terminated
+  int size; //!< number of nucleotides
+} TwoBitSequence;
+
+
+
+/** open and map a 2bit file. @remark the program dies if the file is not a valid 2bit file. */
+extern TwoBit* twoBit_open (char* fileName);
+/** @return the size of a sequence, -1 if the sequence is not in the file. */
+extern int twoBit_getSequenceSize (TwoBit* twoBit, char* seqName);
+/** extract the region [start,end) of a sequence; the region is clipped to the sequence.
+    @return the sequence, null-terminated, allocated with hlr_malloc() and owned by the caller; NULL if the sequence is not in the file. */
+extern char* twoBit_getRegion (TwoBit* twoBit, char* seqName, int start, int end, int noMask /**< [in] if 1 the masked blocks are returned in upper case */);
+/** extract a region given as seqName:start-end, the format of the seqList of twoBitToFa. @see twoBit_getRegion() */
+extern char* twoBit_getCoordinates (TwoBit* twoBit, char* coordinates, int noMask);
+/** unmap the file and free the handle. */
+extern void twoBit_close (TwoBit* twoBit);
+/** read all the sequences of a 2bit file.
+    @return Array of TwoBitSequence. @remark the program dies if the file is not a valid 2bit file. */
+extern Array twoBit_readSequences (char* fileName);
+/** free the sequences returned by twoBit_readSequences(). */
+extern void twoBit_freeSequences (Array sequences);
+
+
+
+#endif
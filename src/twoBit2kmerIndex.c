@@ -0,0 +1,33 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <bios/log.h>
+#include <bios/format.h>
+
+#include "kmerIndex.h"
+
+
+
+/**
+   @file twoBit2kmerIndex.c
+   @brief Build the k-mer index of a 2bit file once, e.g. of the splice junction library.
+   @details The index is written in a file that is mapped in memory (mmap) by kmerIndex_open(), so the programs using it (gfrSpliceJunctionFilter) do not need to index the library, or to run blat, at every invocation. The file is only valid on machines with the same byte order.
+   @pre A sequence file in 2bit format.
+   @remarks Ex: twoBit2kmerIndex ucsc_nh_sj75.2bit ucsc_nh_sj75.kmerIndex
+ */
+
+
+
+int main (int argc, char *argv[])
+{
+  KmerIndex *index;
+
+  if (argc != 3) {
+    usage ("%s <file.2bit> <file.kmerIndex>",argv[0]);
+  }
+  index = kmerIndex_create (argv[1]);
+  kmerIndex_write (index,argv[2]);
+  kmerIndex_destroy (index);
+  warn ("%s_index: %s",argv[0],argv[2]);
+  return 0;
+}
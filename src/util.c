@@ -5,6 +5,15 @@
 
 #include "util.h"
 #include "gfr.h"
+#include "uthash.h"
+
+
+
+typedef struct {
+  char* sequence;
+  int index;
+  UT_hash_handle hh;
+} CollapsedReadHash;
 
 int getNucleotideOverlap ( BlatQuery* blQ ) {
   int l;
@@ -61,6 +70,41 @@ void updateStats( GfrEntry* currGE ) {
 }
 
 
+/**
+   Collapses identical reads, as fastx_collapser does.
+   @return Array of CollapsedRead with the distinct reads and their multiplicity, in order of first occurrence.
+ */
+Array util_collapseReads (Texta reads)
+{
+  Array collapsedReads;
+  CollapsedReadHash *hash = NULL, *entries, *currEntry;
+  CollapsedRead *currCR;
+  char* currRead;
+  int i;
+
+  collapsedReads = arrayCreate (arrayMax (reads) + 1,CollapsedRead);
+  entries = (CollapsedReadHash*)hlr_calloc (arrayMax (reads) + 1,sizeof (CollapsedReadHash));
+  for (i = 0; i < arrayMax (reads); i++) {
+    currRead = textItem (reads,i);
+    HASH_FIND_STR (hash,currRead,currEntry);
+    if (currEntry == NULL) {
+      currEntry = &entries[i];
+      currEntry->sequence = currRead;
+      currEntry->index = arrayMax (collapsedReads);
+      HASH_ADD_KEYPTR (hh,hash,currEntry->sequence,strlen (currEntry->sequence),currEntry);
+      currCR = arrayp (collapsedReads,arrayMax (collapsedReads),CollapsedRead);
+      currCR->sequence = currRead;
+      currCR->count = 0;
+    }
+    arrp (collapsedReads,currEntry->index,CollapsedRead)->count++;
+  }
+  HASH_CLEAR (hh,hash);
+  hlr_free (entries);
+  return collapsedReads;
+}
+
+
+
 void writeFasta( GfrEntry* currGE, unsigned int *minReadSize, char* directory ) 
 {
   FILE *freads;
@@ -171,52 +215,78 @@ int sortKgXrefsByTranscriptName (KgXref *a, KgXref *b)
 
 
 
-static char* convert2string (Texta t)
+typedef struct {
+  char* string;
+  int length;
+} Token;
+
+
+
+static void addUniqueToken (Array tokens, char *string, int length)
+{
+  Token *currToken;
+  int i;
+
+  // the strings of the table are interned: the same symbol or description is the same pointer
+  for (i = 0; i < arrayMax (tokens); i++) {
+    currToken = arrp (tokens,i,Token);
+    if (currToken->string == string || (currToken->length == length && strncmp (currToken->string,string,length) == 0)) {
+      return;
+    }
+  }
+  currToken = arrayp (tokens,arrayMax (tokens),Token);
+  currToken->string = string;
+  currToken->length = length;
+}
+
+
+
+static char* convert2string (Array tokens)
 {
   static Stringa buffer = NULL;
+  Token *currToken;
   int i;
 
   stringCreateClear (buffer,100);
-  for (i = 0; i < arrayMax (t); i++) {
-    stringAppendf (buffer,"%s%s",textItem (t,i),i < arrayMax (t) - 1 ? "|" : "");
+  for (i = 0; i < arrayMax (tokens); i++) {
+    currToken = arrp (tokens,i,Token);
+    stringAppendf (buffer,"%s%.*s",i > 0 ? "|" : "",currToken->length,currToken->string);
   }
   return string (buffer);
 }
 
 
 
-void transcript2geneSymbolAndGeneDescription (Array kgXrefs, char *transcriptName, char** geneSymbol, char **description)
+void transcript2geneSymbolAndGeneDescription (KgXrefTable *kgXrefs, char *transcriptName, char** geneSymbol, char **description)
 {
-  Texta tokens;
-  int i;
-  KgXref testKX,*currKX;
-  int index; 
-  static Texta descriptions = NULL;
-  static Texta geneSymbols = NULL;
-  
-  textCreateClear (descriptions,100);
-  textCreateClear (geneSymbols,100);
-  tokens = textFieldtokP (transcriptName,"|");
-  for (i = 0; i < arrayMax (tokens); i++) {
-    testKX.transcriptName = hlr_strdup (textItem (tokens,i));
-    if (!arrayFind (kgXrefs,&testKX,&index,(ARRAYORDERF)sortKgXrefsByTranscriptName)) {
-      warn ("Expected to find KgXref: %s",testKX.transcriptName);
-      textAdd ( geneSymbols, testKX.transcriptName );
+  char *token,*end;
+  char *currGeneSymbol,*currDescription;
+  int length;
+  static Array descriptions = NULL;
+  static Array geneSymbols = NULL;
+
+  if (descriptions == NULL) {
+    descriptions = arrayCreate (10,Token);
+    geneSymbols = arrayCreate (10,Token);
+  }
+  arrayClear (descriptions);
+  arrayClear (geneSymbols);
+  for (token = transcriptName; token != NULL; token = *end == '|' ? end + 1 : NULL) {
+    for (end = token; *end != '|' && *end != '\0'; end++) {
+    }
+    length = end - token;
+    if (!kgXrefTable_lookup (kgXrefs,token,length,&currGeneSymbol,&currDescription)) {
+      warn ("Expected to find KgXref: %.*s",length,token);
+      addUniqueToken (geneSymbols,token,length);
     } else {
-      currKX = arrp (kgXrefs,index,KgXref);
-      if (currKX->refseqDescription[0] != '\0') {
-	textAdd (descriptions,currKX->refseqDescription);
+      if (currDescription[0] != '\0') {
+	addUniqueToken (descriptions,currDescription,strlen (currDescription));
       }
-      if (currKX->geneSymbol[0] != '\0') {
-	textAdd (geneSymbols,currKX->geneSymbol);
+      if (currGeneSymbol[0] != '\0') {
+	addUniqueToken (geneSymbols,currGeneSymbol,strlen (currGeneSymbol));
       } 
     }
-    hlr_free (testKX.transcriptName);
   }
-  textDestroy (tokens);
-  textUniqKeepOrder (descriptions);
-  textUniqKeepOrder (geneSymbols);
   *geneSymbol = hlr_strdup (convert2string (geneSymbols));
   *description = hlr_strdup (convert2string (descriptions));
 }
-
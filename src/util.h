@@ -4,6 +4,8 @@
 #include <bios/blastParser.h>
 #include <bios/blatParser.h>
 
+#include "kgXrefTable.h"
+
 typedef struct {
   char* transcriptName;
   char* swissProt;
@@ -21,11 +23,19 @@ typedef struct {
 } KgTreeFam;
 
 
+
+typedef struct {
+  char* sequence; // not a copy: it points to the collapsed Texta
+  int count;
+} CollapsedRead;
+
+
 extern int getNucleotideOverlap ( BlatQuery* blQ );
 extern Array util_readKnownGeneXrefs (char* fileName);
 extern Array util_readKnownGeneTreeFams (char* fileName);
 extern int sortKgXrefsByTranscriptName (KgXref *a, KgXref *b);
-extern void transcript2geneSymbolAndGeneDescription (Array kgXrefs, char *transcriptName, char** geneSymbol, char **description);
+extern Array util_collapseReads (Texta reads);
+extern void transcript2geneSymbolAndGeneDescription (KgXrefTable* kgXrefs, char *transcriptName, char** geneSymbol, char **description);
  
 
 #endif
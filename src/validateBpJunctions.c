@@ -3,12 +3,13 @@
 #include <unistd.h>
 #include <sys/types.h>
 
-#include <bios/confp.h>
 #include <bios/log.h>
 #include <bios/format.h>
 #include <bios/bowtieParser.h>
 
+#include "conf.h"
 #include "bp.h"
+#include "subprocess.h"
 
 
 int main (int argc, char *argv[])
@@ -19,22 +20,19 @@ int main (int argc, char *argv[])
   int i,j;
   Stringa buffer,cmd;
   FILE *fp;
+  MemFile *readsFA;
   BowtieQuery *currBQ;
   Texta invalidJunctions;
   int index;
   char *str = NULL;
 
-  config *conf;
+  Conf *conf;
 
-  if ((conf = confp_open(getenv("FUSIONSEQ_CONFPATH"))) == NULL)
-    return EXIT_FAILURE;
+  conf = conf_init (argv[0], "BOWTIE_INDEXES", "BOWTIE_GENOME", NULL);
 
   buffer = stringCreate (100);
-  stringPrintf (buffer,"bpJunctionReads_%d.fa",getpid ());
-  fp = fopen (string (buffer),"w");
-  if (fp == NULL) {
-    die ("Unable to open file: %s",string (buffer));
-  }
+  readsFA = subprocess_createMemFile ("bpJunctionReads.fa");
+  fp = subprocess_getStream (readsFA);
   bp_init ("-");
   breakPoints = bp_getBreakPoints ();
   for (i = 0; i < arrayMax (breakPoints); i++) {
@@ -45,22 +43,20 @@ int main (int argc, char *argv[])
     }
   }
   bp_deInit ();
-  fclose (fp);
 
   invalidJunctions = textCreate (1000);
   cmd = stringCreate (100);
   stringPrintf (cmd,"bowtie --quiet -p 4 -n 0 -f %s/%s/%s %s",
-		confp_get(conf, "BOWTIE_INDEXES"),
-		confp_get(conf, "BOWTIE_GENOME"), 
-		confp_get(conf, "BOWTIE_GENOME"), 
-		string (buffer));
+		conf->bowtieIndexes,
+		conf->bowtieGenome, 
+		conf->bowtieGenome, 
+		subprocess_getPath (readsFA));
   bowtieParser_initFromPipe (string (cmd));
   while (currBQ = bowtieParser_nextQuery ()) {
     textAdd (invalidJunctions,currBQ->sequenceName);
   }
   bowtieParser_deInit ();
-  stringPrintf (cmd,"rm -f %s",string (buffer));
-  hlr_system (string (cmd),0);
+  subprocess_destroyMemFile (readsFA);
 
   arraySort (invalidJunctions,(ARRAYORDERF)arrayStrcmp);
   arrayUniq (invalidJunctions,NULL,(ARRAYORDERF)arrayStrcmp);
@@ -74,7 +70,7 @@ int main (int argc, char *argv[])
   }
   stringDestroy (buffer);
   stringDestroy (cmd);
-  confp_close(conf);
+  conf_deInit ();
 
   return EXIT_SUCCESS;
 }